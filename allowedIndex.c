@@ -0,0 +1,203 @@
+/*
+
+allowedIndex.c
+
+Regions are gathered by chromosome as they are added, then sorted and
+merged when the index is finished.  Regions that were added in order,
+as the already merged okRegions of a context are, are not sorted again.  Overlapping and touching regions
+are joined, so every allowed base is in exactly one interval, and the
+rank of a position is a prefix sum plus the part of the one interval
+that starts before it.
+
+*/
+
+#include "common.h"
+#include "hash.h"
+#include "allowedIndex.h"
+
+
+struct allowedRegion
+{
+	long start;
+	long end;
+};
+
+
+struct allowedChrom
+/* the allowed regions of one chromosome, merged and sorted once finished */
+{
+	struct allowedRegion *regions;
+	long *basesBefore;   /* allowed bases in the regions before i */
+	int count;
+	int alloc;
+	long bases;          /* allowed bases on the whole chromosome */
+};
+
+
+struct allowedIndex *allowedIndexNew()
+{
+	struct allowedIndex *index = NULL;
+
+	AllocVar(index);
+	index->chromHash = newHash(8);
+	return(index);
+}
+
+
+void allowedIndexAdd(struct allowedIndex *index, char *chrom, long start, long end)
+/* adds one allowed region, in any order and overlapping any others */
+{
+	struct allowedChrom *ac = NULL;
+
+	if(index->finished){errAbort("Error: can not add %s:%ld-%ld to an allowed index that is already finished", chrom, start, end);}
+	if(end <= start){return;}
+	if((ac = hashFindVal(index->chromHash, chrom)) == NULL)
+	{
+		AllocVar(ac);
+		ac->alloc = 64;
+		AllocArray(ac->regions, ac->alloc);
+		hashAdd(index->chromHash, chrom, ac);
+	}
+	if(ac->count == ac->alloc)
+	{
+		ExpandArray(ac->regions, ac->alloc, 2*ac->alloc);
+		ac->alloc *= 2;
+	}
+	ac->regions[ac->count].start = start;
+	ac->regions[ac->count].end = end;
+	ac->count++;
+}
+
+
+void allowedIndexFree(struct allowedIndex **pIndex)
+{
+	struct allowedIndex *index = *pIndex;
+	struct hashEl *helList = NULL, *hel = NULL;
+	struct allowedChrom *ac = NULL;
+
+	if(index == NULL){return;}
+	helList = hashElListHash(index->chromHash);
+	for(hel=helList; hel != NULL; hel=hel->next)
+	{
+		ac = hel->val;
+		freeMem(ac->regions);
+		freeMem(ac->basesBefore);
+		freeMem(ac);
+	}
+	hashElFreeList(&helList);
+	freeHash(&index->chromHash);
+	freez(pIndex);
+}
+
+
+static int allowedRegionCmp(const void *va, const void *vb)
+{
+	const struct allowedRegion *a = (const struct allowedRegion *)va;
+	const struct allowedRegion *b = (const struct allowedRegion *)vb;
+	if(a->start < b->start){return(-1);}
+	if(a->start > b->start){return(1);}
+	return(0);
+}
+
+
+void allowedIndexFinish(struct allowedIndex *index)
+/* merges every chromosome and sums its bases, after which the index can */
+/* be searched but not added to */
+{
+	struct hashEl *helList = hashElListHash(index->chromHash), *hel = NULL;
+	struct allowedChrom *ac = NULL;
+	int i = 0, merged = 0;
+
+	for(hel=helList; hel != NULL; hel=hel->next)
+	{
+		ac = hel->val;
+		for(i=1; i<ac->count && ac->regions[i-1].start <= ac->regions[i].start; i++)
+			;
+		if(i < ac->count){qsort(ac->regions, ac->count, sizeof(struct allowedRegion), allowedRegionCmp);}
+		for(i=0, merged=0; i<ac->count; i++)
+		{
+			if(merged > 0 && ac->regions[i].start <= ac->regions[merged-1].end)
+				ac->regions[merged-1].end = max(ac->regions[merged-1].end, ac->regions[i].end);
+			else
+				ac->regions[merged++] = ac->regions[i];
+		}
+		ac->count = merged;
+		AllocArray(ac->basesBefore, max(ac->count,1));
+		for(i=0; i<ac->count; i++)
+		{
+			ac->basesBefore[i] = ac->bases;
+			ac->bases += ac->regions[i].end - ac->regions[i].start;
+		}
+		index->bases += ac->bases;
+	}
+	hashElFreeList(&helList);
+	index->finished = TRUE;
+}
+
+
+struct allowedChrom *allowedIndexChrom(struct allowedIndex *index, char *chrom)
+/* the allowed regions of chrom, NULL if none are allowed */
+{
+	if(!index->finished){errAbort("Error: allowed index must be finished before it is searched");}
+	return(hashFindVal(index->chromHash, chrom));
+}
+
+
+long allowedChromRank(struct allowedChrom *ac, long position)
+/* allowed bases to the left of position */
+{
+	int lo = 0, hi = 0, mid = 0;
+
+	if(ac == NULL){return(0);}
+	//lo becomes the first region that starts at or after position
+	hi = ac->count;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo)/2;
+		if(ac->regions[mid].start < position){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	if(lo == 0){return(0);}
+	return(ac->basesBefore[lo-1] + min(position, ac->regions[lo-1].end) - ac->regions[lo-1].start);
+}
+
+
+long allowedChromBases(struct allowedChrom *ac, long start, long end)
+/* allowed bases in start-end */
+{
+	if(end <= start){return(0);}
+	return(allowedChromRank(ac, end) - allowedChromRank(ac, start));
+}
+
+
+long allowedChromTotal(struct allowedChrom *ac)
+/* allowed bases on the whole chromosome */
+{
+	return(ac == NULL ? 0 : ac->bases);
+}
+
+
+long allowedChromSelect(struct allowedChrom *ac, long rank)
+/* The position of the allowed base with rank allowed bases before it, */
+/* the inverse of allowedChromRank.  rank must be below the chromosome's bases. */
+{
+	int lo = 0, hi = 0, mid = 0;
+
+	if(ac == NULL || rank < 0 || rank >= ac->bases){errAbort("Error: allowed base %ld is not on the chromosome", rank);}
+	//lo becomes the first region with more than rank bases before it
+	hi = ac->count;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo)/2;
+		if(ac->basesBefore[mid] <= rank){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	return(ac->regions[lo-1].start + rank - ac->basesBefore[lo-1]);
+}
+
+
+long allowedIndexBases(struct allowedIndex *index, char *chrom, long start, long end)
+/* allowed bases in chrom:start-end */
+{
+	return(allowedChromBases(allowedIndexChrom(index, chrom), start, end));
+}
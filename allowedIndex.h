@@ -0,0 +1,45 @@
+/*
+
+allowedIndex.h
+
+The allowed regions, noGaps.bed, compiled into a rank index: each
+chromosome's regions merged into sorted disjoint intervals next to the
+allowed bases before each one.  The allowed bases in any interval then
+come from two binary searches, in any order and from any thread once
+the index is finished, and the allowed base of a given rank can be
+found the same way for placing intervals uniformly over allowed sequence.
+
+*/
+
+#ifndef ALLOWEDINDEX_H
+#define ALLOWEDINDEX_H
+
+struct allowedIndex
+/* allowed regions by chromosome */
+{
+	struct hash *chromHash;   /* chrom to struct allowedChrom, the merged regions of one chromosome */
+	long bases;               /* allowed bases in the whole genome */
+	boolean finished;
+};
+
+struct allowedIndex *allowedIndexNew();
+
+void allowedIndexAdd(struct allowedIndex *index, char *chrom, long start, long end);
+
+void allowedIndexFinish(struct allowedIndex *index);
+
+struct allowedChrom *allowedIndexChrom(struct allowedIndex *index, char *chrom);
+
+long allowedChromRank(struct allowedChrom *ac, long position);
+
+long allowedChromBases(struct allowedChrom *ac, long start, long end);
+
+long allowedChromTotal(struct allowedChrom *ac);
+
+long allowedChromSelect(struct allowedChrom *ac, long rank);
+
+long allowedIndexBases(struct allowedIndex *index, char *chrom, long start, long end);
+
+void allowedIndexFree(struct allowedIndex **pIndex);
+
+#endif
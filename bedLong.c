@@ -59,19 +59,27 @@ struct bedLong *bedLongLoadN(char *row[], int wordCount)
 }
 
 
-struct bedLong *filenameToBedLong(char *filename)
+int bedLongFileFieldCount(char *filename)
+/* the number of tab separated fields on the first real line of the file */
 {
-	struct bedLong *list = NULL, *el;
 	int numFields;
 	char *line;
 	struct lineFile *lf = lineFileOpen(filename, TRUE);
 
-	lineFileNextReal(lf, &line);
+	if(!lineFileNextReal(lf, &line)){errAbort("file %s is empty",filename);}
 	numFields = countChars(line,'\t') + 1;
 	if(numFields < 3 || numFields > 6){errAbort("file %s has %d fields when it needs between 3 and 6",filename,numFields);}
 	lineFileClose(&lf);
+	return(numFields);
+}
+
+
+struct bedLong *filenameToBedLong(char *filename)
+{
+	struct bedLong *list = NULL, *el;
+	int numFields = bedLongFileFieldCount(filename);
+	struct lineFile *lf = lineFileOpen(filename, TRUE);
 
-	lf = lineFileOpen(filename, TRUE);
 	char *row[numFields];
 	while (lineFileRow(lf, row))
 	{
@@ -159,7 +167,7 @@ void bedLongFree(struct bedLong **pEl)
 	if ((el = *pEl) == NULL) return;
 	freeMem(el->chrom);
 	freeMem(el->name);
-	slNameFree(el->goTerms);
+	slNameFreeList(&el->goTerms);
 	freez(pEl);
 }
 
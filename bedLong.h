@@ -35,6 +35,8 @@ long stringToLong(char *s);
 
 struct bedLong *bedLongLoadN(char *row[], int wordCount);
 
+int bedLongFileFieldCount(char *filename);
+
 struct bedLong *filenameToBedLong(char *filename);
 
 struct bedLong *bedToBedLong(struct bed *futon, boolean hasGoTerms);
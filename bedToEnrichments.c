@@ -12,8 +12,9 @@ Written by Craig Lowe
 #include "memalloc.h"
 #include "bed.h"
 #include "bedLong.h"
+#include "enrichments.h"
+#include "resultSlice.h"
 #include "dystring.h"
-#include "gsl/gsl_cdf.h"
 
 
 /*---------------------------------------------------------------------------*/
@@ -34,6 +35,20 @@ static struct optionSpec optionSpecs[] =
 	{"showParams", OPTION_BOOLEAN},
 	{"largeSet", OPTION_STRING},
 	{"countUnassigned", OPTION_BOOLEAN},
+	{"threads", OPTION_INT},
+	{"edits", OPTION_STRING},
+	{"minTermSize", OPTION_INT},
+	{"maxTermSize", OPTION_INT},
+	{"namespaces", OPTION_BOOLEAN},
+	{"memLimit", OPTION_INT},
+	{"tmpDir", OPTION_STRING},
+	{"saveAssignments", OPTION_STRING},
+	{"fromAssignments", OPTION_BOOLEAN},
+	{"shard", OPTION_STRING},
+	{"ontology", OPTION_STRING},
+	{"ontologyMethod", OPTION_STRING},
+	{"approx", OPTION_DOUBLE},
+	{"nearestGene", OPTION_BOOLEAN},
 	{NULL, 0}
 };
 
@@ -51,6 +66,20 @@ boolean optShowNames = FALSE;
 boolean optShowParams = FALSE;
 char *optLargeSet = NULL;
 boolean optCountUnassigned = FALSE;
+int optThreads = 1;
+char *optEdits = NULL;
+int optMinTermSize = 0;
+int optMaxTermSize = 0;
+boolean optNamespaces = FALSE;
+int optMemLimit = 0;
+char *optTmpDir = "/tmp";
+char *optSaveAssignments = NULL;
+boolean optFromAssignments = FALSE;
+char *optShard = NULL;
+char *optOntology = NULL;
+char *optOntologyMethod = "elim";
+double optApprox = 0;
+boolean optNearestGene = FALSE;
 
 
 /*---------------------------------------------------------------------------*/
@@ -61,10 +90,13 @@ void usage()
 errAbort(
 	"bedToEnrichments - do enrichment tests when given a .bed file.\n"
 	"usage:\n"
-	"   bedToEnrichments elements.bed genes.bedLong noGaps.bed\n"
+	"   bedToEnrichments elements.bed genes.bedLong noGaps.bed [moreNoGaps.bed ...]\n"
+	"   bedToEnrichments merge slice1 slice2 ...\n"
 	"options:\n"
 	"   -binom                FALSE    use the binomial method\n"
-	"   -hypergeo             FALSE    use the hypergeometric method\n"
+	"   -hypergeo             FALSE    use the hypergeometric method.  With -binom too, both are run from one\n"
+	"                                    load, with -largeSet the null model as well, and shown in one table\n"
+	"                                    with a p-value column for each\n"
 	"   -bonferroni           FALSE    correct pvalues for multiple tests\n"
 	"   -maxExpansion=int     1000000  element will not be assigned to a gene if it is further away than this\n"
 	"   -noExpansionOverlap   FALSE    expansion can only happen into bases that have not been assigned to another gene\n"
@@ -76,9 +108,42 @@ errAbort(
 	"   -largeSet=str.bed     NULL     a larger bed file that contains the bases from elements.bed.  This is used like a null model\n"
 	"   -geneAssignments      FALSE    just show the elements and the genes assigned to it\n"
 	"   -countUnassigned      FALSE    count the elements outside of maxExpansion when doing stats\n"
+	"   -threads=int          1        number of threads to use, the work is split up by chromosome\n"
+	"   -edits=str            NULL     after the full run, add and remove elements as listed in this file and\n"
+	"                                    show the results again after every batch of edits.  Each line is\n"
+	"                                    '+ chrom start end' or '- chrom start end', and a blank line ends a batch\n"
+	"   -minTermSize=int      0        only test goTerms on at least this many genes\n"
+	"   -maxTermSize=int      0        only test goTerms on at most this many genes, 0 for no limit\n"
+	"   -namespaces           FALSE    goTerms are prefixed with their source, as in GO:0001501 or KEGG:hsa04310.\n"
+	"                                    Each prefix is corrected for multiple tests and shown on its own\n"
+	"   -memLimit=int         0        megabytes of elements to hold in memory.  Past this they are sorted in\n"
+	"                                    pieces on disk and merged back a chromosome at a time.  0 for no limit\n"
+	"   -tmpDir=str           /tmp     where to put the sorted pieces for -memLimit\n"
+	"   -nearestGene          FALSE    with -geneAssignments, also show the gene nearest each element and\n"
+	"                                    its distance, whether or not the element is in the gene's domain\n"
+	"   -saveAssignments=str  NULL     with -geneAssignments, also save the genes each element is assigned to\n"
+	"                                    in this binary file, for later runs with -fromAssignments\n"
+	"   -fromAssignments      FALSE    elements.bed is a file from -saveAssignments.  The elements are not\n"
+	"                                    read or overlapped again, but the genes and expansion options must be\n"
+	"                                    the same as when it was saved\n"
+	"   -shard=i/n            NULL     only test the ith of n equal slices of the goTerms, and write their\n"
+	"                                    uncorrected results to stdout in binary.  'merge' reads the files of\n"
+	"                                    all n slices and shows what one run would have, taking -bonferroni,\n"
+	"                                    -maxPvalue, -showNames, -showParams and -goTermToEnglish itself\n"
+	"   -ontology=str         NULL     file of 'childTerm parentTerm' lines.  With -hypergeo, terms are tested\n"
+	"                                    from the most specific up, and the genes of a term that passes\n"
+	"                                    -maxPvalue are left out of the tests of all of its ancestors (elim)\n"
+	"   -ontologyMethod=str   elim     with -ontology, elim or weight.  weight uses no cutoff: each gene counts\n"
+	"                                    for a weight in each term, lowered in a parent and its ancestors by\n"
+	"                                    a child that scores better, or in a child that scores worse\n"
+	"   -approx=double        0        with -binom, a quick estimate from this fraction of the elements of\n"
+	"                                    each chromosome, doubled until the top 10 goTerms stop changing.\n"
+	"                                    The low and high ends of each p-value's 95%% interval follow it\n"
 	"notes:\n"
 	"   genes.bedLong is the same format as a 6 column bed, but the score field is replaced with a\n"
 	"     comma separated list of GO terms\n"
+	"   with several noGaps files and -binom, the elements are tested against each background from\n"
+	"     one load, and shown in one table with a p-value column for each file\n"
 	"references:\n"
 	"  This code has been used and described in:\n"
 	"    Lowe CB, Kellis M, Siepel A, Raney BJ, Clamp M, Salama SR, Kingsley DM, Lindblad-Toh K, Haussler D.\n"
@@ -229,7 +294,7 @@ char *hashKeyToString(struct hash *hash, char *key)
 }
 
 
-void displayResults(struct slNameDouble *head, struct hash *hitsHash, struct hash *paramsHash)
+void displayResults(struct slNameDouble *head, struct hash *intervalHash, struct hash *hitsHash, struct hash *paramsHash)
 {
 	slSort(&head,slNameDoubleCmp);
 	struct hash *goToEnglishHash = NULL;
@@ -245,6 +310,7 @@ void displayResults(struct slNameDouble *head, struct hash *hitsHash, struct has
 		struct dyString *string = newDyString(256);
 		dyStringPrintf(string,"%s\t%g",curr->name,curr->number);
 
+		if(intervalHash != NULL){dyStringPrintf(string,"\t%s",(char *)hashMustFindVal(intervalHash,curr->name));}
 		if(paramsHash != NULL){dyStringPrintf(string,"\t%s",(char *)hashMustFindVal(paramsHash,curr->name));}
 		if(goToEnglishHash != NULL){dyStringPrintf(string,"\t%s",(char *)hashMustFindVal(goToEnglishHash,curr->name));}
 		if(hitsHash != NULL)
@@ -259,634 +325,502 @@ void displayResults(struct slNameDouble *head, struct hash *hitsHash, struct has
 }
 
 
-void bonferroniCorrection(struct slNameDouble *head, int numberOfTests)
+char *resultParams(struct enrichResult *result, enum enrichTest test)
 {
-	struct slNameDouble *curr;
-	double dubNOT = (double)numberOfTests;
-	for(curr=head; curr != NULL; curr=curr->next)
-	{
-		curr->number *= dubNOT;
-		if(curr->number > 1){curr->number = 1;}
-	}
+	if(test == enrichBinomial){return(binomParamsToTabString(((double)result->whiteBalls)/((double)result->totalBalls), result->whiteBallsPicked, result->totalPicks));}
+	return(hyperParamsToTabString(result->whiteBallsPicked, result->totalPicks, result->whiteBalls, result->totalBalls));
 }
 
 
-void bedLongGuessTxStart(struct bedLong *bedLongList)
+char *intervalString(struct enrichResult *result)
 {
-	struct bedLong *futon = NULL;
-	for(futon=bedLongList; futon != NULL; futon=futon->next)
-	{
-		if(futon->strand == '+')
-			futon->chromEnd = futon->chromStart + 1;
-		else if (futon->strand == '-')
-			futon->chromStart = futon->chromEnd - 1;
-		else
-			errAbort("tried to guess the txStart when there is not strand %s %ld %ld", futon->chrom, futon->chromStart, futon->chromEnd);
-	}
+	struct dyString *string = newDyString(64);
+	char *toRet = NULL;
+	dyStringPrintf(string, "%g\t%g", result->pLow, result->pHigh);
+	toRet = cloneString(string->string);
+	dyStringFree(&string);
+	return toRet;
 }
 
 
-void expandBedLongListByDistance(struct bedLong *bedLongList, long distance)
-{
-	struct bedLong *futon = NULL;
-
-	for(futon=bedLongList; futon != NULL; futon=futon->next)
-	{
-		futon->chromStart = max(0,futon->chromStart - distance);
-		futon->chromEnd += distance;
-	}
-}
-
-void expandBedLongListToNeighbor(struct bedLong *bedLongList, long distance)
+void showResults(struct enrichResult *results, enum enrichTest test, struct slName *namespaces)
 {
-	struct bedLong *prev = NULL, *curr = NULL;
-	long middle = 0;
+	/* Shows the results of each namespace under its own #namespace line. */
+	/* Without -namespaces there is only the one namespace. */
+	struct enrichResult *result = NULL;
+	struct slName *namespace = NULL, *hit = NULL;
+	struct slNameDouble *group = NULL;
+	struct hash *hitsHash = NULL, *paramsHash = NULL, *intervalHash = NULL;
 
-	for(curr=bedLongList; curr != NULL; curr=curr->next)
+	for(namespace=namespaces; namespace != NULL; namespace=namespace->next)
 	{
-		if((prev != NULL) && (strcmp(prev->chrom,curr->chrom) != 0))
-		{
-			prev->chromEnd += distance;
-			prev = NULL;
-		}
-
-		if(prev==NULL)
-		{
-			curr->chromStart = max(0,curr->chromStart - distance);
-			prev = curr;
-			if(curr->next == NULL){curr->chromEnd += distance;}
-		}
-		else if(curr->chromStart - prev->chromEnd >= 2 * distance)
-		{
-			prev->chromEnd += distance;
-			curr->chromStart = max(0,curr->chromStart - distance);
-			prev = curr;
-			if(curr->next == NULL){curr->chromEnd += distance;}
-		}
-		else if(curr->chromStart - prev->chromEnd >= 0)
-		{
-			middle = (curr->chromStart + prev->chromEnd)/2;
-			prev->chromEnd = middle;
-			curr->chromStart = middle;
-			prev = curr;
-			if(curr->next == NULL){curr->chromEnd += distance;}
-		}
-		else if(curr->chromEnd - prev->chromEnd >= 0)
-		{
-			prev = curr;
-			if(curr->next == NULL){curr->chromEnd += distance;}
-		}
-		else if(curr->chromEnd < prev->chromEnd)
+		if(optApprox > 0){intervalHash = newHash(9);}
+		if(optShowNames){hitsHash = newHash(9);}
+		if(optShowParams){paramsHash = newHash(9);}
+		for(result=results; result != NULL; result=result->next)
 		{
-			if(curr->next == NULL){curr->chromEnd += distance;}
-		}
-		else
-		{
-			errAbort("should not exhaust this if statement");
+			if(differentString(result->namespace, namespace->name)){continue;}
+			slAddHead(&group, createSlNameDouble(result->term, result->pValue));
+			if(intervalHash != NULL){hashAdd(intervalHash, result->term, intervalString(result));}
+			if(paramsHash != NULL){hashAdd(paramsHash, result->term, resultParams(result, test));}
+			if(hitsHash != NULL)
+			{
+				for(hit=result->hits; hit != NULL; hit=hit->next)
+					hashAdd(hitsHash, result->term, cloneString(hit->name));
+			}
 		}
+		slReverse(&group);
+		if(optNamespaces){fprintf(stdout, "#namespace\t%s\n", namespace->name);}
+		displayResults(group,intervalHash,hitsHash,paramsHash);
+		group = NULL;
+		freeHashAndVals(&intervalHash);
+		freeHashAndVals(&hitsHash);
+		freeHashAndVals(&paramsHash);
 	}
 }
 
 
-void showSlNameList(struct slName *slNameList)
+char *testName(enum enrichTest test)
 {
-	struct slName *craig;
-
-	for(craig=slNameList; craig != NULL; craig=craig->next)
-	{
-		fprintf(stdout,"%s\n",craig->name);
-	}
+	if(test == enrichBinomial){return("binom");}
+	if(test == enrichHypergeometric){return("hypergeo");}
+	return("nullModel");
 }
 
 
-int bedLongCmp(const void *va, const void *vb)
+struct multiRow
+/* the results of one term under every test, any of which may be missing */
 {
-	const struct bedLong *a = *((struct bedLong **)va);
-	const struct bedLong *b = *((struct bedLong **)vb);
-	int dif;
-	dif = strcmp(a->chrom, b->chrom);
-	if(dif != 0){return(dif);}
-	else if(a->chromStart > b->chromStart){return(1);}
-	else if(a->chromStart == b->chromStart){return(0);}
-	else{return(-1);}
-}
+	struct multiRow *next;
+	char *term;
+	struct enrichResult **results;  /* by test, NULL where the test left it out */
+	double best;                    /* the smallest p-value of the tests */
+};
 
 
-int bedLongCmpStart(struct bedLong *futon, struct bedLong *bunk)
+int multiRowCmp(const void *va, const void *vb)
 {
-	int diff = 0;
-	diff = strcmp(futon->chrom, bunk->chrom);
-	if(diff == 0)
-	{
-		if(futon->chromStart < bunk->chromStart){return(-1);}
-		else if(futon->chromStart > bunk->chromStart){return(1);}
-		else{return(0);}
-	}
-	else{return(diff);}
+	const struct multiRow *a = *((struct multiRow **)va);
+	const struct multiRow *b = *((struct multiRow **)vb);
+	if(a->best > b->best){return(1);}
+	else if(a->best == b->best){return(0);}
+	else{return(-1);}
 }
 
 
-int bedLongCmpEnd(struct bedLong *futon, struct bedLong *bunk)
+void showMultiResults(struct slName *goTerms, struct enrichResult **results, enum enrichTest *tests, int testCount, char **columns, struct slName *namespaces)
 {
-	int diff = 0;
-	diff = strcmp(futon->chrom, bunk->chrom);
-	if(diff == 0)
-	{
-		if(futon->chromEnd < bunk->chromEnd){return(-1);}
-		else if(futon->chromEnd > bunk->chromEnd){return(1);}
-		else{return(0);}
-	}
-	else{return(diff);}
-}
-
+	/* One table with a p-value column for each test, then the params of */
+	/* each test with -showParams and the names hit by each with -showNames. */
+	/* A term is shown if any of its tests passes maxPvalue, and a test that */
+	/* left it out because it could not pass is shown as NA.  The columns */
+	/* are headed by the names of the tests, or by columns if it is given. */
+	struct hash *goToEnglishHash = NULL, *termHash = NULL;
+	struct slName *namespace = NULL, *goTerm = NULL, *hit = NULL;
+	struct enrichResult *result = NULL;
+	struct multiRow *rows = NULL, *row = NULL;
+	struct dyString *string = newDyString(256);
+	char *params = NULL;
+	int i = 0;
 
-boolean bedLongOverlap(struct bedLong *futon, struct bedLong *bunk)
-{
-	assert(futon != NULL);
-	if(strcmp(futon->chrom,bunk->chrom) == 0)
+	if(optGoTermToEnglish != NULL)
+		goToEnglishHash = fileLoadHash(optGoTermToEnglish);
+	for(namespace=namespaces; namespace != NULL; namespace=namespace->next)
 	{
-		if(min(futon->chromEnd,bunk->chromEnd) - max(futon->chromStart,bunk->chromStart) > 0)
+		termHash = newHash(12);
+		for(goTerm=goTerms; goTerm != NULL; goTerm=goTerm->next)
 		{
-		return(TRUE);
+			AllocVar(row);
+			row->term = goTerm->name;
+			AllocArray(row->results, testCount);
+			row->best = 2;
+			hashAdd(termHash, goTerm->name, row);
+			slAddHead(&rows, row);
 		}
-	}
-	return(FALSE);
-}
-
-
-long bedLongIntersectGoBases(struct bedLong *geneList, char *goTerm, struct bedLong *allowedRegionsList)
-{
-	/* returns the number of bases in the intersection of the two bed files */
-	/* where only the records of geneList that match "goTerm" will be used */
-	/* both the bed lists should be sorted with bedLongCmpStart */
-	struct bedLong *gene = NULL, *sequenced = NULL;
-	char *prevChr = NULL;
-	long sum = 0, prevEnd = 0, overlapStart = 0, overlapEnd = 0;
-
-	gene = geneList;
-	sequenced = allowedRegionsList;
-	prevChr = cloneString(gene->chrom);
-
-	while(gene != NULL && sequenced != NULL)
-	{
-		if(bedLongHasGoTerm(gene, goTerm))
+		slReverse(&rows);
+		for(i=0; i<testCount; i++)
 		{
-			if(strcmp(prevChr,gene->chrom) != 0)
+			for(result=results[i]; result != NULL; result=result->next)
 			{
-				prevChr = cloneString(gene->chrom);
-				prevEnd = 0;
-			}
-
-			if(bedLongOverlap(gene,sequenced))
-			{
-				overlapStart = max(gene->chromStart,sequenced->chromStart);
-				overlapEnd = min(gene->chromEnd,sequenced->chromEnd);
-				if(overlapStart >= prevEnd)
-				{
-					sum += overlapEnd - overlapStart;
-				}
-				else if(overlapEnd > prevEnd)
-				{
-					sum += overlapEnd - prevEnd;
-				}
-				prevEnd = max(prevEnd,overlapEnd);
+				if(differentString(result->namespace, namespace->name)){continue;}
+				row = hashMustFindVal(termHash, result->term);
+				row->results[i] = result;
+				if(result->pValue < row->best){row->best = result->pValue;}
 			}
-			if(bedLongCmpEnd(gene,sequenced) <= 0){gene = gene->next;}
-			else{sequenced = sequenced->next;}
-		}
-		else
-		{
-			gene = gene->next;
 		}
-	}
-	return(sum);
-}
-
-int bedLongIntersectThreeGoCount(struct bedLong *listOne, char *goTermOne, struct bedLong *listTwo, char *goTermTwo, struct bedLong *listThree, char *goTermThree)
-{
-	/* returns the number of elements in list one that overlap both something in list */
-	/* two and in list three */
-	struct bedLong *bedLongOne = NULL, *bedLongTwo = NULL, *bedLongThree = NULL;
-	int count = 0;
-
-	bedLongOne = listOne;
-	bedLongTwo = listTwo;
-	bedLongThree = listThree;
-
-	while(bedLongOne != NULL && bedLongTwo != NULL && bedLongThree != NULL)
-	{
-		if((goTermOne == NULL) || (bedLongHasGoTerm(bedLongOne, goTermOne)))
+		slSort(&rows, multiRowCmp);
+
+		if(optNamespaces){fprintf(stdout, "#namespace\t%s\n", namespace->name);}
+		fprintf(stdout, "#goTerm");
+		for(i=0; i<testCount; i++)
+			fprintf(stdout, "\t%s", (columns != NULL) ? columns[i] : testName(tests[i]));
+		fprintf(stdout, "\n");
+		for(row=rows; row != NULL; row=row->next)
 		{
-			if((goTermTwo == NULL) || (bedLongHasGoTerm(bedLongTwo, goTermTwo)))
+			if(row->best > optMaxPvalue || row->best > 1){continue;}
+			dyStringClear(string);
+			dyStringPrintf(string, "%s", row->term);
+			for(i=0; i<testCount; i++)
 			{
-				if((goTermThree == NULL) || (bedLongHasGoTerm(bedLongThree, goTermThree)))
-				{
-					if(bedLongOverlap(bedLongOne,bedLongTwo) && bedLongOverlap(bedLongOne,bedLongThree))
-					{
-						count++;
-						bedLongOne = bedLongOne->next;
-					}
-					else if((bedLongCmpEnd(bedLongOne,bedLongTwo) < 0) && (bedLongCmpEnd(bedLongOne,bedLongThree) < 0)){bedLongOne = bedLongOne->next;}
-					else if(bedLongCmpEnd(bedLongTwo,bedLongThree) < 0){bedLongTwo = bedLongTwo->next;}
-					else{bedLongThree = bedLongThree->next;}
-				}
-				else
-				{
-					bedLongThree = bedLongThree->next;
-				}
+				if(row->results[i] != NULL){dyStringPrintf(string, "\t%g", row->results[i]->pValue);}
+				else{dyStringPrintf(string, "\tNA");}
 			}
-			else
+			if(optShowParams)
 			{
-				bedLongTwo = bedLongTwo->next;
-			}
-		}
-		else
-		{
-		bedLongOne = bedLongOne->next;
-		}
-	}
-	return(count);
-}
-
-int bedLongIntersectGoCount(struct bedLong *listOne, char *goTermOne, struct bedLong *listTwo, char *goTermTwo, struct hash *retHitsOneHash, struct hash *retHitsTwoHash)
-{
-	/* returns the number of elements that overlap a gene with the goTerm */
-	/* both the bed lists should be sorted with bedLongCmp */
-	struct bedLong *bedLongOne = NULL, *bedLongTwo = NULL;
-	int count = 0;
-
-	bedLongOne = listOne;
-	bedLongTwo = listTwo;
-
-	if((retHitsOneHash != NULL && goTermOne == NULL) || (retHitsTwoHash != NULL && goTermTwo == NULL))
-		errAbort("request for names hit, but no go term to use as key");
-
-	while(bedLongOne != NULL && bedLongTwo != NULL)
-	{
-		if((goTermOne == NULL) || (bedLongHasGoTerm(bedLongOne, goTermOne)))
-		{
-			if((goTermTwo == NULL) || (bedLongHasGoTerm(bedLongTwo, goTermTwo)))
-			{
-				if(bedLongOverlap(bedLongOne,bedLongTwo))
+				for(i=0; i<testCount; i++)
 				{
-					if(retHitsOneHash != NULL)
+					if(row->results[i] != NULL)
 					{
-						if(bedLongOne->name == NULL){errAbort("Error: told to list names, but hit has not name");}
-						hashAdd(retHitsOneHash, goTermOne, cloneString(bedLongOne->name));
+						params = resultParams(row->results[i], tests[i]);
+						dyStringPrintf(string, "\t%s", params);
+						freeMem(params);
 					}
-					if(retHitsTwoHash != NULL)
-					{
-						if(bedLongTwo->name == NULL){errAbort("Error: told to list names, but hit has not name");}
-						hashAdd(retHitsTwoHash, goTermTwo, cloneString(bedLongTwo->name));
-					}
-					count++;
-					bedLongOne = bedLongOne->next;
+					else{dyStringPrintf(string, "\tNA\tNA\tNA\tNA\tNA");}
 				}
-				else if(bedLongCmpEnd(bedLongOne,bedLongTwo) < 0){bedLongOne = bedLongOne->next;}
-				else{bedLongTwo = bedLongTwo->next;}
 			}
-			else
+			if(goToEnglishHash != NULL){dyStringPrintf(string, "\t%s", (char *)hashMustFindVal(goToEnglishHash, row->term));}
+			if(optShowNames)
 			{
-				bedLongTwo = bedLongTwo->next;
+				for(i=0; i<testCount; i++)
+				{
+					dyStringPrintf(string, "\t");
+					if(row->results[i] == NULL){dyStringPrintf(string, "NA");}
+					for(hit=(row->results[i] != NULL) ? row->results[i]->hits : NULL; hit != NULL; hit=hit->next)
+						dyStringPrintf(string, "%s%s", hit->name, (hit->next != NULL) ? "," : "");
+				}
 			}
+			fprintf(stdout, "%s\n", string->string);
 		}
-		else
-		{
-			bedLongOne = bedLongOne->next;
-		}
+		for(row=rows; row != NULL; row=row->next)
+			freeMem(row->results);
+		slFreeList(&rows);
+		freeHash(&termHash);
 	}
-	return(count);
+	dyStringFree(&string);
+	freeHashAndVals(&goToEnglishHash);
 }
 
 
-int bedLongIntersectCount(struct bedLong *listOne, struct bedLong *listTwo)
+void showEdits(struct enrichEdits *edits, struct slName *namespaces, int batch)
 {
-	/* returns the number of elements from list one that have any overlap with list two */
-	/* both the bed lists should be sorted with bedLongCmp */
-	struct bedLong *futon = NULL, *bunk = NULL;
-	int count = 0;
-
-	futon = listOne;
-	bunk = listTwo;
+	struct enrichResult *results = enrichEditsResults(edits);
 
-	while(futon != NULL && bunk != NULL)
-	{
-		if(bedLongOverlap(futon,bunk))
-		{
-			count++;
-			futon = futon->next;
-		}
-		else if(bedLongCmpEnd(futon,bunk) < 0){futon = futon->next;}
-		else{bunk = bunk->next;}
-	}
-	return(count);
+	fprintf(stdout, "#edits\t%d\n", batch);
+	showResults(results, edits->context->options.test, namespaces);
+	enrichResultFreeList(&results);
 }
 
 
-long bedLongIntersectBases(struct bedLong *bedLongListA, struct bedLong *bedLongListB)
-/* returns the number of bases in the intersection of the two bed files */
-/* both the bed lists should be sorted with bedCmp */
+void applyEdits(char *editsFile, struct enrichContext *context, struct enrichElements *elements, struct slName *namespaces)
 {
-	struct bedLong *futon = NULL, *bunk = NULL;
-	char *prevChr = NULL;
-	long sum = 0, prevEnd = 0, overlapStart = 0, overlapEnd = 0;
+	/* Keeps the counts of the elements and moves them along as the elements */
+	/* in editsFile are added and removed, showing the results after each batch */
+	struct enrichEdits *edits = NULL;
+	struct lineFile *lf = NULL;
+	char *line = NULL, *row[5];
+	int wordCount = 0, batch = 0, pending = 0;
 
-	futon = bedLongListA;
-	bunk = bedLongListB;
-	prevChr = cloneString(futon->chrom);
+	verbose(2,"Indexing the domains for edits...\n");
+	edits = enrichEditsNew(context, elements);
 
-	while(futon != NULL && bunk != NULL)
+	lf = lineFileOpen(editsFile, TRUE);
+	while(lineFileNext(lf, &line, NULL))
 	{
-		if(strcmp(prevChr,futon->chrom) != 0)
-		{
-			prevChr = cloneString(futon->chrom);
-			prevEnd = 0;
-		}
-
-		if(bedLongOverlap(futon,bunk))
+		if(line[0] == '#'){continue;}
+		wordCount = chopByWhite(line, row, ArraySize(row));
+		if(wordCount == 0)
 		{
-			overlapStart = max(futon->chromStart,bunk->chromStart);
-			overlapEnd = min(futon->chromEnd,bunk->chromEnd);
-			if(overlapStart >= prevEnd)
-			{
-				sum += overlapEnd - overlapStart;
-			}
-			else if(overlapEnd > prevEnd)
-			{
-				sum += overlapEnd - prevEnd;
-			}
-			prevEnd = max(prevEnd,overlapEnd);
+			if(pending > 0){showEdits(edits, namespaces, ++batch);}
+			pending = 0;
+			continue;
 		}
-		if(bedLongCmpEnd(futon,bunk) <= 0){futon = futon->next;}
-		else{bunk = bunk->next;}
+		if(wordCount != 4 || (differentString(row[0],"+") && differentString(row[0],"-")))
+			errAbort("Error: line %d of %s should be '+ chrom start end' or '- chrom start end'", lf->lineIx, lf->fileName);
+		enrichEditsElement(edits, row[1], stringToLong(row[2]), stringToLong(row[3]), sameString(row[0],"+") ? 1 : -1);
+		pending++;
 	}
-	return(sum);
+	if(pending > 0){showEdits(edits, namespaces, ++batch);}
+	lineFileClose(&lf);
+	enrichEditsFree(&edits);
 }
 
-/* all poker chips in the bag */
-long bedLongBases(struct bedLong *bedLongList)
-/* sum the length of all bed files */
-/* overlap should only be counted once */
-/* bed list should be sorted with bedCmp */
+/*---------------------------------------------------------------------------*/
+
+int runTests(struct enrichContext *context, struct enrichElements *elements, struct spillSort *sort, struct elementAssignments *assigned, enum enrichTest *tests, struct enrichResult **results)
 {
-	struct bedLong *futon = NULL;
-	long sum = 0, prevEnd = 0;
-	char *prevChr = NULL;
-	prevChr = cloneString(bedLongList->chrom);
+	/* Runs the test of context, or with -binom and -hypergeo every test, */
+	/* and the null model with -largeSet, on one load of the genes and */
+	/* elements.  Returns how many tests were run. */
+	struct enrichContext *contexts[3];
+	int testCount = 0, i = 0;
 
-	for(futon=bedLongList; futon != NULL; futon=futon->next)
+	if(!(optBinom && optHypergeo))
 	{
-		if(strcmp(prevChr,futon->chrom) != 0)
-		{
-		prevChr = cloneString(futon->chrom);
-		prevEnd = 0;
-		}
-
-		if(futon->chromStart > prevEnd)
-		{
-			sum += (futon->chromEnd - futon->chromStart);
-		}
-		else if (futon->chromEnd > prevEnd)
-		{
-			sum += (futon->chromEnd - prevEnd);
-		}
-		prevEnd = max(prevEnd,futon->chromEnd);
+		tests[0] = context->options.test;
+		if(assigned != NULL){results[0] = enrichRunAssignments(context, assigned);}
+		else if(sort != NULL){results[0] = enrichRunSpill(context, sort);}
+		else{results[0] = enrichRun(context, elements);}
+		return(1);
 	}
-	return(sum);
-}
 
+	tests[testCount++] = enrichBinomial;
+	tests[testCount++] = enrichHypergeometric;
+	if(optLargeSet){tests[testCount++] = enrichNullModel;}
+	contexts[0] = context;
+	for(i=1; i<testCount; i++)
+		contexts[i] = enrichContextForTest(context, tests[i]);
 
-int countGoTermAppearanceInBedLong(struct bedLong *head, char *goTerm)
-{
-	struct bedLong *gene = NULL;
-	int count = 0;
-	for(gene=head; gene != NULL; gene=gene->next)
+	if(assigned != NULL)
 	{
-		if(bedLongHasGoTerm(gene, goTerm)){count++;}
+		for(i=0; i<testCount; i++)
+			results[i] = enrichRunAssignments(contexts[i], assigned);
 	}
-	return(count);
-}
-
+	else
+		enrichRunTests(contexts, testCount, elements, results);
 
-struct bedLong *findNameInBedLongList(struct bedLong *head, char *name)
-{
-	struct bedLong *curr = NULL;
-	for(curr=head; curr!=NULL; curr=curr->next)
-	{
-		if(sameString(curr->name, name))
-		{
-			return(curr);
-		}
-	}
-	return(NULL);
+	for(i=1; i<testCount; i++)
+		enrichContextFree(&contexts[i]);
+	return(testCount);
 }
 
 
-long int absDiff(long int a, long int b)
+void showBackgrounds(struct enrichContext *context, struct enrichElements *elements, char **noGapFiles, int noGapCount, struct slName *namespaces)
 {
-	if(a >= b){return(a-b);}
-	else{return(b-a);}
-}
-
+	/* The binomial test against every background, from one load of the */
+	/* genes and elements, in one table with a p-value column for each */
+	/* background file.  context has the first background. */
+	struct enrichContext **contexts = NULL;
+	struct enrichResult **results = NULL;
+	enum enrichTest *tests = NULL;
+	int i = 0;
 
-long int distanceBetweenBeds(struct bedLong *a, struct bedLong *b)
-{
-	if(differentString(a->chrom, b->chrom)){errAbort("Error: can not calculate distance between beds on separate chroms");}
-	if(bedLongOverlap(a,b)){return(0);}
-	else
+	AllocArray(contexts, noGapCount);
+	AllocArray(results, noGapCount);
+	AllocArray(tests, noGapCount);
+	contexts[0] = context;
+	enrichContextsForBackgroundFiles(context, noGapFiles+1, noGapCount-1, contexts+1);
+	for(i=0; i<noGapCount; i++)
+		tests[i] = enrichBinomial;
+	enrichRunBackgrounds(contexts, noGapCount, elements, results);
+	verbose(2,"Displaying Results...\n");
+	showMultiResults(context->goTerms, results, tests, noGapCount, noGapFiles, namespaces);
+
+	for(i=0; i<noGapCount; i++)
+		enrichResultFreeList(&results[i]);
+	for(i=1; i<noGapCount; i++)
+		enrichContextFree(&contexts[i]);
+	freeMem(contexts);
+	freeMem(results);
+	freeMem(tests);
+}
+
+
+void writeSlice(struct enrichContext *context, enum enrichTest *tests, struct enrichResult **results, int testCount, struct slName *namespaces)
+{
+	/* the results of this run's slice of the terms, for merge */
+	struct resultSlice rs;
+
+	ZeroVar(&rs);
+	rs.slice = context->options.termSlice;
+	rs.slices = context->options.termSlices;
+	rs.namespaces = optNamespaces;
+	rs.wantNames = optShowNames;
+	rs.testCount = testCount;
+	rs.tests = tests;
+	rs.namespaceList = namespaces;
+	rs.goTerms = context->goTerms;
+	rs.results = results;
+	resultSliceWrite(&rs, stdout);
+}
+
+
+void reportLoad(struct enrichContext *context, struct enrichElements *elements)
+{
+	/* what the library found in the input files while loading them */
+	struct enrichContextStats *stats = &context->stats;
+
+	if(elements != NULL && elements->repeatCount > 0)
+		verbose(1, "%d of %d elements have the same coordinates as another one\n", elements->repeatCount, elements->count);
+	if(context->options.minTermSize > 0 || context->options.maxTermSize > 0)
+		verbose(1, "Dropped %d of %d goTerms for being on fewer than %d or more than %d genes\n", stats->termsDropped, stats->termsSized, context->options.minTermSize, context->options.maxTermSize);
+	if(stats->termsSliced > 0)
+		verbose(1, "Testing goTerms %d to %d of %d, slice %d of %d\n", stats->sliceFirst+1, stats->sliceEnd, stats->termsSliced, context->options.termSlice+1, context->options.termSlices);
+	if(stats->regionsJoined > 0)
+		verbose(1, "Joined %d overlapping or touching okRegions, leaving %d disjoint ones\n", stats->regionsJoined, stats->regionsLeft);
+	if(stats->largeSetRepeats > 0)
+		verbose(1, "%d largeSet records have the same coordinates as another one\n", stats->largeSetRepeats);
+}
+
+
+void bedToGoStats(char *elementsInFile, char *genesInFile, char **noGapFiles, int noGapCount)
+{
+	struct enrichOptions options;
+	struct enrichContext *context = NULL;
+	struct enrichElements *elements = NULL;
+	struct spillSort *sort = NULL;
+	struct elementAssignments *assigned = NULL;
+	struct ontology *ontology = NULL;
+	struct enrichResult *results[3];
+	enum enrichTest tests[3];
+	struct slName *namespaces = NULL;
+	int testCount = 0;
+
+	enrichOptionsDefault(&options);
+	if(optGeneAssignments){options.test = enrichNone;}
+	else if(optBinom){options.test = enrichBinomial;}
+	else if(optLargeSet){options.test = enrichNullModel;}
+	else{options.test = enrichHypergeometric;}
+	options.maxExpansion = optMaxExpansion;
+	options.noExpansionOverlap = optNoExpansionOverlap;
+	options.guessTxStart = optGuessTxStart;
+	options.countUnassigned = optCountUnassigned;
+	options.bonferroni = optBonferroni;
+	options.maxPvalue = optMaxPvalue;
+	options.namespaces = optNamespaces;
+	options.minTermSize = optMinTermSize;
+	options.maxTermSize = optMaxTermSize;
+	options.threads = optThreads;
+	options.nearestGene = optNearestGene;
+	options.wantNames = optShowNames;
+	if(optShard != NULL)
 	{
-		return(min(absDiff(a->chromStart, b->chromEnd-1), absDiff(a->chromEnd-1, b->chromStart)));
+		/* the slices are corrected and cut off once they are merged */
+		if(sscanf(optShard, "%d/%d", &options.termSlice, &options.termSlices) != 2 || options.termSlices < 1 || options.termSlice < 1 || options.termSlice > options.termSlices)
+			errAbort("-shard must be i/n, with i from 1 to n");
+		options.termSlice--;
+		options.bonferroni = FALSE;
+		options.maxPvalue = 1;
 	}
-}
-
-
-struct slNameDouble *hypergeometricNullModelStyle(struct bedLong *elementsList, struct bedLong *largeSetList, struct bedLong *genesList, struct slName *goTerms, struct bedLong *okRegionsList, struct hash *paramsHash)
-{
-	int totalBalls = 0, whiteBalls = 0, totalPicks = 0, whiteBallsPicked = 0;
-	struct slName *term = NULL;
-	double pValue = 0;
-	struct slNameDouble *termAndPvalue = NULL;
-
-	verbose(2,"  Calculating numbers that will not change in loop\n");
-	totalBalls = slCount(largeSetList);
-	totalPicks = bedLongIntersectCount(largeSetList,elementsList);
-
-	verbose(2,"  Entering Loop\n");
-	for(term=goTerms; term!=NULL; term=term->next)
+	if(optApprox > 0)
 	{
-		whiteBalls = bedLongIntersectGoCount(largeSetList, NULL, genesList, term->name, NULL, NULL);
-		whiteBallsPicked = bedLongIntersectThreeGoCount(largeSetList, NULL, genesList, term->name, elementsList, NULL);
-		if(paramsHash != NULL){hashAdd(paramsHash,term->name,hyperParamsToTabString(whiteBallsPicked,totalPicks,whiteBalls,totalBalls));}
-		//pValue = hyperGeoPValue(whiteBallsPicked, totalPicks, whiteBalls, totalBalls);
-		if(whiteBallsPicked == 0){pValue = 1;}
-		else{pValue = gsl_cdf_hypergeometric_Q((unsigned int)whiteBallsPicked-1, (unsigned int)whiteBalls, (unsigned int)totalBalls-whiteBalls, (unsigned int)totalPicks);}
-		struct slNameDouble *temp = createSlNameDouble(term->name,pValue);
-		slAddHead(&termAndPvalue,temp);
+		/* the estimates are corrected and cut off once the sample settles */
+		options.bonferroni = FALSE;
+		options.maxPvalue = 1;
 	}
-	verbose(2,"  Done With Loop\n");
-
-	return(termAndPvalue);
-}
 
-
-struct slNameDouble *hypergeometricStyle(struct bedLong *elementsList, struct bedLong *genesList, struct slName *goTerms, struct bedLong *okRegionsList, struct hash *retHitsHash, struct hash *paramsHash)
-{
-	int totalBalls = 0, whiteBalls = 0, totalPicks = 0, whiteBallsPicked = 0;
-	struct slName *term = NULL;
-	double pValue = 0;
-	struct slNameDouble *termAndPvalue = NULL;
-
-	verbose(2,"  Calculating numbers that will not change in loop\n");
-	totalBalls = slCount(genesList);
-
-	verbose(2,"  Entering Loop\n");
-	for(term=goTerms; term!=NULL; term=term->next)
+	if(optMemLimit > 0)
 	{
-		whiteBalls = countGoTermAppearanceInBedLong(genesList,term->name);
-		totalPicks = bedLongIntersectCount(genesList,elementsList);
-		whiteBallsPicked = bedLongIntersectGoCount(genesList, term->name, elementsList, NULL, retHitsHash, NULL);
-		if(paramsHash != NULL){hashAdd(paramsHash,term->name,hyperParamsToTabString(whiteBallsPicked,totalPicks,whiteBalls,totalBalls));}
-		//pValue = hyperGeoPValue(whiteBallsPicked, totalPicks, whiteBalls, totalBalls);
-		if(whiteBallsPicked == 0){pValue = 1;}
-		else{pValue = gsl_cdf_hypergeometric_Q((unsigned int)whiteBallsPicked-1, (unsigned int)whiteBalls, (unsigned int)totalBalls-whiteBalls, (unsigned int)totalPicks);}
-		struct slNameDouble *temp = createSlNameDouble(term->name,pValue);
-		slAddHead(&termAndPvalue,temp);
+		sort = spillSortLoad(elementsInFile, (long)optMemLimit * 1024 * 1024, optTmpDir);
+		context = enrichContextLoad(genesInFile, noGapFiles[0], optLargeSet, &options);
 	}
-	verbose(2,"  Done With Loop\n");
-
-	return(termAndPvalue);
-}
-
+	else if(optFromAssignments)
+	{
+		context = enrichContextLoad(genesInFile, noGapFiles[0], NULL, &options);
+		assigned = enrichAssignmentsLoad(context, elementsInFile);
+	}
+	else
+		context = enrichContextLoadWithElements(elementsInFile, optGeneAssignments, &elements, genesInFile, noGapFiles[0], optLargeSet, &options);
+	reportLoad(context, elements);
+	namespaces = enrichNamespaceList(context);
 
-struct slNameDouble *binomialStyle(struct bedLong *elementsList, struct bedLong *genesList, struct slName *goTerms, struct bedLong *okRegionsList, struct hash *retHitsHash, struct hash *paramsHash)
-{
-	long totalBalls = 0, whiteBalls = 0, totalPicks = 0, whiteBallsPicked = 0;
-	struct slName *term = NULL;
-	double prob = 0, pValue = 0;
-	struct slNameDouble *termAndPvalue = NULL;
-
-	verbose(2,"  Calculating numbers that will not change in loop\n");
-	totalBalls = bedLongBases(okRegionsList);
-	//totalPicks = slCount(elementsList);
-	if(optCountUnassigned){totalPicks = slCount(elementsList);}
-	else{totalPicks = bedLongIntersectCount(elementsList,genesList);}
-
-	verbose(2,"  Entering Loop\n");
-	for(term=goTerms; term!=NULL; term=term->next)
+	if(optGeneAssignments)
 	{
-		whiteBalls = bedLongIntersectGoBases(genesList, term->name, okRegionsList);
-		whiteBallsPicked = bedLongIntersectGoCount(elementsList, NULL, genesList, term->name, NULL, retHitsHash);
-		prob = ((double)whiteBalls)/((double)totalBalls);
-		if(paramsHash != NULL){hashAdd(paramsHash,term->name,binomParamsToTabString(prob,whiteBallsPicked,totalPicks));}
-		//pValue = binomPValue(whiteBallsPicked,totalPicks,prob);
-		if(whiteBallsPicked == 0){pValue = 1;}
-		else{pValue = gsl_cdf_binomial_Q((unsigned int)whiteBallsPicked-1, prob, (unsigned int)totalPicks);}
-		struct slNameDouble *temp = createSlNameDouble(term->name,pValue);
-		slAddHead(&termAndPvalue,temp);
+		enrichAssignments(context, elements, stdout);
+		if(optSaveAssignments != NULL){enrichAssignmentsSave(context, elements, optSaveAssignments);}
 	}
-	verbose(2,"  Done With Loop\n");
+	else if(noGapCount > 1)
+		showBackgrounds(context, elements, noGapFiles, noGapCount, namespaces);
+	else if(optApprox > 0)
+	{
+		results[0] = enrichRunApprox(context, elements, optApprox, 10);
+		options.bonferroni = optBonferroni;
+		options.maxPvalue = optMaxPvalue;
+		results[0] = enrichResultsCorrect(results[0], &options);
+		verbose(2,"Displaying Results...\n");
+		showResults(results[0], options.test, namespaces);
+	}
+	else if(optOntology != NULL)
+	{
+		ontology = ontologyLoad(optOntology);
+		results[0] = enrichRunOntology(context, elements, ontology, sameString(optOntologyMethod, "weight") ? enrichWeight : enrichElim);
+		verbose(2,"Displaying Results...\n");
+		showResults(results[0], options.test, namespaces);
+	}
+	else
+	{
+		testCount = runTests(context, elements, sort, assigned, tests, results);
+		verbose(2,"Displaying Results...\n");
+		if(optShard != NULL){writeSlice(context, tests, results, testCount, namespaces);}
+		else if(testCount > 1){showMultiResults(context->goTerms, results, tests, testCount, NULL, namespaces);}
+		else{showResults(results[0], tests[0], namespaces);}
+	}
+
+	if(optEdits != NULL)
+		applyEdits(optEdits, context, elements, namespaces);
 
-	return(termAndPvalue);
+	//enrichResultFreeList(&results);
+	//enrichElementsFree(&elements);
+	//spillSortFree(&sort);
+	//elementAssignmentsFree(&assigned);
+	//enrichContextFree(&context);
 }
 
-void assignmentStyle(struct bedLong *elementsList, struct bedLong *genesList, struct bedLong *okRegionsList, struct bedLong *unexpandedGeneList)
-{
-	struct bedLong *bedLongOne = NULL, *bedLongTwo = NULL;
 
-	bedLongOne = elementsList;
-	bedLongTwo = genesList;
+void mergeSlices(int fileCount, char *fileNames[])
+{
+	/* Reads the slice files of every slice of one run, in any order, and */
+	/* shows the results as the run would have without -shard */
+	struct resultSlice **slices = NULL, *rs = NULL, *first = NULL;
+	struct slName *goTerms = NULL;
+	struct enrichResult *results[3];
+	struct enrichOptions options;
+	int sliceCount = 0, i = 0, t = 0;
 
-	while(bedLongOne != NULL && bedLongTwo != NULL)
+	for(i=0; i<fileCount; i++)
 	{
-		if(bedLongOverlap(bedLongOne,bedLongTwo))
+		rs = resultSliceRead(fileNames[i]);
+		if(slices == NULL)
 		{
-			fprintf(stdout,"%s\t%ld\t%ld\t%s\t%s\t%ld\n",bedLongOne->chrom, bedLongOne->chromStart, bedLongOne->chromEnd, bedLongOne->name, bedLongTwo->name, distanceBetweenBeds(bedLongOne, findNameInBedLongList(unexpandedGeneList, bedLongTwo->name)));
-			bedLongOne = bedLongOne->next;
+			first = rs;
+			sliceCount = rs->slices;
+			AllocArray(slices, sliceCount);
 		}
-		else if(bedLongCmpEnd(bedLongOne,bedLongTwo) < 0)
+		if(rs->slices != sliceCount || rs->testCount != first->testCount || rs->namespaces != first->namespaces || rs->wantNames != first->wantNames)
+			errAbort("Error: %s is not a slice of the same run as %s", fileNames[i], fileNames[0]);
+		for(t=0; t<rs->testCount; t++)
 		{
-			fprintf(stdout,"%s\t%ld\t%ld\t%s\tNONE\tNONE\n",bedLongOne->chrom, bedLongOne->chromStart, bedLongOne->chromEnd, bedLongOne->name);
-			bedLongOne = bedLongOne->next;
+			if(rs->tests[t] != first->tests[t]){errAbort("Error: %s is not a slice of the same run as %s", fileNames[i], fileNames[0]);}
 		}
-		else{bedLongTwo = bedLongTwo->next;}
+		if(slices[rs->slice] != NULL){errAbort("Error: %s and another file are both slice %d of %d", fileNames[i], rs->slice+1, sliceCount);}
+		slices[rs->slice] = rs;
 	}
-	while(bedLongOne != NULL)
+	for(i=0; i<sliceCount; i++)
 	{
-		fprintf(stdout,"%s\t%ld\t%ld\t%s\tNONE\tNONE\n",bedLongOne->chrom, bedLongOne->chromStart, bedLongOne->chromEnd, bedLongOne->name);
-		bedLongOne = bedLongOne->next;
+		if(slices[i] == NULL){errAbort("Error: slice %d of %d is missing", i+1, sliceCount);}
 	}
-}
+	if(optShowNames && !first->wantNames){errAbort("Error: the slices were not run with -showNames");}
 
-/*---------------------------------------------------------------------------*/
-
-void bedToGoStats(char *elementsInFile, char *genesInFile, char *noGapInFile)
-{
-	struct bedLong *nonexpandedList = NULL, *elementsBedLongList = NULL, *genesBedLongList = NULL, *okRegionsBedLongList = NULL, *largeSet = NULL;
-	struct slName *goTerms = NULL;
-	struct slNameDouble *results = NULL;
-	struct hash *hitsHash = NULL, *paramsHash = NULL;
-
-	elementsBedLongList = filenameToBedLong(elementsInFile);
-	genesBedLongList = filenameToBedLong(genesInFile);
-	okRegionsBedLongList = filenameToBedLong(noGapInFile);
-	if(optLargeSet != NULL){largeSet = filenameToBedLong(optLargeSet);}
-
-	if(optGuessTxStart)
-		bedLongGuessTxStart(genesBedLongList);
-
-	slSort(&elementsBedLongList, bedLongCmp);
-	slSort(&genesBedLongList, bedLongCmp);
-	slSort(&okRegionsBedLongList, bedLongCmp);
-	if(optLargeSet != NULL){slSort(&largeSet, bedLongCmp);}
-
-	goTerms = extractUniqGoTermsFromBedLong(genesBedLongList);
-
-	//expand gene list
-	nonexpandedList = cloneBedLongList(genesBedLongList);
-	if(optMaxExpansion != 0)
+	//the slices are in goTerm order, so joining them gives the results of one run
+	for(t=0; t<first->testCount; t++)
 	{
-		verbose(2,"Expanding list\n");
-		long maxExp = (long)optMaxExpansion;
-		if(optNoExpansionOverlap)
-			expandBedLongListToNeighbor(genesBedLongList,maxExp);
-		else
-			expandBedLongListByDistance(genesBedLongList,maxExp);
+		enrichOptionsDefault(&options);
+		options.test = first->tests[t];
+		options.bonferroni = optBonferroni;
+		options.maxPvalue = optMaxPvalue;
+		results[t] = NULL;
+		for(i=sliceCount-1; i>=0; i--)
+		{
+			results[t] = slCat(slices[i]->results[t], results[t]);
+			slices[i]->results[t] = NULL;
+		}
+		results[t] = enrichResultsCorrect(results[t], &options);
 	}
-
-	//showBedLongList(genesBedLongList);
-
-	if(optShowNames)
-		hitsHash = newHash(9);
-
-	if(optShowParams)
-		paramsHash = newHash(9);
-
-	//do math
-	verbose(2,"Calculating Stats...\n");
-
-	if(optGeneAssignments)
-		assignmentStyle(elementsBedLongList,genesBedLongList,okRegionsBedLongList,nonexpandedList);
-	else if(optBinom)
-		results = binomialStyle(elementsBedLongList,genesBedLongList,goTerms,okRegionsBedLongList,hitsHash,paramsHash);
-	else if(optHypergeo && optLargeSet)
-		results = hypergeometricNullModelStyle(elementsBedLongList,largeSet,genesBedLongList,goTerms,okRegionsBedLongList,paramsHash);
-	else if(optHypergeo && !optLargeSet)
-		results = hypergeometricStyle(elementsBedLongList,genesBedLongList,goTerms,okRegionsBedLongList,hitsHash,paramsHash);
-	else
-		errAbort("Error: end of if statement should not be reached");
-
-	if(optBonferroni)
+	for(i=sliceCount-1; i>=0; i--)
 	{
-		verbose(2,"Correcting Results For Multiple Tests...\n");
-		bonferroniCorrection(results,slCount(goTerms));
+		goTerms = slCat(slices[i]->goTerms, goTerms);
+		slices[i]->goTerms = NULL;
 	}
 
-	verbose(2,"Displaying Results...\n");
-	displayResults(results,hitsHash,paramsHash);
+	optNamespaces = first->namespaces;
+	if(first->testCount > 1){showMultiResults(goTerms, results, first->tests, first->testCount, NULL, first->namespaceList);}
+	else{showResults(results[0], first->tests[0], first->namespaceList);}
 
-	//bedLongFreeList(&elementsBedLongList);
-	//bedLongFreeList(&genesBedLongList);
-	//bedLongFreeList(&okRegionsBedLongList);
+	for(t=0; t<first->testCount; t++)
+		enrichResultFreeList(&results[t]);
+	slNameFreeList(&goTerms);
+	for(i=0; i<sliceCount; i++)
+		resultSliceFree(&slices[i]);
+	freeMem(slices);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -896,7 +830,17 @@ int main(int argc, char *argv[])
 /* Process command line. */
 {
 	optionInit(&argc, argv, optionSpecs);
-	if (argc != 4)
+	if (argc >= 3 && sameString(argv[1], "merge"))
+	{
+		optBonferroni = optionExists("bonferroni");
+		optMaxPvalue = optionDouble("maxPvalue",optMaxPvalue);
+		optGoTermToEnglish = optionVal("goTermToEnglish", NULL);
+		optShowNames = optionExists("showNames");
+		optShowParams = optionExists("showParams");
+		mergeSlices(argc-2, argv+2);
+		return 0;
+	}
+	if (argc < 4)
 		usage();
 
 	optGeneAssignments = optionExists("geneAssignments");
@@ -912,16 +856,65 @@ int main(int argc, char *argv[])
 	optShowParams = optionExists("showParams");
 	optLargeSet = optionVal("largeSet", NULL);
 	optCountUnassigned = optionExists("countUnassigned");
-	if (optBinom && optHypergeo)
-		errAbort("You can't use both -binom and -hypergeo");
+	optThreads = optionInt("threads",optThreads);
+	optEdits = optionVal("edits", NULL);
+	optMinTermSize = optionInt("minTermSize",optMinTermSize);
+	optMaxTermSize = optionInt("maxTermSize",optMaxTermSize);
+	optNamespaces = optionExists("namespaces");
+	optMemLimit = optionInt("memLimit",optMemLimit);
+	optTmpDir = optionVal("tmpDir", optTmpDir);
+	optSaveAssignments = optionVal("saveAssignments", NULL);
+	optFromAssignments = optionExists("fromAssignments");
+	optShard = optionVal("shard", NULL);
+	optOntology = optionVal("ontology", NULL);
+	optOntologyMethod = optionVal("ontologyMethod", optOntologyMethod);
+	optApprox = optionDouble("approx", optApprox);
+	optNearestGene = optionExists("nearestGene");
 	if (!optBinom && !optHypergeo && !optGeneAssignments)
 		errAbort("You must use either -binom or -hypergeo");
 	if (optLargeSet && !optHypergeo)
 		errAbort("You must use either -hypergeo with -largeSet");
-	if (optLargeSet && optShowNames)
-		errAbort("You can not use -showNames with -largeSet");
-
-	bedToGoStats(argv[1],argv[2],argv[3]);
+	if (optBinom && optHypergeo && (optEdits || optMemLimit > 0))
+		errAbort("You can not use -edits or -memLimit with both -binom and -hypergeo");
+	if (optThreads < 1)
+		errAbort("-threads must be at least 1");
+	if (optEdits && (optGeneAssignments || optShowNames))
+		errAbort("You can not use -edits with -geneAssignments or -showNames");
+	if (optMemLimit < 0)
+		errAbort("-memLimit can not be negative");
+	if (optMemLimit > 0 && (optGeneAssignments || optEdits))
+		errAbort("You can not use -memLimit with -geneAssignments or -edits");
+	if (optSaveAssignments && !optGeneAssignments)
+		errAbort("You must use -geneAssignments with -saveAssignments");
+	if (optNearestGene && !optGeneAssignments)
+		errAbort("You must use -geneAssignments with -nearestGene");
+	if (optFromAssignments && (optGeneAssignments || optLargeSet || optEdits || optMemLimit > 0))
+		errAbort("You can not use -fromAssignments with -geneAssignments, -largeSet, -edits or -memLimit");
+	if (optShard && (optGeneAssignments || optEdits))
+		errAbort("You can not use -shard with -geneAssignments or -edits");
+	if (optShard && (optBonferroni || optionExists("maxPvalue")))
+		errAbort("-bonferroni and -maxPvalue are given to merge, not to each -shard");
+	if (optOntology && (optBinom || optLargeSet))
+		errAbort("-ontology only works with -hypergeo on its own");
+	if (optOntology && (optGeneAssignments || optEdits || optMemLimit > 0 || optFromAssignments || optShard))
+		errAbort("You can not use -ontology with -geneAssignments, -edits, -memLimit, -fromAssignments or -shard");
+	if (differentString(optOntologyMethod, "elim") && differentString(optOntologyMethod, "weight"))
+		errAbort("-ontologyMethod must be elim or weight");
+	if (optionExists("ontologyMethod") && !optOntology)
+		errAbort("-ontologyMethod needs -ontology");
+	if (optApprox < 0 || optApprox > 1)
+		errAbort("-approx must be a fraction from 0 to 1");
+	if (optApprox > 0 && (!optBinom || optHypergeo))
+		errAbort("-approx only works with -binom on its own");
+	if (optApprox > 0 && (optGeneAssignments || optEdits || optMemLimit > 0 || optFromAssignments || optShard || optOntology || optShowNames))
+		errAbort("You can not use -approx with -geneAssignments, -edits, -memLimit, -fromAssignments, -shard, -ontology or -showNames");
+
+	if (argc > 4 && (!optBinom || optHypergeo))
+		errAbort("Several noGaps files only work with -binom on its own, the other tests do not depend on them");
+	if (argc > 4 && (optGeneAssignments || optEdits || optMemLimit > 0 || optFromAssignments || optShard || optOntology || optApprox > 0))
+		errAbort("You can not use several noGaps files with -geneAssignments, -edits, -memLimit, -fromAssignments, -shard, -ontology or -approx");
+
+	bedToGoStats(argv[1],argv[2],argv+3,argc-3);
 	return 0;
 }
 
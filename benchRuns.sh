@@ -0,0 +1,267 @@
+#!/bin/sh
+#
+# benchRuns.sh
+#
+# Times bedToEnrichments on a made up genome of 20 chromosomes with
+# 20000 genes on 15000 goTerms, so a change can be measured from the
+# command line down.  Given a second binary, the same runs are timed with
+# it too and the outputs are compared, which is how the numbers in the
+# commit messages were made: the binary built before a change against
+# the one built after it.
+#
+# usage: benchRuns.sh [-reps=N] [-scale=N] [-keep=dir] bedToEnrichments [baseBedToEnrichments] [case ...]
+#    -reps=N     runs of each case, the fastest is shown (default 3)
+#    -scale=N    multiplies the number of elements (default 1, about 200000)
+#    -keep=dir   make the inputs in dir and leave them there afterwards
+# With no cases named every case is run.  "make bench" runs them all on
+# the bedToEnrichments that was just built.
+#
+
+reps=3
+scale=1
+keep=
+while true; do
+	case "$1" in
+		-reps=*) reps=${1#-reps=}; shift ;;
+		-scale=*) scale=${1#-scale=}; shift ;;
+		-keep=*) keep=${1#-keep=}; shift ;;
+		*) break ;;
+	esac
+done
+if [ $# -lt 1 ]; then
+	sed -n '3,21p' $0 | sed 's/^# \{0,1\}//'
+	exit 255
+fi
+binary=$(cd $(dirname $1) && pwd)/$(basename $1); shift
+base=
+if [ $# -gt 0 ] && [ -x "$1" ] && [ -f "$1" ]; then
+	base=$(cd $(dirname $1) && pwd)/$(basename $1); shift
+fi
+
+if [ -n "$keep" ]; then
+	dir=$keep
+	mkdir -p $dir
+else
+	dir=$(mktemp -d ${TMPDIR:-/tmp}/benchRuns.XXXXXX)
+	trap 'rm -rf $dir' 0
+fi
+cd $dir || exit 255
+
+
+#---------------------------------------------------------------------------
+# the inputs, the same every time for a given scale
+
+rm -f *.bed *.bedLong *.txt *.assign
+awk -v scale=$scale 'BEGIN {
+	srand(1);
+	chroms = 20; chromSize = 100000000; genes = 20000; terms = 15000;
+	for(c=1; c<=chroms; c++)
+	{
+		chrom = "chr" c;
+		# genes, a few on many terms and many on a few, with the big
+		# terms on many genes and most terms on very few
+		for(g=0; g<genes/chroms; g++)
+		{
+			start = int(rand() * (chromSize - 200000));
+			termCount = 1 + int(rand() * rand() * 40);
+			list = "";
+			for(t=0; t<termCount; t++)
+				list = list (t ? "," : "") sprintf("GO:%07d", int(terms * rand() * rand() * rand()));
+			printf("%s\t%d\t%d\tgene%d_%d\t%s\t%s\n", chrom, start, start + 1000 + int(rand() * 100000), c, g, list, (rand() < 0.5) ? "+" : "-") > "genes.bedLong";
+		}
+		# sequenced pieces of 1 to 9Mb with gaps of up to 100kb between them
+		for(p=0; p<chromSize; p=e + int(rand() * 100000))
+		{
+			e = p + 1000000 + int(rand() * 8000000);
+			if(e > chromSize){e = chromSize;}
+			printf("%s\t%d\t%d\n", chrom, p, e) > "noGaps.bed";
+		}
+		# a background cut into pieces of up to 20kb, like a mappability track
+		for(p=0; p<chromSize; p=e + int(rand() * 2000))
+		{
+			e = p + 1 + int(rand() * 20000);
+			if(e > chromSize){e = chromSize;}
+			printf("%s\t%d\t%d\n", chrom, p, e) > "noGapsFine.bed";
+		}
+		# the largeSet, with a fifth of it holding an element
+		for(i=0; i<5 * scale * 200000 / chroms; i++)
+		{
+			s = int(rand() * (chromSize - 3000));
+			e = s + 1 + int(rand() * 2000);
+			printf("%s\t%d\t%d\n", chrom, s, e) > "largeSet.bed";
+			if(rand() < 0.2)
+			{
+				a = s + int(rand() * (e - s));
+				b = a + 1 + int(rand() * 200);
+				if(b > e){b = e;}
+				printf("%s\t%d\t%d\n", chrom, a, b) > "elements.bed";
+				printf("%s\t%d\t%d\tel%d_%d\n", chrom, a, b, c, i) > "elementsNamed.bed";
+			}
+		}
+	}
+}'
+
+# a small set, one element in a thousand, for the joins where the other
+# side is far the bigger
+awk 'NR % 1000 == 1' elements.bed > elementsSmall.bed
+
+# half of the elements given twice, the way two callers' peaks pooled
+# without merging come in, and a background of two tracks laid over
+# each other
+awk '{print} NR % 2 == 0 {print}' elements.bed > elementsRepeated.bed
+cat noGaps.bed noGapsFine.bed > noGapsOverlapping.bed
+
+# every element as one base, its first
+awk 'BEGIN {OFS = "\t"} {print $1, $2, $2 + 1}' elements.bed > elementsPoints.bed
+
+# GO as it is usually given: an ontology, here a random tree, with the
+# genes annotated to its leaves and then to every ancestor of those, so
+# a term with one child and no genes of its own has its child's genes.
+# elementsHot.bed is the small set with an element on a few leaves' genes
+awk 'BEGIN {
+	srand(2);
+	chroms = 20; chromSize = 100000000; genes = 20000; terms = 15000;
+	for(t=1; t<terms; t++)
+	{
+		parent[t] = int(t * rand());
+		children[parent[t]]++;
+		printf("GO:%07d\tGO:%07d\n", t, parent[t]) > "ontology.txt";
+	}
+	for(t=0; t<terms; t++)
+		if(!children[t]){leaf[leafCount++] = t;}
+	for(c=1; c<=chroms; c++)
+	{
+		for(g=0; g<genes/chroms; g++)
+		{
+			start = int(rand() * (chromSize - 200000));
+			leafTerms = 1 + int(rand() * rand() * 10);
+			list = "";
+			hot = 0;
+			split("", seen);
+			for(k=0; k<leafTerms; k++)
+			{
+				l = int(rand() * leafCount);
+				hot = hot || (l % 25 == 0);
+				for(t=leaf[l]; !(t in seen); t=parent[t])
+				{
+					seen[t] = 1;
+					list = list (list == "" ? "" : ",") sprintf("GO:%07d", t);
+					if(t == 0){break;}
+				}
+			}
+			end = start + 1000 + int(rand() * 100000);
+			strand = (rand() < 0.5) ? "+" : "-";
+			printf("chr%d\t%d\t%d\tgene%d_%d\t%s\t%s\n", c, start, end, c, g, list, strand) > "genesPropagated.bedLong";
+			# an element at the start of every gene on one of the hot
+			# leaves, a twenty-fifth of them, for elim to find
+			if(hot)
+			{
+				tss = (strand == "+") ? start : end - 10;
+				printf("chr%d\t%d\t%d\n", c, tss, tss + 10) > "elementsHot.bed";
+			}
+		}
+	}
+}'
+# elementsSignal.bed is the elements with 20 more around each of those
+# starts, enough of a signal for -approx to settle on
+awk -v scale=$scale 'BEGIN {srand(3); OFS = "\t"} {
+	for(i=0; i<20 * scale; i++)
+	{
+		s = $2 - 5000 + int(rand() * 10000);
+		if(s < 0){s = 0;}
+		print $1, s, s + 1 + int(rand() * 200);
+	}
+}' elementsHot.bed | cat elements.bed - > elementsSignal.bed
+cat elementsSmall.bed >> elementsHot.bed
+
+
+#---------------------------------------------------------------------------
+# the runs
+
+timeRun()
+# timeRun out command..., the milliseconds one run takes, or fail
+{
+	out=$1; shift
+	start=$(date +%s%N)
+	"$@" > $out 2> run.err || { echo fail; return; }
+	end=$(date +%s%N)
+	echo $(( (end - start) / 1000000 ))
+}
+
+faster()
+# the smaller of two times, the first of which may not be set yet
+{
+	if [ "$1" = fail ] || [ "$2" = fail ]; then echo fail
+	elif [ -z "$1" ] || [ $2 -lt $1 ]; then echo $2
+	else echo $1
+	fi
+}
+
+seconds()
+{
+	if [ "$1" = fail ]; then echo fail
+	else awk -v ms=$1 'BEGIN {printf("%.3f\n", ms / 1000)}'
+	fi
+}
+
+runCase()
+# runCase name options..., the fastest of $reps runs of one case, taking
+# turns with the base binary so that both see the same load on the machine
+{
+	name=$1; shift
+	if [ -n "$wanted" ] && ! echo " $wanted " | grep -q " $name "; then return; fi
+	now=
+	before=
+	r=0
+	while [ $r -lt $reps ]; do
+		now=$(faster "$now" $(timeRun now.out $binary "$@"))
+		if [ -n "$base" ]; then before=$(faster "$before" $(timeRun before.out $base "$@")); fi
+		r=$((r + 1))
+	done
+	if [ -z "$base" ]; then
+		printf "%-16s %8s\n" $name $(seconds $now)
+		return
+	fi
+	if [ "$now" = fail ] || [ "$before" = fail ]; then same=-
+	elif cmp -s before.out now.out; then same=same
+	else same=DIFF
+	fi
+	speedup=$(awk -v a=$before -v b=$now 'BEGIN {if(a == "fail" || b == "fail" || b == 0){print "-"} else {printf("%.2fx\n", a / b)}}')
+	printf "%-16s %8s %8s %8s %6s\n" $name $(seconds $before) $(seconds $now) $speedup $same
+}
+
+wanted="$*"
+if [ -z "$base" ]; then
+	printf "%-16s %8s\n" case seconds
+else
+	printf "%-16s %8s %8s %8s %6s\n" case before after speedup output
+fi
+runCase binom elements.bed genes.bedLong noGaps.bed -binom -maxPvalue=1
+runCase hypergeo elements.bed genes.bedLong noGaps.bed -hypergeo -maxPvalue=1
+runCase nullModel elements.bed genes.bedLong noGaps.bed -hypergeo -largeSet=largeSet.bed -maxPvalue=1
+runCase assignments elementsNamed.bed genes.bedLong noGaps.bed -geneAssignments
+runCase memLimit elements.bed genes.bedLong noGaps.bed -hypergeo -maxPvalue=1 -memLimit=1
+runCase propagated elements.bed genesPropagated.bedLong noGaps.bed -hypergeo -maxPvalue=1
+runCase propagatedBinom elements.bed genesPropagated.bedLong noGaps.bed -binom -maxPvalue=1
+runCase fineBinom elements.bed genes.bedLong noGapsFine.bed -binom -maxPvalue=1
+runCase bothNoGaps elements.bed genes.bedLong noGaps.bed noGapsFine.bed -binom -maxPvalue=1
+runCase allTests elements.bed genes.bedLong noGaps.bed -binom -hypergeo -largeSet=largeSet.bed -maxPvalue=1
+runCase smallBinom elementsSmall.bed genes.bedLong noGaps.bed -binom -maxPvalue=1
+runCase smallNullModel elementsSmall.bed genes.bedLong noGaps.bed -hypergeo -largeSet=largeSet.bed -maxPvalue=1
+runCase smallNames elementsSmall.bed genes.bedLong noGaps.bed -binom -hypergeo -largeSet=largeSet.bed -showNames -maxPvalue=1
+runCase bothTests elements.bed genes.bedLong noGaps.bed -binom -hypergeo -maxPvalue=1
+runCase saveAssignments elements.bed genes.bedLong noGaps.bed -geneAssignments -saveAssignments=saved.assign
+if [ ! -f saved.assign ]; then $binary elements.bed genes.bedLong noGaps.bed -geneAssignments -saveAssignments=saved.assign > /dev/null 2>&1; fi
+runCase fromAssignments saved.assign genes.bedLong noGaps.bed -binom -hypergeo -fromAssignments -maxPvalue=1
+runCase pointBinom elementsPoints.bed genes.bedLong noGaps.bed -binom -maxPvalue=1
+runCase pointHypergeo elementsPoints.bed genes.bedLong noGaps.bed -hypergeo -maxPvalue=1
+runCase pointAssignments elementsPoints.bed genes.bedLong noGaps.bed -geneAssignments
+runCase pointNearest elementsPoints.bed genes.bedLong noGaps.bed -geneAssignments -nearestGene
+runCase approx elements.bed genes.bedLong noGaps.bed -binom -approx=0.1 -maxPvalue=1
+runCase signalBinom elementsSignal.bed genesPropagated.bedLong noGaps.bed -binom -maxPvalue=1
+runCase signalApprox elementsSignal.bed genesPropagated.bedLong noGaps.bed -binom -approx=0.1 -maxPvalue=1
+runCase repeatedBinom elementsRepeated.bed genes.bedLong noGapsOverlapping.bed -binom -maxPvalue=1
+runCase repeatedHyper elementsRepeated.bed genes.bedLong noGapsOverlapping.bed -hypergeo -maxPvalue=1
+runCase hot elementsHot.bed genesPropagated.bedLong noGaps.bed -hypergeo -maxPvalue=0.01
+runCase elim elementsHot.bed genesPropagated.bedLong noGaps.bed -hypergeo -ontology=ontology.txt -maxPvalue=0.01
+runCase weight elementsHot.bed genesPropagated.bedLong noGaps.bed -hypergeo -ontology=ontology.txt -ontologyMethod=weight -maxPvalue=0.01
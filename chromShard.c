@@ -0,0 +1,448 @@
+/*
+
+chromShard.c
+
+Cut the input lists up by chromosome, and cut very large chromosomes
+up further at places where no domain, element or largeSet record
+spans the cut, so that no single chromosome sets the run time.
+
+*/
+
+#include "common.h"
+#include "hash.h"
+#include "bedLong.h"
+#include "chromShard.h"
+
+
+static struct chromShard *shardForChrom(struct hash *shardHash, struct chromShard **pShardList, char *chrom)
+{
+	struct chromShard *shard = hashFindVal(shardHash, chrom);
+	if(shard == NULL)
+	{
+		AllocVar(shard);
+		shard->chrom = cloneString(chrom);
+		hashAdd(shardHash, chrom, shard);
+		slAddHead(pShardList, shard);
+	}
+	return(shard);
+}
+
+
+int chromShardCmp(const void *va, const void *vb)
+/* orders shards by chromosome name, for slSort */
+{
+	const struct chromShard *a = *((struct chromShard **)va);
+	const struct chromShard *b = *((struct chromShard **)vb);
+	return(strcmp(a->chrom, b->chrom));
+}
+
+
+struct chromShard *chromShardsFromLists(struct bedLong *elements, struct packedChrom *packedElements, struct bedLong *genes, struct bedLong *okRegions, struct bedLong *largeSet, struct packedChrom *packedLargeSet)
+/* Hand every record of the lists to the shard for its chromosome.  The lists are */
+/* taken apart to do this.  Elements and largeSet may come either as a list or */
+/* already packed by chromosome.  The shards come back ordered the same way */
+/* bedLongCmp orders chromosomes. */
+{
+	struct hash *shardHash = newHash(8);
+	struct chromShard *shardList = NULL, *shard = NULL;
+	struct bedLong *futon = NULL;
+	struct packedChrom *pc = NULL;
+
+	while((futon = slPopHead(&elements)) != NULL)
+	{
+		shard = shardForChrom(shardHash, &shardList, futon->chrom);
+		slAddHead(&shard->elements, futon);
+	}
+	while((futon = slPopHead(&genes)) != NULL)
+	{
+		shard = shardForChrom(shardHash, &shardList, futon->chrom);
+		slAddHead(&shard->genes, futon);
+	}
+	while((futon = slPopHead(&okRegions)) != NULL)
+	{
+		shard = shardForChrom(shardHash, &shardList, futon->chrom);
+		slAddHead(&shard->okRegions, futon);
+	}
+	while((futon = slPopHead(&largeSet)) != NULL)
+	{
+		shard = shardForChrom(shardHash, &shardList, futon->chrom);
+		slAddHead(&shard->largeSet, futon);
+	}
+	for(pc=packedElements; pc != NULL; pc=pc->next)
+	{
+		shard = shardForChrom(shardHash, &shardList, pc->chrom);
+		shard->packedElements = pc->packed;
+		pc->packed = NULL;
+	}
+	for(pc=packedLargeSet; pc != NULL; pc=pc->next)
+	{
+		shard = shardForChrom(shardHash, &shardList, pc->chrom);
+		shard->packedLargeSet = pc->packed;
+		pc->packed = NULL;
+	}
+
+	for(shard=shardList; shard != NULL; shard=shard->next)
+	{
+		slReverse(&shard->elements);
+		slReverse(&shard->genes);
+		slReverse(&shard->okRegions);
+		slReverse(&shard->largeSet);
+	}
+	slSort(&shardList, chromShardCmp);
+	freeHash(&shardHash);
+	return(shardList);
+}
+
+
+struct chromShard *chromShardShare(struct chromShard *geneSide)
+/* A new shard with no elements that reads the gene side of geneSide in */
+/* place.  geneSide must already be prepared and packed as far as it goes, */
+/* and must outlive the new shard. */
+{
+	struct chromShard *shard = NULL;
+
+	AllocVar(shard);
+	shard->chrom = geneSide->chrom;
+	shard->genes = geneSide->genes;
+	shard->unexpandedGenes = geneSide->unexpandedGenes;
+	shard->geneClasses = geneSide->geneClasses;
+	shard->okRegions = geneSide->okRegions;
+	shard->largeSet = geneSide->largeSet;
+	shard->packedGenes = geneSide->packedGenes;
+	shard->packedOkRegions = geneSide->packedOkRegions;
+	shard->packedLargeSet = geneSide->packedLargeSet;
+	shard->unpackable = geneSide->unpackable;
+	shard->sharedGeneSide = TRUE;
+	return(shard);
+}
+
+
+static long elementCount(struct bedLong *list, struct packedIntervals *packed)
+{
+	if(list == NULL && packed != NULL){return(packed->count);}
+	return(slCount(list));
+}
+
+
+long chromShardSize(struct chromShard *shard)
+/* a rough measure of how much work a shard is */
+{
+	return(elementCount(shard->elements, shard->packedElements) + slCount(shard->genes) + slCount(shard->okRegions) + elementCount(shard->largeSet, shard->packedLargeSet));
+}
+
+
+boolean chromShardPackGeneSide(struct chromShard *shard)
+/* Packs the genes, okRegions and largeSet of a shard that owns them. */
+/* Returns FALSE, and marks the shard unpackable, when a coordinate is too */
+/* big to pack; the largeSet is then turned back into a list if it was */
+/* only held packed. */
+{
+	if(shard->unpackable){return(FALSE);}
+	if(shard->packedGenes == NULL){shard->packedGenes = packedIntervalsFromBedLong(shard->genes, NULL);}
+	if(shard->packedOkRegions == NULL){shard->packedOkRegions = packedIntervalsFromBedLong(shard->okRegions, NULL);}
+	if(shard->packedLargeSet == NULL){shard->packedLargeSet = packedIntervalsFromBedLong(shard->largeSet, NULL);}
+	if(shard->packedGenes != NULL && shard->packedOkRegions != NULL && shard->packedLargeSet != NULL)
+	{
+		packedIntervalsIndex(shard->packedGenes);
+		packedIntervalsIndex(shard->packedLargeSet);
+		return(TRUE);
+	}
+
+	verbose(2, "  coordinates on %s are too large to pack, using the list code\n", shard->chrom);
+	if(shard->largeSet == NULL && shard->packedLargeSet != NULL){shard->largeSet = bedLongListFromPacked(shard->chrom, shard->packedLargeSet);}
+	packedIntervalsFree(&shard->packedGenes);
+	packedIntervalsFree(&shard->packedOkRegions);
+	packedIntervalsFree(&shard->packedLargeSet);
+	shard->unpackable = TRUE;
+	return(FALSE);
+}
+
+
+boolean chromShardPack(struct chromShard *shard)
+/* Copies the coordinates of the sorted lists into packed arrays for the */
+/* vector loops.  Returns FALSE, leaving the shard to the list code, when */
+/* a coordinate is too big to pack; anything that was only held packed is */
+/* then turned back into a list.  A shared gene side was packed by its */
+/* owner and is not touched. */
+{
+	if(shard->packed){return(TRUE);}
+	if(!shard->sharedGeneSide){chromShardPackGeneSide(shard);}
+	if(!shard->unpackable && shard->packedElements == NULL)
+	{
+		shard->packedElements = packedIntervalsFromBedLong(shard->elements, NULL);
+		if(shard->packedElements == NULL)
+		{
+			verbose(2, "  element coordinates on %s are too large to pack, using the list code\n", shard->chrom);
+			shard->unpackable = TRUE;
+		}
+	}
+	if(shard->unpackable)
+	{
+		if(shard->elements == NULL && shard->packedElements != NULL){shard->elements = bedLongListFromPacked(shard->chrom, shard->packedElements);}
+		if(shard->largeSet == NULL && shard->packedLargeSet != NULL)
+		{
+			shard->largeSet = bedLongListFromPacked(shard->chrom, shard->packedLargeSet);
+			shard->largeSetUnpacked = TRUE;
+		}
+		return(FALSE);
+	}
+	shard->packed = TRUE;
+	return(TRUE);
+}
+
+
+struct cutPoint
+{
+	struct cutPoint *next;
+	long position;
+};
+
+
+struct startCursor
+/* walks a bedLong list or packed intervals in start order */
+{
+	struct bedLong *bedLong;
+	struct packedIntervals *packed;
+	int ix;
+};
+
+
+static void startCursorInit(struct startCursor *cursor, struct bedLong *list, struct packedIntervals *packed)
+{
+	cursor->bedLong = list;
+	cursor->packed = (list == NULL) ? packed : NULL;
+	cursor->ix = 0;
+}
+
+
+static boolean startCursorPeek(struct startCursor *cursor, long *retStart, long *retEnd)
+{
+	if(cursor->bedLong != NULL)
+	{
+		*retStart = cursor->bedLong->chromStart;
+		*retEnd = cursor->bedLong->chromEnd;
+		return(TRUE);
+	}
+	if(cursor->packed != NULL && cursor->ix < cursor->packed->count)
+	{
+		*retStart = cursor->packed->starts[cursor->ix];
+		*retEnd = cursor->packed->ends[cursor->ix];
+		return(TRUE);
+	}
+	return(FALSE);
+}
+
+
+static void startCursorNext(struct startCursor *cursor)
+{
+	if(cursor->bedLong != NULL){cursor->bedLong = cursor->bedLong->next;}
+	else{cursor->ix++;}
+}
+
+
+static struct cutPoint *findCutPoints(struct chromShard *shard, long maxSize)
+/* returns positions where the shard can be cut, roughly maxSize records apart. */
+/* Nothing in genes, elements or largeSet may span a cut.  okRegions are clipped */
+/* instead, so they do not count. */
+{
+	struct startCursor cursors[3], *best = NULL;
+	struct cutPoint *cutList = NULL, *cut = NULL;
+	long maxEnd = 0, sinceCut = 0, start = 0, end = 0, bestStart = 0, bestEnd = 0;
+	int i = 0;
+
+	startCursorInit(&cursors[0], shard->genes, NULL);
+	startCursorInit(&cursors[1], shard->elements, shard->packedElements);
+	startCursorInit(&cursors[2], shard->largeSet, shard->packedLargeSet);
+	while(TRUE)
+	{
+		best = NULL;
+		for(i=0; i<3; i++)
+		{
+			if(startCursorPeek(&cursors[i], &start, &end) && (best == NULL || start < bestStart))
+			{
+				best = &cursors[i];
+				bestStart = start;
+				bestEnd = end;
+			}
+		}
+		if(best == NULL){break;}
+
+		if(sinceCut >= maxSize && bestStart >= maxEnd && bestStart > 0)
+		{
+			AllocVar(cut);
+			cut->position = bestStart;
+			slAddHead(&cutList, cut);
+			sinceCut = 0;
+		}
+		maxEnd = max(maxEnd, bestEnd);
+		sinceCut++;
+		startCursorNext(best);
+	}
+	slReverse(&cutList);
+	return(cutList);
+}
+
+
+static struct packedIntervals *cutPackedBefore(struct packedIntervals **pPacked, long position)
+/* removes and returns the intervals of *pPacked that start before position */
+{
+	struct packedIntervals *packed = *pPacked, *left = NULL;
+	int cutIx = 0;
+
+	if(packed == NULL){return(NULL);}
+	cutIx = packedFirstStartAtOrAfter(packed, position);
+	left = packedIntervalsSlice(packed, 0, cutIx);
+	*pPacked = packedIntervalsSlice(packed, cutIx, packed->count);
+	packedIntervalsFree(&packed);
+	return(left);
+}
+
+
+static struct bedLong *cutListBefore(struct bedLong **pList, long position)
+/* removes and returns the records of the sorted *pList that start before position */
+{
+	struct bedLong *head = *pList, *prev = NULL, *curr = NULL;
+
+	for(curr=head; curr != NULL && curr->chromStart < position; curr=curr->next)
+		prev = curr;
+	if(prev == NULL){return(NULL);}
+	prev->next = NULL;
+	*pList = curr;
+	return(head);
+}
+
+
+static struct bedLong *clipListBefore(struct bedLong **pList, long position)
+/* like cutListBefore, but records that span position are split in two */
+{
+	struct bedLong *left = NULL, *right = NULL, *futon = NULL, *rest = NULL;
+
+	left = cutListBefore(pList, position);
+	rest = *pList;
+	for(futon=left; futon != NULL; futon=futon->next)
+	{
+		if(futon->chromEnd > position)
+		{
+			struct bedLong *clone = cloneBedLong(futon);
+			clone->chromStart = position;
+			futon->chromEnd = position;
+			slAddHead(&right, clone);
+		}
+	}
+	slReverse(&right);
+	*pList = slCat(right, rest);
+	return(left);
+}
+
+
+static void ownGeneSide(struct chromShard *shard)
+/* cutting a shard up changes its lists, so a shared gene side is copied first */
+{
+	if(!shard->sharedGeneSide){return;}
+	shard->genes = cloneBedLongList(shard->genes);
+	shard->okRegions = cloneBedLongList(shard->okRegions);
+	if(!shard->largeSetUnpacked){shard->largeSet = cloneBedLongList(shard->largeSet);}
+	if(shard->packedLargeSet != NULL){shard->packedLargeSet = packedIntervalsSlice(shard->packedLargeSet, 0, shard->packedLargeSet->count);}
+	shard->packedGenes = NULL;
+	shard->packedOkRegions = NULL;
+	shard->sharedGeneSide = FALSE;
+}
+
+
+static struct chromShard *splitShard(struct chromShard *shard, long maxSize)
+/* returns a list of pieces of shard, each in chromosome order */
+{
+	struct cutPoint *cutList = findCutPoints(shard, maxSize), *cut = NULL;
+	struct chromShard *pieceList = NULL, *piece = NULL;
+	int *geneClasses = shard->geneClasses;
+
+	ownGeneSide(shard);
+	for(cut=cutList; cut != NULL; cut=cut->next)
+	{
+		AllocVar(piece);
+		piece->chrom = shard->chrom;
+		piece->unexpandedGenes = shard->unexpandedGenes;
+		piece->unpackable = shard->unpackable;
+		piece->elements = cutListBefore(&shard->elements, cut->position);
+		piece->genes = cutListBefore(&shard->genes, cut->position);
+		piece->geneClasses = geneClasses;
+		if(geneClasses != NULL){geneClasses += slCount(piece->genes);}
+		piece->largeSet = cutListBefore(&shard->largeSet, cut->position);
+		piece->packedElements = cutPackedBefore(&shard->packedElements, cut->position);
+		piece->packedLargeSet = cutPackedBefore(&shard->packedLargeSet, cut->position);
+		piece->okRegions = clipListBefore(&shard->okRegions, cut->position);
+		slAddHead(&pieceList, piece);
+	}
+	shard->geneClasses = geneClasses;
+	slAddHead(&pieceList, shard);
+	slReverse(&pieceList);
+	verbose(3, "  split %s into %d pieces\n", shard->chrom, slCount(pieceList));
+	slFreeList(&cutList);
+	return(pieceList);
+}
+
+
+struct chromShard *chromShardSplitLarge(struct chromShard *shardList, long maxSize)
+/* Split every shard with more than maxSize records into pieces at domain boundaries. */
+/* The shards must have been sorted and expanded, and not yet packed.  Returns the */
+/* new list of shards, still in genome order. */
+{
+	struct chromShard *newList = NULL, *shard = NULL, *next = NULL;
+
+	for(shard=shardList; shard != NULL; shard=next)
+	{
+		next = shard->next;
+		shard->next = NULL;
+		if(chromShardSize(shard) > maxSize)
+		{
+			struct chromShard *pieces = splitShard(shard, maxSize);
+			slReverse(&pieces);
+			newList = slCat(pieces, newList);
+		}
+		else
+			slAddHead(&newList, shard);
+	}
+	slReverse(&newList);
+	return(newList);
+}
+
+
+struct chromShard **chromShardArray(struct chromShard *shardList, int *retCount)
+/* an array of pointers to the shards, in list order, for handing out to threads */
+{
+	struct chromShard **array = NULL, *shard = NULL;
+	int count = slCount(shardList), i = 0;
+
+	AllocArray(array, max(count,1));
+	for(shard=shardList; shard != NULL; shard=shard->next)
+		array[i++] = shard;
+	*retCount = count;
+	return(array);
+}
+
+
+void chromShardFreeList(struct chromShard **pList)
+/* Frees the shards and what they own.  The chrom names, unexpandedGenes and */
+/* geneClasses are shared by every piece of a chromosome, so whoever made */
+/* them frees them. */
+{
+	struct chromShard *shard = NULL;
+
+	while((shard = slPopHead(pList)) != NULL)
+	{
+		bedLongFreeList(&shard->elements);
+		packedIntervalsFree(&shard->packedElements);
+		if(!shard->sharedGeneSide)
+		{
+			bedLongFreeList(&shard->genes);
+			bedLongFreeList(&shard->okRegions);
+			bedLongFreeList(&shard->largeSet);
+			packedIntervalsFree(&shard->packedGenes);
+			packedIntervalsFree(&shard->packedOkRegions);
+			packedIntervalsFree(&shard->packedLargeSet);
+		}
+		else if(shard->largeSetUnpacked)
+			bedLongFreeList(&shard->largeSet);
+		freeMem(shard);
+	}
+}
@@ -0,0 +1,70 @@
+/*
+
+chromShard.h
+
+Every merge-join in bedToEnrichments starts over when the chromosome
+changes, so the inputs can be cut up by chromosome and each piece
+worked on by its own thread.
+
+*/
+
+#ifndef CHROMSHARD_H
+#define CHROMSHARD_H
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+#ifndef PACKEDINTERVALS_H
+#include "packedIntervals.h"
+#endif
+
+#ifndef POINTINDEX_H
+#include "pointIndex.h"
+#endif
+
+struct chromShard
+/* The part of every input list that falls on one chromosome, or on one piece of a chromosome */
+{
+	struct chromShard *next;
+	char *chrom;
+	struct bedLong *elements;
+	struct bedLong *genes;            /* expanded once the shard is prepared */
+	struct bedLong *unexpandedGenes;  /* whole chromosome, shared between the pieces of a split chromosome */
+	int *geneClasses;                 /* the term set class of each of genes, in list order, shared */
+	                                  /* like unexpandedGenes, NULL if none have been assigned */
+	struct bedLong *okRegions;
+	struct bedLong *largeSet;
+	struct pointIndex *pointIndex;    /* the domains cut up for one base elements, only on the */
+	                                  /* whole chromosome shards of a context */
+	boolean sharedGeneSide;           /* genes, okRegions, largeSet and their packed copies belong */
+	                                  /* to another shard and are only read */
+	boolean largeSetUnpacked;         /* largeSet was made here from a shared packedLargeSet */
+	boolean unpackable;               /* some coordinate is too big to pack, so the list code is used */
+	boolean packed;                   /* TRUE once everything below has been filled in.  Elements */
+	                                  /* and largeSet loaded compactly start out only packed */
+	struct packedIntervals *packedElements;
+	struct packedIntervals *packedGenes;
+	struct packedIntervals *packedOkRegions;
+	struct packedIntervals *packedLargeSet;
+};
+
+struct chromShard *chromShardsFromLists(struct bedLong *elements, struct packedChrom *packedElements, struct bedLong *genes, struct bedLong *okRegions, struct bedLong *largeSet, struct packedChrom *packedLargeSet);
+
+struct chromShard *chromShardShare(struct chromShard *geneSide);
+
+int chromShardCmp(const void *va, const void *vb);
+
+long chromShardSize(struct chromShard *shard);
+
+boolean chromShardPackGeneSide(struct chromShard *shard);
+
+boolean chromShardPack(struct chromShard *shard);
+
+struct chromShard *chromShardSplitLarge(struct chromShard *shardList, long maxSize);
+
+struct chromShard **chromShardArray(struct chromShard *shardList, int *retCount);
+
+void chromShardFreeList(struct chromShard **pList);
+
+#endif
@@ -0,0 +1,294 @@
+/*
+
+chunkedLoad.c
+
+Each piece skips blank and comment lines and chops the rest like
+lineFileRow does.  A line with too few words is not reported from the
+thread that finds it, since the piece does not know how many lines
+came before it.  The piece stops there instead, and once every piece
+is done the first such line is reported with its line number.
+
+*/
+
+#include "common.h"
+#include "linefile.h"
+#include "hash.h"
+#include "bedLong.h"
+#include "packedIntervals.h"
+#include "jobPool.h"
+#include "chunkedLoad.h"
+
+
+struct fileChunk
+/* one piece of a file, cut at a line break, and what was made from it */
+{
+	char *start;
+	char *end;
+	int lineCount;                  /* lines read, blank and comment lines too */
+	int badWords;                   /* words on the line it stopped at, when too few */
+	boolean tooBig;                 /* a coordinate did not fit in 32 bits */
+	struct bedLong *list;
+	struct packedChrom *packedList;
+	struct packedNames *names;      /* the names of this piece, when they are kept */
+};
+
+
+struct chunkedFile
+/* a whole file in memory and the pieces it is parsed in */
+{
+	char *fileName;
+	char *buf;
+	size_t size;
+	int numFields;
+	struct fileChunk *chunks;
+	int chunkCount;
+};
+
+
+static boolean canChunk(char *fileName, int threads)
+{
+	/* lineFileOpen reads stdin and decompresses these itself */
+	if(threads <= 1 || sameString(fileName, "stdin")){return(FALSE);}
+	return(!endsWith(fileName, ".gz") && !endsWith(fileName, ".Z") && !endsWith(fileName, ".bz2") && !endsWith(fileName, ".zip"));
+}
+
+
+static struct chunkedFile *chunkedFileRead(char *fileName, int threads, int numFields)
+/* Reads fileName and cuts it into up to threads pieces of at least a */
+/* megabyte, each ending just after a line break. */
+{
+	struct chunkedFile *cf = NULL;
+	char *start = NULL, *end = NULL, *bufEnd = NULL;
+	int i = 0;
+
+	AllocVar(cf);
+	cf->fileName = fileName;
+	cf->numFields = numFields;
+	readInGulp(fileName, &cf->buf, &cf->size);
+	bufEnd = cf->buf + cf->size;
+	cf->chunkCount = max(1, min(threads, (int)(cf->size / (1024*1024))));
+	AllocArray(cf->chunks, cf->chunkCount);
+
+	start = cf->buf;
+	for(i=0; i<cf->chunkCount; i++)
+	{
+		end = (i == cf->chunkCount-1) ? bufEnd : max(start, cf->buf + cf->size / cf->chunkCount * (i+1));
+		while(end < bufEnd && end > cf->buf && end[-1] != '\n')
+			end++;
+		cf->chunks[i].start = start;
+		cf->chunks[i].end = end;
+		start = end;
+	}
+	return(cf);
+}
+
+
+static void chunkedFileFree(struct chunkedFile **pCf)
+{
+	struct chunkedFile *cf = *pCf;
+
+	freeMem(cf->buf);
+	freeMem(cf->chunks);
+	freez(pCf);
+}
+
+
+static int chunkNextRow(struct chunkedFile *cf, struct fileChunk *chunk, char **pPos, char *row[])
+/* Chops the next line of the piece that is not blank or a comment into */
+/* row, like lineFileChopNext.  Returns the number of words, 0 at the end. */
+{
+	char *line = NULL, *next = NULL;
+	int wordCount = 0;
+
+	while(*pPos < chunk->end)
+	{
+		line = *pPos;
+		if((next = memchr(line, '\n', chunk->end - line)) == NULL)
+			next = chunk->end;
+		else
+			*next++ = '\0';
+		*pPos = next;
+		chunk->lineCount++;
+		if(line[0] == '#'){continue;}
+		if((wordCount = chopByWhite(line, row, cf->numFields)) != 0){return(wordCount);}
+	}
+	return(0);
+}
+
+
+static void checkChunks(struct chunkedFile *cf)
+/* reports the first line with too few words, counting lines from the start of the file */
+{
+	int i = 0, lineIx = 0;
+
+	for(i=0; i<cf->chunkCount; i++)
+	{
+		lineIx += cf->chunks[i].lineCount;
+		if(cf->chunks[i].badWords > 0)
+			errAbort("Expecting %d words line %d of %s got %d", cf->numFields, lineIx, cf->fileName, cf->chunks[i].badWords);
+	}
+}
+
+
+static void bedLongChunkJob(void *context, int chunkIx)
+{
+	struct chunkedFile *cf = (struct chunkedFile *)context;
+	struct fileChunk *chunk = &cf->chunks[chunkIx];
+	char *pos = chunk->start, *row[cf->numFields];
+	int wordCount = 0;
+
+	while((wordCount = chunkNextRow(cf, chunk, &pos, row)) > 0)
+	{
+		if(wordCount < cf->numFields)
+		{
+			chunk->badWords = wordCount;
+			break;
+		}
+		slAddHead(&chunk->list, bedLongLoadN(row, cf->numFields));
+	}
+	slReverse(&chunk->list);
+}
+
+
+struct bedLong *chunkedBedLongLoad(char *fileName, int threads)
+/* filenameToBedLong, parsing the file in up to threads pieces at once */
+{
+	struct chunkedFile *cf = NULL;
+	struct bedLong *list = NULL;
+	int i = 0;
+
+	if(!canChunk(fileName, threads)){return(filenameToBedLong(fileName));}
+	cf = chunkedFileRead(fileName, threads, bedLongFileFieldCount(fileName));
+	jobPoolRun(threads, cf->chunkCount, bedLongChunkJob, cf);
+	checkChunks(cf);
+	for(i=cf->chunkCount-1; i>=0; i--)
+		list = slCat(cf->chunks[i].list, list);
+	chunkedFileFree(&cf);
+	return(list);
+}
+
+
+static void packedChromChunkJob(void *context, int chunkIx)
+{
+	struct chunkedFile *cf = (struct chunkedFile *)context;
+	struct fileChunk *chunk = &cf->chunks[chunkIx];
+	struct hash *chromHash = newHash(8);
+	char *pos = chunk->start, *row[4];
+	int wordCount = 0;
+	long start = 0, end = 0;
+	boolean fits = TRUE;
+
+	if(cf->numFields == 4){chunk->names = packedNamesNew();}
+	while((wordCount = chunkNextRow(cf, chunk, &pos, row)) > 0)
+	{
+		if(wordCount < cf->numFields)
+		{
+			chunk->badWords = wordCount;
+			break;
+		}
+		start = stringToLong(row[1]);
+		end = stringToLong(row[2]);
+		if(chunk->names != NULL){fits = packedChromAddNamed(chromHash, &chunk->packedList, chunk->names, row[0], start, end, row[3]);}
+		else{fits = packedChromAddInterval(chromHash, &chunk->packedList, row[0], start, end);}
+		if(!fits)
+		{
+			verbose(2, "  %s:%ld-%ld in %s does not fit in 32 bits\n", row[0], start, end, cf->fileName);
+			chunk->tooBig = TRUE;
+			break;
+		}
+	}
+	freeHash(&chromHash);
+	slReverse(&chunk->packedList);
+}
+
+
+static void packedChromAppend(struct packedChrom *pc, struct packedIntervals *more)
+{
+	struct packedIntervals *packed = pc->packed;
+	int count = packed->count + more->count;
+
+	if(count > pc->alloc)
+	{
+		pc->alloc = count;
+		packed->starts = needLargeMemResize(packed->starts, pc->alloc * sizeof(int));
+		packed->ends = needLargeMemResize(packed->ends, pc->alloc * sizeof(int));
+		if(packed->nameIds != NULL){packed->nameIds = needLargeMemResize(packed->nameIds, pc->alloc * sizeof(int));}
+	}
+	memcpy(packed->starts + packed->count, more->starts, more->count * sizeof(int));
+	memcpy(packed->ends + packed->count, more->ends, more->count * sizeof(int));
+	if(packed->nameIds != NULL){memcpy(packed->nameIds + packed->count, more->nameIds, more->count * sizeof(int));}
+	packed->count = count;
+}
+
+
+static void renumberNames(struct fileChunk *chunk, struct packedNames *names)
+/* moves the names of a piece onto the end of the names of the whole file, */
+/* and gives its intervals their numbers there.  The pieces are not looked */
+/* up in each other, so a name can be held once in each piece it is in. */
+{
+	struct packedChrom *pc = NULL;
+	int first = packedNamesAddAll(names, chunk->names), i = 0;
+
+	for(pc=chunk->packedList; pc != NULL; pc=pc->next)
+	{
+		for(i=0; i<pc->packed->count; i++)
+			pc->packed->nameIds[i] += first;
+		pc->packed->names = names;
+	}
+	packedNamesFree(&chunk->names);
+}
+
+
+boolean chunkedPackedChromLoad(char *fileName, int threads, struct packedNames *names, struct packedChrom **retList)
+/* packedChromLoad, parsing the file in up to threads pieces at once.  The */
+/* pieces of each chromosome are joined in file order before it is sorted. */
+/* Each piece keeps its own names, which are added to names once it is done. */
+{
+	struct chunkedFile *cf = NULL;
+	struct hash *chromHash = NULL;
+	struct packedChrom *list = NULL, *pc = NULL, *merged = NULL;
+	boolean tooBig = FALSE;
+	int i = 0;
+
+	if(!canChunk(fileName, threads)){return(packedChromLoad(fileName, names, retList));}
+	cf = chunkedFileRead(fileName, threads, (names != NULL) ? 4 : 3);
+	jobPoolRun(threads, cf->chunkCount, packedChromChunkJob, cf);
+	for(i=0; i<cf->chunkCount; i++)
+		tooBig |= cf->chunks[i].tooBig;
+	if(tooBig)
+	{
+		for(i=0; i<cf->chunkCount; i++)
+		{
+			packedChromFreeList(&cf->chunks[i].packedList);
+			packedNamesFree(&cf->chunks[i].names);
+		}
+		chunkedFileFree(&cf);
+		return(FALSE);
+	}
+	checkChunks(cf);
+
+	chromHash = newHash(8);
+	for(i=0; i<cf->chunkCount; i++)
+	{
+		if(cf->chunks[i].names != NULL){renumberNames(&cf->chunks[i], names);}
+		while((pc = slPopHead(&cf->chunks[i].packedList)) != NULL)
+		{
+			if((merged = hashFindVal(chromHash, pc->chrom)) == NULL)
+			{
+				hashAdd(chromHash, pc->chrom, pc);
+				slAddHead(&list, pc);
+			}
+			else
+			{
+				packedChromAppend(merged, pc->packed);
+				packedChromFreeList(&pc);
+			}
+		}
+	}
+	freeHash(&chromHash);
+	chunkedFileFree(&cf);
+
+	packedChromFinish(&list);
+	*retList = list;
+	return(TRUE);
+}
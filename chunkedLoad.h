@@ -0,0 +1,28 @@
+/*
+
+chunkedLoad.h
+
+Reads a bed file whole and parses it in pieces on several threads at
+once.  The pieces are cut at line breaks, and what each one makes is
+joined back together in file order, so the results are the same as
+reading the file a line at a time.  Compressed files, which have to be
+read through lineFile, are always read a line at a time.
+
+*/
+
+#ifndef CHUNKEDLOAD_H
+#define CHUNKEDLOAD_H
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+#ifndef PACKEDINTERVALS_H
+#include "packedIntervals.h"
+#endif
+
+struct bedLong *chunkedBedLongLoad(char *fileName, int threads);
+
+boolean chunkedPackedChromLoad(char *fileName, int threads, struct packedNames *names, struct packedChrom **retList);
+
+#endif
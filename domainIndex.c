@@ -0,0 +1,169 @@
+/*
+
+domainIndex.c
+
+The records of each chromosome are kept sorted by start next to a
+running maximum of their ends.  The records that overlap an interval
+all start before the interval ends, so a binary search finds the last
+of them, and walking back stops as soon as the running maximum shows
+nothing further left can reach the interval.
+
+*/
+
+#include "common.h"
+#include "hash.h"
+#include "bedLong.h"
+#include "domainIndex.h"
+
+
+struct domainEntry
+{
+	long start;
+	long end;
+	int id;
+};
+
+
+struct domainChrom
+/* the records on one chromosome */
+{
+	struct domainEntry *entries;
+	long *maxEnd;     /* largest end of entries[0..i] */
+	int count;
+	int alloc;
+};
+
+
+struct domainIndex *domainIndexNew()
+{
+	struct domainIndex *index = NULL;
+
+	AllocVar(index);
+	index->chromHash = newHash(8);
+	index->alloc = 1024;
+	AllocArray(index->records, index->alloc);
+	return(index);
+}
+
+
+int domainIndexAdd(struct domainIndex *index, struct bedLong *futon)
+/* adds futon to the index and returns its id.  futon is not copied. */
+{
+	struct domainChrom *dc = NULL;
+	struct domainEntry *entry = NULL;
+
+	if(index->finished){errAbort("Error: can not add %s:%ld-%ld to a domain index that is already finished", futon->chrom, futon->chromStart, futon->chromEnd);}
+	if(index->count == index->alloc)
+	{
+		ExpandArray(index->records, index->alloc, 2*index->alloc);
+		index->alloc *= 2;
+	}
+	index->records[index->count] = futon;
+
+	if((dc = hashFindVal(index->chromHash, futon->chrom)) == NULL)
+	{
+		AllocVar(dc);
+		dc->alloc = 64;
+		AllocArray(dc->entries, dc->alloc);
+		hashAdd(index->chromHash, futon->chrom, dc);
+	}
+	if(dc->count == dc->alloc)
+	{
+		ExpandArray(dc->entries, dc->alloc, 2*dc->alloc);
+		dc->alloc *= 2;
+	}
+	entry = &dc->entries[dc->count++];
+	entry->start = futon->chromStart;
+	entry->end = futon->chromEnd;
+	entry->id = index->count;
+	return(index->count++);
+}
+
+
+void domainIndexFree(struct domainIndex **pIndex)
+/* frees the index but not the records in it */
+{
+	struct domainIndex *index = *pIndex;
+	struct hashEl *helList = NULL, *hel = NULL;
+	struct domainChrom *dc = NULL;
+
+	if(index == NULL){return;}
+	helList = hashElListHash(index->chromHash);
+	for(hel=helList; hel != NULL; hel=hel->next)
+	{
+		dc = hel->val;
+		freeMem(dc->entries);
+		freeMem(dc->maxEnd);
+		freeMem(dc);
+	}
+	hashElFreeList(&helList);
+	freeHash(&index->chromHash);
+	freeMem(index->records);
+	freez(pIndex);
+}
+
+
+static int domainEntryCmp(const void *va, const void *vb)
+{
+	const struct domainEntry *a = (const struct domainEntry *)va;
+	const struct domainEntry *b = (const struct domainEntry *)vb;
+	if(a->start < b->start){return(-1);}
+	if(a->start > b->start){return(1);}
+	return(a->id - b->id);
+}
+
+
+void domainIndexFinish(struct domainIndex *index)
+/* sorts every chromosome, after which the index can be searched but not added to */
+{
+	struct hashEl *helList = hashElListHash(index->chromHash), *hel = NULL;
+	struct domainChrom *dc = NULL;
+	int i = 0;
+
+	for(hel=helList; hel != NULL; hel=hel->next)
+	{
+		dc = hel->val;
+		qsort(dc->entries, dc->count, sizeof(struct domainEntry), domainEntryCmp);
+		AllocArray(dc->maxEnd, max(dc->count,1));
+		for(i=0; i<dc->count; i++)
+			dc->maxEnd[i] = (i == 0) ? dc->entries[i].end : max(dc->maxEnd[i-1], dc->entries[i].end);
+	}
+	hashElFreeList(&helList);
+	index->finished = TRUE;
+}
+
+
+int domainIndexOverlaps(struct domainIndex *index, char *chrom, long start, long end, int **pIds, int *pAlloc)
+/* Puts the ids of the records that overlap chrom:start-end by at least one */
+/* base into *pIds, growing it as needed, and returns how many there are. */
+/* They come back in no particular order. */
+{
+	struct domainChrom *dc = NULL;
+	int lo = 0, hi = 0, mid = 0, i = 0, count = 0;
+
+	if(!index->finished){errAbort("Error: domain index must be finished before it is searched");}
+	if(end <= start || (dc = hashFindVal(index->chromHash, chrom)) == NULL){return(0);}
+
+	//hi becomes the first entry that starts at or after end
+	hi = dc->count;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo)/2;
+		if(dc->entries[mid].start < end){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	for(i=hi-1; i >= 0 && dc->maxEnd[i] > start; i--)
+	{
+		if(dc->entries[i].end > start && dc->entries[i].end > dc->entries[i].start)
+		{
+			if(count == *pAlloc)
+			{
+				int newAlloc = max(16, 2*(*pAlloc));
+				ExpandArray(*pIds, *pAlloc, newAlloc);
+				*pAlloc = newAlloc;
+			}
+			(*pIds)[count++] = dc->entries[i].id;
+		}
+	}
+	return(count);
+}
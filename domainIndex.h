@@ -0,0 +1,39 @@
+/*
+
+domainIndex.h
+
+An overlap index over a set of bedLong records that are not going to
+change, so that the records overlapping one interval can be found
+without walking a whole list.  Every record is given an id, in the
+order it was added, that callers can use to keep their own arrays.
+
+*/
+
+#ifndef DOMAININDEX_H
+#define DOMAININDEX_H
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+struct domainIndex
+/* records by chromosome, sorted by start, with the largest end seen so far */
+{
+	struct hash *chromHash;   /* chrom to struct domainChrom */
+	struct bedLong **records; /* indexed by id */
+	int count;
+	int alloc;
+	boolean finished;
+};
+
+struct domainIndex *domainIndexNew();
+
+void domainIndexFree(struct domainIndex **pIndex);
+
+int domainIndexAdd(struct domainIndex *index, struct bedLong *futon);
+
+void domainIndexFinish(struct domainIndex *index);
+
+int domainIndexOverlaps(struct domainIndex *index, char *chrom, long start, long end, int **pIds, int *pAlloc);
+
+#endif
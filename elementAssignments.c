@@ -0,0 +1,147 @@
+/*
+
+elementAssignments.c
+
+The file starts with a magic number, a version, the key and the number
+of elements.  Then comes the number of chromosomes, and for each one its
+name, its gene count, the number of its elements that are in a domain,
+their offsets and then all of their gene indexes.  Elements outside
+every domain are only counted in the header.  The key is 64 bit FNV-1a.
+
+*/
+
+#include "common.h"
+#include "elementAssignments.h"
+
+#define ASSIGNMENTS_MAGIC 0x41455442   /* "BTEA" */
+#define ASSIGNMENTS_VERSION 1
+
+
+bits64 elementAssignmentsKeyAdd(bits64 key, void *data, size_t size)
+/* folds size bytes of data into key, start from 0 */
+{
+	unsigned char *bytes = (unsigned char *)data;
+	size_t i = 0;
+
+	if(key == 0){key = 0xcbf29ce484222325ULL;}
+	for(i=0; i<size; i++)
+	{
+		key ^= bytes[i];
+		key *= 0x100000001b3ULL;
+	}
+	return(key);
+}
+
+
+struct elementAssignments *elementAssignmentsNew(bits64 key, int chromCount)
+/* chromCount empty chromosomes for the caller to fill in */
+{
+	struct elementAssignments *ea = NULL;
+
+	AllocVar(ea);
+	ea->key = key;
+	ea->chromCount = chromCount;
+	AllocArray(ea->chroms, max(chromCount,1));
+	return(ea);
+}
+
+
+void elementAssignmentsWrite(struct elementAssignments *ea, char *fileName)
+{
+	FILE *f = mustOpen(fileName, "wb");
+	struct assignedChrom *ac = NULL;
+	int magic = ASSIGNMENTS_MAGIC, version = ASSIGNMENTS_VERSION, nameSize = 0, i = 0;
+
+	mustWrite(f, &magic, sizeof(int));
+	mustWrite(f, &version, sizeof(int));
+	mustWrite(f, &ea->key, sizeof(bits64));
+	mustWrite(f, &ea->elementCount, sizeof(long));
+	mustWrite(f, &ea->chromCount, sizeof(int));
+	for(i=0; i<ea->chromCount; i++)
+	{
+		ac = &ea->chroms[i];
+		nameSize = strlen(ac->chrom);
+		mustWrite(f, &nameSize, sizeof(int));
+		mustWrite(f, ac->chrom, nameSize);
+		mustWrite(f, &ac->geneCount, sizeof(int));
+		mustWrite(f, &ac->elementCount, sizeof(int));
+		mustWrite(f, ac->offsets, (ac->elementCount+1) * sizeof(int));
+		mustWrite(f, ac->genes, ac->offsets[ac->elementCount] * sizeof(int));
+	}
+	carefulClose(&f);
+}
+
+
+static void checkChrom(struct assignedChrom *ac, char *fileName)
+/* makes sure a damaged file can not send an index past the genes */
+{
+	int i = 0;
+
+	if(ac->offsets[0] != 0){errAbort("Error: %s is not a good assignments file", fileName);}
+	for(i=0; i<ac->elementCount; i++)
+	{
+		if(ac->offsets[i+1] <= ac->offsets[i]){errAbort("Error: %s is not a good assignments file", fileName);}
+	}
+	for(i=0; i<ac->offsets[ac->elementCount]; i++)
+	{
+		if(ac->genes[i] < 0 || ac->genes[i] >= ac->geneCount){errAbort("Error: %s is not a good assignments file", fileName);}
+	}
+}
+
+
+struct elementAssignments *elementAssignmentsRead(char *fileName)
+{
+	FILE *f = mustOpen(fileName, "rb");
+	struct elementAssignments *ea = NULL;
+	struct assignedChrom *ac = NULL;
+	bits64 key = 0;
+	long elementCount = 0;
+	int magic = 0, version = 0, chromCount = 0, nameSize = 0, i = 0;
+
+	mustRead(f, &magic, sizeof(int));
+	if(magic != ASSIGNMENTS_MAGIC){errAbort("Error: %s is not an assignments file made by -saveAssignments", fileName);}
+	mustRead(f, &version, sizeof(int));
+	if(version != ASSIGNMENTS_VERSION){errAbort("Error: %s is version %d of the assignments file, only version %d can be read", fileName, version, ASSIGNMENTS_VERSION);}
+	mustRead(f, &key, sizeof(bits64));
+	mustRead(f, &elementCount, sizeof(long));
+	mustRead(f, &chromCount, sizeof(int));
+	if(chromCount < 0){errAbort("Error: %s is not a good assignments file", fileName);}
+	ea = elementAssignmentsNew(key, chromCount);
+	ea->elementCount = elementCount;
+	for(i=0; i<chromCount; i++)
+	{
+		ac = &ea->chroms[i];
+		mustRead(f, &nameSize, sizeof(int));
+		if(nameSize <= 0){errAbort("Error: %s is not a good assignments file", fileName);}
+		ac->chrom = needMem(nameSize+1);
+		mustRead(f, ac->chrom, nameSize);
+		mustRead(f, &ac->geneCount, sizeof(int));
+		mustRead(f, &ac->elementCount, sizeof(int));
+		if(ac->elementCount < 0){errAbort("Error: %s is not a good assignments file", fileName);}
+		AllocArray(ac->offsets, ac->elementCount+1);
+		mustRead(f, ac->offsets, (ac->elementCount+1) * sizeof(int));
+		if(ac->offsets[ac->elementCount] < 0){errAbort("Error: %s is not a good assignments file", fileName);}
+		AllocArray(ac->genes, max(ac->offsets[ac->elementCount],1));
+		mustRead(f, ac->genes, ac->offsets[ac->elementCount] * sizeof(int));
+		checkChrom(ac, fileName);
+	}
+	carefulClose(&f);
+	return(ea);
+}
+
+
+void elementAssignmentsFree(struct elementAssignments **pEa)
+{
+	struct elementAssignments *ea = *pEa;
+	int i = 0;
+
+	if(ea == NULL){return;}
+	for(i=0; i<ea->chromCount; i++)
+	{
+		freeMem(ea->chroms[i].chrom);
+		freeMem(ea->chroms[i].offsets);
+		freeMem(ea->chroms[i].genes);
+	}
+	freeMem(ea->chroms);
+	freez(pEa);
+}
@@ -0,0 +1,46 @@
+/*
+
+elementAssignments.h
+
+Which genes' domains each element falls in, worked out once and kept in
+a small binary file, so that any number of later enrichment runs on the
+same elements can skip reading the elements and every interval join.
+The genes of a chromosome are numbered in the order the context sorted
+them, so a file is only good with the genes and expansion settings it
+was made from.  That is checked through a key made from both.
+
+*/
+
+#ifndef ELEMENTASSIGNMENTS_H
+#define ELEMENTASSIGNMENTS_H
+
+struct assignedChrom
+/* the elements of one chromosome that are in at least one domain */
+{
+	char *chrom;
+	int geneCount;        /* genes of the chromosome, to check the indexes against */
+	int elementCount;
+	int *offsets;         /* elementCount+1 offsets into genes, element i has genes[offsets[i]] up to genes[offsets[i+1]] */
+	int *genes;           /* indexes into the chromosome's genes, in start order for each element */
+};
+
+struct elementAssignments
+/* every element set to its genes, one chromosome after another */
+{
+	bits64 key;                   /* from the genes and expansion settings */
+	long elementCount;            /* every element, in a domain or not */
+	struct assignedChrom *chroms;
+	int chromCount;
+};
+
+bits64 elementAssignmentsKeyAdd(bits64 key, void *data, size_t size);
+
+struct elementAssignments *elementAssignmentsNew(bits64 key, int chromCount);
+
+void elementAssignmentsWrite(struct elementAssignments *ea, char *fileName);
+
+struct elementAssignments *elementAssignmentsRead(char *fileName);
+
+void elementAssignmentsFree(struct elementAssignments **pEa);
+
+#endif
@@ -0,0 +1,3665 @@
+/*
+
+enrichments.c
+
+The genes, okRegions and largeSet are split up by chromosome, sorted,
+expanded and packed once when a context is made, and the white balls
+and total balls are counted then too, since they do not depend on the
+elements.  Each run makes its own shards that point at the gene side of
+the context and hold a copy of the elements, so a run never writes to
+anything it shares with another run.
+
+*/
+
+#include "common.h"
+#include "linefile.h"
+#include "hash.h"
+#include "bed.h"
+#include "bedLong.h"
+#include "packedIntervals.h"
+#include "chromShard.h"
+#include "jobPool.h"
+#include "domainIndex.h"
+#include "incremental.h"
+#include "chunkedLoad.h"
+#include "allowedIndex.h"
+#include "pointIndex.h"
+#include "ontology.h"
+#include "elementAssignments.h"
+#include "enrichments.h"
+#include "dystring.h"
+#include "gsl/gsl_cdf.h"
+#include <math.h>
+
+
+void bedLongGuessTxStart(struct bedLong *bedLongList)
+{
+	struct bedLong *futon = NULL;
+	for(futon=bedLongList; futon != NULL; futon=futon->next)
+	{
+		if(futon->strand == '+')
+			futon->chromEnd = futon->chromStart + 1;
+		else if (futon->strand == '-')
+			futon->chromStart = futon->chromEnd - 1;
+		else
+			errAbort("tried to guess the txStart when there is not strand %s %ld %ld", futon->chrom, futon->chromStart, futon->chromEnd);
+	}
+}
+
+
+void expandBedLongListByDistance(struct bedLong *bedLongList, long distance)
+{
+	struct bedLong *futon = NULL;
+
+	for(futon=bedLongList; futon != NULL; futon=futon->next)
+	{
+		futon->chromStart = max(0,futon->chromStart - distance);
+		futon->chromEnd += distance;
+	}
+}
+
+void expandBedLongListToNeighbor(struct bedLong *bedLongList, long distance)
+{
+	struct bedLong *prev = NULL, *curr = NULL;
+	long middle = 0;
+
+	for(curr=bedLongList; curr != NULL; curr=curr->next)
+	{
+		if((prev != NULL) && (strcmp(prev->chrom,curr->chrom) != 0))
+		{
+			prev->chromEnd += distance;
+			prev = NULL;
+		}
+
+		if(prev==NULL)
+		{
+			curr->chromStart = max(0,curr->chromStart - distance);
+			prev = curr;
+		}
+		else if(curr->chromStart - prev->chromEnd >= 2 * distance)
+		{
+			prev->chromEnd += distance;
+			curr->chromStart = max(0,curr->chromStart - distance);
+			prev = curr;
+		}
+		else if(curr->chromStart - prev->chromEnd >= 0)
+		{
+			middle = (curr->chromStart + prev->chromEnd)/2;
+			prev->chromEnd = middle;
+			curr->chromStart = middle;
+			prev = curr;
+		}
+		else if(curr->chromEnd - prev->chromEnd >= 0)
+		{
+			prev = curr;
+		}
+		else if(curr->chromEnd < prev->chromEnd)
+		{
+			/* inside of the previous domain, so it is not expanded */
+		}
+		else
+		{
+			errAbort("should not exhaust this if statement");
+		}
+	}
+	if(prev != NULL){prev->chromEnd += distance;}
+}
+
+
+int bedLongCmp(const void *va, const void *vb)
+{
+	const struct bedLong *a = *((struct bedLong **)va);
+	const struct bedLong *b = *((struct bedLong **)vb);
+	int dif;
+	dif = strcmp(a->chrom, b->chrom);
+	if(dif != 0){return(dif);}
+	else if(a->chromStart > b->chromStart){return(1);}
+	else if(a->chromStart == b->chromStart){return(0);}
+	else{return(-1);}
+}
+
+
+int bedLongCmpEnd(struct bedLong *futon, struct bedLong *bunk)
+{
+	int diff = 0;
+	diff = strcmp(futon->chrom, bunk->chrom);
+	if(diff == 0)
+	{
+		if(futon->chromEnd < bunk->chromEnd){return(-1);}
+		else if(futon->chromEnd > bunk->chromEnd){return(1);}
+		else{return(0);}
+	}
+	else{return(diff);}
+}
+
+
+boolean bedLongOverlap(struct bedLong *futon, struct bedLong *bunk)
+{
+	assert(futon != NULL);
+	if(strcmp(futon->chrom,bunk->chrom) == 0)
+	{
+		if(min(futon->chromEnd,bunk->chromEnd) - max(futon->chromStart,bunk->chromStart) > 0)
+		{
+		return(TRUE);
+		}
+	}
+	return(FALSE);
+}
+
+
+struct termEvent
+/* a domain opening or closing for one of its go terms */
+{
+	long position;
+	int termId;
+	int delta;    /* +1 at the start of a domain, -1 at its end */
+};
+
+
+int termEventCmp(const void *va, const void *vb)
+{
+	const struct termEvent *a = (const struct termEvent *)va;
+	const struct termEvent *b = (const struct termEvent *)vb;
+	if(a->position < b->position){return(-1);}
+	if(a->position > b->position){return(1);}
+	return(0);
+}
+
+
+static void goBasesByTermMulti(struct bedLong *geneList, struct hash *termIdHash, int termCount, struct allowedChrom **allowedChroms, int allowedCount, long **retBases)
+{
+	/* For every term in termIdHash, adds the number of bases allowed by */
+	/* allowedChroms[b] covered by the genes with that term to */
+	/* retBases[b][termId], each base counted once however many of the */
+	/* term's domains cover it, in one sweep over the domain ends for */
+	/* every background.  A term is open while any of its domains is, and */
+	/* when it closes it is credited with the allowed bases since it opened. */
+	/* geneList should be on the chromosome of allowedChroms, any of which */
+	/* may be NULL when that background allows nothing there. */
+	struct bedLong *gene = NULL;
+	struct slName *goTerm = NULL;
+	struct termEvent *events = NULL;
+	int *activeCount = NULL, eventCount = 0, i = 0, t = 0, b = 0;
+	long *openSince = NULL;
+
+	if(geneList == NULL || termCount == 0){return;}
+	for(gene=geneList; gene != NULL; gene=gene->next)
+		eventCount += 2 * slCount(gene->goTerms);
+	AllocArray(events, max(eventCount,1));
+	eventCount = 0;
+	for(gene=geneList; gene != NULL; gene=gene->next)
+	{
+		if(gene->chromEnd <= gene->chromStart){continue;}
+		for(goTerm=gene->goTerms; goTerm != NULL; goTerm=goTerm->next)
+		{
+			if((t = hashIntValDefault(termIdHash, goTerm->name, -1)) < 0){continue;}
+			events[eventCount].position = gene->chromStart;
+			events[eventCount].termId = t;
+			events[eventCount].delta = 1;
+			eventCount++;
+			events[eventCount].position = gene->chromEnd;
+			events[eventCount].termId = t;
+			events[eventCount].delta = -1;
+			eventCount++;
+		}
+	}
+	qsort(events, eventCount, sizeof(struct termEvent), termEventCmp);
+
+	//the ranks are only looked up when a term opens or closes
+	AllocArray(activeCount, termCount);
+	AllocArray(openSince, (long)termCount * allowedCount);
+	for(i=0; i<eventCount; i++)
+	{
+		t = events[i].termId;
+		if(events[i].delta > 0)
+		{
+			if(activeCount[t]++ > 0){continue;}
+			for(b=0; b<allowedCount; b++)
+				openSince[(long)t*allowedCount + b] = allowedChromRank(allowedChroms[b], events[i].position);
+		}
+		else
+		{
+			if(--activeCount[t] > 0){continue;}
+			for(b=0; b<allowedCount; b++)
+				retBases[b][t] += allowedChromRank(allowedChroms[b], events[i].position) - openSince[(long)t*allowedCount + b];
+		}
+	}
+	freeMem(activeCount);
+	freeMem(openSince);
+	freeMem(events);
+}
+
+
+void bedLongGoBasesByTerm(struct bedLong *geneList, struct hash *termIdHash, int termCount, struct allowedChrom *allowedChrom, long *retBases)
+{
+	/* goBasesByTermMulti for the one background of allowedChrom */
+	if(allowedChrom == NULL){return;}
+	goBasesByTermMulti(geneList, termIdHash, termCount, &allowedChrom, 1, &retBases);
+}
+
+
+int bedLongIntersectCount(struct bedLong *listOne, struct bedLong *listTwo)
+{
+	/* returns the number of elements from list one that have any overlap with list two */
+	/* both the bed lists should be sorted with bedLongCmp */
+	struct bedLong *futon = NULL, *bunk = NULL;
+	int count = 0;
+
+	futon = listOne;
+	bunk = listTwo;
+
+	while(futon != NULL && bunk != NULL)
+	{
+		if(bedLongOverlap(futon,bunk))
+		{
+			count++;
+			futon = futon->next;
+		}
+		else if(bedLongCmpEnd(futon,bunk) < 0){futon = futon->next;}
+		else{bunk = bunk->next;}
+	}
+	return(count);
+}
+
+
+void bedLongOverlapFlags(struct bedLong *listOne, struct bedLong *listTwo, int *flags)
+{
+	/* sets flags[i] to 1 for the i-th element of list one if it has any overlap */
+	/* with list two.  Both the bed lists should be sorted with bedLongCmp */
+	struct bedLong *futon = listOne, *bunk = listTwo;
+	int i = 0;
+
+	while(futon != NULL && bunk != NULL)
+	{
+		if(bedLongOverlap(futon,bunk))
+		{
+			flags[i] = 1;
+			futon = futon->next;
+			i++;
+		}
+		else if(bedLongCmpEnd(futon,bunk) < 0){futon = futon->next; i++;}
+		else{bunk = bunk->next;}
+	}
+}
+
+
+struct bedLong *findNameInBedLongList(struct bedLong *head, char *name)
+{
+	struct bedLong *curr = NULL;
+	for(curr=head; curr!=NULL; curr=curr->next)
+	{
+		if(sameString(curr->name, name))
+		{
+			return(curr);
+		}
+	}
+	return(NULL);
+}
+
+
+long int absDiff(long int a, long int b)
+{
+	if(a >= b){return(a-b);}
+	else{return(b-a);}
+}
+
+
+long int distanceBetweenBeds(struct bedLong *a, struct bedLong *b)
+{
+	if(differentString(a->chrom, b->chrom)){errAbort("Error: can not calculate distance between beds on separate chroms");}
+	if(bedLongOverlap(a,b)){return(0);}
+	else
+	{
+		return(min(absDiff(a->chromStart, b->chromEnd-1), absDiff(a->chromEnd-1, b->chromStart)));
+	}
+}
+
+
+
+void enrichOptionsDefault(struct enrichOptions *options)
+/* the same settings bedToEnrichments has when given no options */
+{
+	ZeroVar(options);
+	options->test = enrichBinomial;
+	options->maxExpansion = 1000000;
+	options->maxPvalue = 0.05;
+	options->threads = 1;
+}
+
+
+void enrichTermNamespace(struct enrichOptions *options, char *goTerm, char *retNamespace, int size)
+/* the part of goTerm before the first colon.  Without the namespaces */
+/* option every term is in the one namespace "all". */
+{
+	char *colon = strchr(goTerm, ':');
+
+	if(!options->namespaces){safef(retNamespace, size, "all");}
+	else if(colon == NULL){safef(retNamespace, size, "none");}
+	else{safef(retNamespace, size, "%.*s", (int)(colon - goTerm), goTerm);}
+}
+
+
+struct hash *namespaceTestCounts(struct enrichOptions *options, struct slName *goTerms)
+{
+	/* the number of tests in each namespace, before any terms are dropped */
+	struct hash *testCountHash = newHash(6);
+	struct hashEl *hel = NULL;
+	struct slName *term = NULL;
+	char namespace[256];
+
+	for(term=goTerms; term != NULL; term=term->next)
+	{
+		enrichTermNamespace(options, term->name, namespace, sizeof(namespace));
+		hel = hashStore(testCountHash, namespace);
+		hel->val = intToPt(ptToInt(hel->val) + 1);
+	}
+	return(testCountHash);
+}
+
+
+int termTestCount(struct enrichOptions *options, struct hash *testCountHash, char *goTerm)
+{
+	char namespace[256];
+
+	enrichTermNamespace(options, goTerm, namespace, sizeof(namespace));
+	return(hashIntVal(testCountHash, namespace));
+}
+
+
+double termPValue(enum enrichTest test, long whiteBallsPicked, long totalPicks, long whiteBalls, long totalBalls)
+{
+	/* the p-value of one term under the binomial or the hypergeometric */
+	if(whiteBallsPicked == 0){return(1);}
+	if(test == enrichBinomial){return(gsl_cdf_binomial_Q((unsigned int)whiteBallsPicked-1, ((double)whiteBalls)/((double)totalBalls), (unsigned int)totalPicks));}
+	return(gsl_cdf_hypergeometric_Q((unsigned int)whiteBallsPicked-1, (unsigned int)whiteBalls, (unsigned int)totalBalls-whiteBalls, (unsigned int)totalPicks));
+}
+
+
+struct shardCounts
+/* Totals and per-term tallies for one shard.  These are summed over all */
+/* the shards before any p-values are taken. */
+{
+	long totalBalls;
+	long totalPicks;
+	long *whiteBalls;         /* indexed in the same order as goTerms */
+	long *whiteBallsPicked;
+	struct hash *hitsHash;    /* names hit on this shard, keyed by goTerm */
+	struct dyString *output;  /* -geneAssignments lines for this shard */
+	int *geneFlags;           /* for enrichRunOntology, the genes hit, in list order */
+	int regionsMerged;        /* okRegions joined into another when the context was made */
+	int largeSetRepeats;      /* largeSet records with the same coordinates as another */
+};
+
+
+struct shardWork
+/* what the threads share while counting the shards */
+{
+	struct enrichContext *context;
+	struct chromShard **shards;
+	struct shardCounts *counts;
+	boolean *active;          /* FALSE for terms that were pruned before their picks were counted */
+	boolean wantHits;
+	struct elementAssignments *assigned;  /* what the elements hit, by shard, when run from an assignments file */
+};
+
+
+struct shardWork *newShardWork(struct enrichContext *context, struct chromShard **shards, int shardCount, boolean wantHits)
+{
+	struct shardWork *work = NULL;
+	int i = 0, termCount = context->termCount;
+
+	AllocVar(work);
+	work->context = context;
+	work->shards = shards;
+	AllocArray(work->active, max(termCount,1));
+	for(i=0; i<termCount; i++)
+		work->active[i] = TRUE;
+	work->wantHits = wantHits;
+	AllocArray(work->counts, max(shardCount,1));
+	for(i=0; i<shardCount; i++)
+	{
+		AllocArray(work->counts[i].whiteBalls, max(termCount,1));
+		AllocArray(work->counts[i].whiteBallsPicked, max(termCount,1));
+		if(wantHits){work->counts[i].hitsHash = newHash(9);}
+	}
+	return(work);
+}
+
+
+void freeShardWork(struct shardWork **pWork, int shardCount)
+{
+	struct shardWork *work = *pWork;
+	int i = 0;
+
+	for(i=0; i<shardCount; i++)
+	{
+		freeMem(work->counts[i].whiteBalls);
+		freeMem(work->counts[i].whiteBallsPicked);
+		freeHashAndVals(&work->counts[i].hitsHash);
+		if(work->counts[i].output != NULL){dyStringFree(&work->counts[i].output);}
+		freeMem(work->counts[i].geneFlags);
+	}
+	freeMem(work->counts);
+	freeMem(work->active);
+	freez(pWork);
+}
+
+
+void addShardHits(struct hash *hitsHash, struct hash *shardHitsHash, char *goTerm)
+{
+	/* the hash hands back the most recent name first, so flip them */
+	/* around to keep the order they were found in */
+	struct slName *names = NULL, *curr = NULL;
+	struct hashEl *el = NULL;
+
+	for(el = hashLookup(shardHitsHash, goTerm); el != NULL; el = hashLookupNext(el))
+		slAddHead(&names, newSlName((char *)el->val));
+	for(curr=names; curr != NULL; curr=curr->next)
+		hashAdd(hitsHash, goTerm, cloneString(curr->name));
+	slNameFreeList(&names);
+}
+
+
+struct shardCounts *sumShardCounts(struct shardWork *work, int shardCount, struct hash *retHitsHash)
+/* adds up the counts of every shard, in genome order */
+{
+	struct shardCounts *sum = NULL, *counts = NULL;
+	struct slName *term = NULL;
+	int i = 0, t = 0, termCount = work->context->termCount;
+
+	AllocVar(sum);
+	AllocArray(sum->whiteBalls, max(termCount,1));
+	AllocArray(sum->whiteBallsPicked, max(termCount,1));
+	for(i=0; i<shardCount; i++)
+	{
+		counts = &work->counts[i];
+		sum->totalBalls += counts->totalBalls;
+		sum->totalPicks += counts->totalPicks;
+		for(t=0, term=work->context->goTerms; term != NULL; t++, term=term->next)
+		{
+			sum->whiteBalls[t] += counts->whiteBalls[t];
+			sum->whiteBallsPicked[t] += counts->whiteBallsPicked[t];
+			if(retHitsHash != NULL && counts->hitsHash != NULL){addShardHits(retHitsHash, counts->hitsHash, term->name);}
+		}
+	}
+	return(sum);
+}
+
+
+void freeShardCounts(struct shardCounts **pSum)
+{
+	struct shardCounts *sum = *pSum;
+
+	freeMem(sum->whiteBalls);
+	freeMem(sum->whiteBallsPicked);
+	freez(pSum);
+}
+
+
+boolean cannotPass(struct enrichOptions *options, double pValue, int testCount)
+{
+	/* TRUE if a term with this p-value, or any larger one, would not be shown */
+	if(options->maxPvalue >= 1){return(FALSE);}
+	if(options->bonferroni){return(pValue * (double)testCount > options->maxPvalue);}
+	return(pValue > options->maxPvalue);
+}
+
+
+static int bestCaseActive(struct enrichContext *context, long totalPicks, boolean *active)
+{
+	/* Turns off in active the terms of context that could not pass even if */
+	/* as many picks as possible landed on them.  Returns how many. */
+	/* Terms with the same genes share their rep's best p-value. */
+	enum enrichTest test = context->options.test;
+	double *bestPValues = NULL;
+	long best = 0;
+	int t = 0, r = 0, pruned = 0;
+
+	AllocArray(bestPValues, max(context->termCount,1));
+	for(t=0; t<context->termCount; t++)
+	{
+		if((r = context->termReps[t]) == t)
+		{
+			best = (test == enrichBinomial) ? totalPicks : min(context->whiteBalls[t], totalPicks);
+			bestPValues[t] = termPValue(test, best, totalPicks, context->whiteBalls[t], context->totalBalls);
+		}
+		if(cannotPass(&context->options, bestPValues[r], context->testCounts[t]))
+		{
+			active[t] = FALSE;
+			pruned++;
+		}
+	}
+	freeMem(bestPValues);
+	return(pruned);
+}
+
+
+int pruneByBestCase(struct shardWork *work, long totalPicks)
+{
+	/* Turns off the terms that could not pass even if as many picks as possible */
+	/* landed on them, so that their picks are never counted.  Returns how many. */
+	return(bestCaseActive(work->context, totalPicks, work->active));
+}
+
+
+static void copyFromReps(struct enrichContext *context, long *counts)
+/* gives every term the count of its rep, which is the only one counted */
+{
+	int t = 0;
+
+	for(t=0; t<context->termCount; t++)
+		counts[t] = counts[context->termReps[t]];
+}
+
+
+boolean atOrBelowExpected(long whiteBallsPicked, long totalPicks, long whiteBalls, long totalBalls)
+{
+	/* The median of the binomial and of the hypergeometric is the mean rounded */
+	/* up or down, so a count no higher than the mean has a p-value of at least 0.5 */
+	return(whiteBallsPicked * totalBalls <= whiteBalls * totalPicks);
+}
+
+
+void reportPruning(int termCount, int bestCasePruned, int expectedPruned)
+{
+	if(bestCasePruned + expectedPruned > 0)
+		verbose(2, "Evaluated %d of %d goTerms: %d could not reach the p-value cutoff, %d were at or below the expected count\n", termCount - bestCasePruned - expectedPruned, termCount, bestCasePruned, expectedPruned);
+}
+
+
+static void addClassTally(struct enrichContext *context, long *classTally, long *retCounts)
+/* adds the count of each class to every term of the class */
+{
+	int c = 0, i = 0;
+
+	for(c=0; c<context->classCount; c++)
+	{
+		if(classTally[c] == 0){continue;}
+		for(i=0; i<context->classTermCounts[c]; i++)
+			retCounts[context->classTerms[c][i]] += classTally[c];
+	}
+}
+
+
+/* labelRecords is written once as a macro and stamped out for every */
+/* combination of whether the records are packed, whether only picked */
+/* ones are looked at, whether they carry counts and whether names are */
+/* kept.  Those settings are constants inside each copy, so the walk */
+/* tests none of them per record, and labelRecords only picks the copy. */
+
+#define LABEL_RECORDS(labeler, PACKED, PICKED, WEIGHTED, NAMES) \
+static void labeler(struct shardWork *work, struct chromShard *shard, struct bedLong *list, struct packedIntervals *packed, int *picked, long *retCounts, struct hash *hitsHash) \
+{ \
+	struct enrichContext *context = work->context; \
+	struct bedLong *futon = list, *gene = shard->genes, **active = NULL; \
+	long *classTally = NULL, start = 0, end = 0; \
+	int *stamp = NULL, *activeClass = NULL, activeCount = 0, activeAlloc = 16, recordCount = 0, geneIx = 0; \
+	int *weights = WEIGHTED ? packed->counts : NULL; \
+	int i = 0, a = 0, keep = 0, t = 0, c = 0, k = 0, r = 0, recordClass = 0, weight = 1; \
+	\
+	recordCount = PACKED ? packed->count : slCount(list); \
+	AllocArray(active, activeAlloc); \
+	AllocArray(activeClass, activeAlloc); \
+	AllocArray(classTally, max(context->classCount,1)); \
+	AllocArray(stamp, max(context->termCount,1)); \
+	for(t=0; t<context->termCount; t++) \
+		stamp[t] = -1; \
+	\
+	for(i=0; i<recordCount; i++) \
+	{ \
+		if(PACKED) \
+		{ \
+			start = packed->starts[i]; \
+			end = packed->ends[i]; \
+		} \
+		else \
+		{ \
+			start = futon->chromStart; \
+			end = futon->chromEnd; \
+			futon = futon->next; \
+		} \
+		if(PICKED && !picked[i]){continue;} \
+		\
+		/* the record starts never go down, so domains that end before this one starts are done with */ \
+		for(a=0, keep=0; a<activeCount; a++) \
+		{ \
+			if(active[a]->chromEnd > start) \
+			{ \
+				active[keep] = active[a]; \
+				activeClass[keep++] = activeClass[a]; \
+			} \
+		} \
+		activeCount = keep; \
+		for(; gene != NULL && gene->chromStart < end; gene=gene->next, geneIx++) \
+		{ \
+			if(gene->chromEnd <= start){continue;} \
+			if(activeCount == activeAlloc) \
+			{ \
+				ExpandArray(active, activeAlloc, 2*activeAlloc); \
+				ExpandArray(activeClass, activeAlloc, 2*activeAlloc); \
+				activeAlloc *= 2; \
+			} \
+			active[activeCount] = gene; \
+			activeClass[activeCount++] = shard->geneClasses[geneIx]; \
+		} \
+		\
+		recordClass = -1; \
+		for(a=0; a<activeCount; a++) \
+		{ \
+			if(min(active[a]->chromEnd,end) - max(active[a]->chromStart,start) <= 0){continue;} \
+			if(recordClass == -1){recordClass = activeClass[a];} \
+			else if(recordClass != activeClass[a]){recordClass = -2;} \
+		} \
+		if(recordClass == -1){continue;} \
+		if(WEIGHTED){weight = weights[i];} \
+		if(!NAMES && recordClass >= 0) \
+		{ \
+			classTally[recordClass] += weight; \
+			continue; \
+		} \
+		\
+		for(a=0; a<activeCount; a++) \
+		{ \
+			if(min(active[a]->chromEnd,end) - max(active[a]->chromStart,start) <= 0){continue;} \
+			c = activeClass[a]; \
+			for(k=0; k<context->classTermCounts[c]; k++) \
+			{ \
+				t = context->classTerms[c][k]; \
+				if(stamp[t] == i){continue;} \
+				stamp[t] = i; \
+				retCounts[t] += weight; \
+				if(NAMES) \
+				{ \
+					if(active[a]->name == NULL){errAbort("Error: told to list names, but hit has not name");} \
+					for(r=0; r<weight; r++) \
+						hashAdd(hitsHash, context->termNames[t], cloneString(active[a]->name)); \
+				} \
+			} \
+		} \
+	} \
+	addClassTally(context, classTally, retCounts); \
+	freeMem(classTally); \
+	freeMem(stamp); \
+	freeMem(activeClass); \
+	freeMem(active); \
+}
+
+/* only packed records carry counts */
+LABEL_RECORDS(labelRecords0000, 0, 0, 0, 0)
+LABEL_RECORDS(labelRecords0100, 0, 1, 0, 0)
+LABEL_RECORDS(labelRecords0001, 0, 0, 0, 1)
+LABEL_RECORDS(labelRecords0101, 0, 1, 0, 1)
+LABEL_RECORDS(labelRecords1000, 1, 0, 0, 0)
+LABEL_RECORDS(labelRecords1100, 1, 1, 0, 0)
+LABEL_RECORDS(labelRecords1010, 1, 0, 1, 0)
+LABEL_RECORDS(labelRecords1110, 1, 1, 1, 0)
+LABEL_RECORDS(labelRecords1001, 1, 0, 0, 1)
+LABEL_RECORDS(labelRecords1101, 1, 1, 0, 1)
+LABEL_RECORDS(labelRecords1011, 1, 0, 1, 1)
+LABEL_RECORDS(labelRecords1111, 1, 1, 1, 1)
+
+
+void labelRecords(struct shardWork *work, struct chromShard *shard, struct bedLong *list, struct packedIntervals *packed, int *picked, long *retCounts, struct hash *hitsHash)
+{
+	/* One walk down a record list, the largeSet or the elements.  Each */
+	/* record counts once in retCounts for every term of the domains it */
+	/* overlaps, or as many times as packed->counts says it stands for. */
+	/* With picked, only the records flagged in it are looked at. */
+	/* The domains that might still overlap are kept in active, in start */
+	/* order, with their classes.  A record whose domains are all of one */
+	/* class is just tallied for that class, and the tallies are spread */
+	/* over the terms at the end.  With hitsHash, each record also adds the */
+	/* name of the first domain it overlaps with each term. */
+	static void (*labels[16])(struct shardWork *, struct chromShard *, struct bedLong *, struct packedIntervals *, int *, long *, struct hash *) =
+		{labelRecords0000, labelRecords1000, labelRecords0100, labelRecords1100, NULL, labelRecords1010, NULL, labelRecords1110,
+		labelRecords0001, labelRecords1001, labelRecords0101, labelRecords1101, NULL, labelRecords1011, NULL, labelRecords1111};
+	int ix = 0;
+
+	ix = (packed != NULL) | ((picked != NULL) << 1) | ((packed != NULL && packed->counts != NULL) << 2) | ((hitsHash != NULL) << 3);
+	labels[ix](work, shard, list, packed, picked, retCounts, hitsHash);
+}
+
+
+void labelLargeSet(struct shardWork *work, struct chromShard *shard, int *picked, struct shardCounts *counts)
+{
+	/* Without picked, every largeSet record counts once as a white ball for */
+	/* each term of the domains it overlaps.  With picked, only the records */
+	/* that overlap an element are looked at, and count as picked white balls. */
+	if(picked == NULL)
+		labelRecords(work, shard, shard->largeSet, shard->packedLargeSet, NULL, counts->whiteBalls, NULL);
+	else
+		labelRecords(work, shard, shard->largeSet, shard->packedLargeSet, picked, counts->whiteBallsPicked, counts->hitsHash);
+}
+
+
+void countClassGenes(struct shardWork *work, struct chromShard *shard, int *flags, long *retCounts, struct hash *hitsHash)
+{
+	/* Adds each gene, or each gene flagged in flags, once to every term it */
+	/* has, by way of its class.  With hitsHash the names are added too, */
+	/* one gene at a time in genome order. */
+	struct enrichContext *context = work->context;
+	struct bedLong *gene = NULL;
+	long *classTally = NULL;
+	int geneIx = 0, c = 0, k = 0, t = 0;
+
+	AllocArray(classTally, max(context->classCount,1));
+	for(gene=shard->genes, geneIx=0; gene != NULL; gene=gene->next, geneIx++)
+	{
+		if(flags != NULL && !flags[geneIx]){continue;}
+		c = shard->geneClasses[geneIx];
+		classTally[c]++;
+		if(hitsHash == NULL){continue;}
+		for(k=0; k<context->classTermCounts[c]; k++)
+		{
+			t = context->classTerms[c][k];
+			if(gene->name == NULL){errAbort("Error: told to list names, but hit has not name");}
+			hashAdd(hitsHash, context->termNames[t], cloneString(gene->name));
+		}
+	}
+	addClassTally(context, classTally, retCounts);
+	freeMem(classTally);
+}
+
+
+static struct packedIntervals *walkedPackedElements(struct chromShard *shard)
+/* the packed elements of shard when they are the ones to walk, otherwise NULL */
+{
+	if(shard->packed || shard->elements == NULL){return(shard->packedElements);}
+	return(NULL);
+}
+
+
+static struct chromShard *pointGeneSide(struct shardWork *work, struct chromShard *shard)
+/* The context's shard of the chromosome when every element of shard is one */
+/* base long, so that its point index can be used, otherwise NULL */
+{
+	struct chromShard *geneSide = hashFindVal(work->context->shardHash, shard->chrom);
+	struct packedIntervals *packed = walkedPackedElements(shard);
+	struct bedLong *futon = NULL;
+	int i = 0;
+
+	if(geneSide == NULL || geneSide->pointIndex == NULL){return(NULL);}
+	if(packed != NULL)
+	{
+		for(i=0; i<packed->count; i++)
+		{
+			if(packed->ends[i] - packed->starts[i] != 1){return(NULL);}
+		}
+	}
+	else
+	{
+		for(futon=shard->elements; futon != NULL; futon=futon->next)
+		{
+			if(futon->chromEnd - futon->chromStart != 1){return(NULL);}
+		}
+	}
+	return(geneSide);
+}
+
+
+static int *pointSegments(struct chromShard *shard, struct pointIndex *pi, int *retCount)
+/* the point index segment of each element of shard, in order, -1 outside every domain */
+{
+	struct packedIntervals *packed = walkedPackedElements(shard);
+	struct bedLong *futon = shard->elements;
+	int *segments = NULL, count = 0, i = 0, segment = -1;
+
+	count = (packed != NULL) ? packed->count : slCount(shard->elements);
+	AllocArray(segments, max(count,1));
+	for(i=0; i<count; i++)
+	{
+		if(packed != NULL){segment = pointIndexNext(pi, segment, packed->starts[i]);}
+		else
+		{
+			segment = pointIndexNext(pi, segment, futon->chromStart);
+			futon = futon->next;
+		}
+		segments[i] = segment;
+	}
+	*retCount = count;
+	return(segments);
+}
+
+
+static int *pointGeneFlags(struct chromShard *shard, struct chromShard *geneSide, int *segments, int count, int *retHitCount)
+/* flags the genes of shard hit by any of its one base elements, like bedLongOverlapFlags */
+{
+	struct pointIndex *pi = geneSide->pointIndex;
+	int *flags = NULL, geneOffset = shard->geneClasses - geneSide->geneClasses;
+	int i = 0, j = 0, g = 0;
+
+	AllocArray(flags, max(slCount(shard->genes),1));
+	*retHitCount = 0;
+	for(i=0; i<count; i++)
+	{
+		if(segments[i] < 0 || (i > 0 && segments[i] == segments[i-1])){continue;}
+		for(j=pi->offsets[segments[i]]; j<pi->offsets[segments[i]+1]; j++)
+		{
+			g = pi->domains[j] - geneOffset;
+			if(!flags[g])
+			{
+				flags[g] = 1;
+				(*retHitCount)++;
+			}
+		}
+	}
+	return(flags);
+}
+
+
+/* labelPoints is stamped out the same way, for whether the points carry */
+/* counts and whether names are kept */
+
+#define LABEL_POINTS(labeler, WEIGHTED, NAMES) \
+static void labeler(struct shardWork *work, struct chromShard *geneSide, int *segments, int *weights, int count, long *retCounts, struct hash *hitsHash) \
+{ \
+	struct enrichContext *context = work->context; \
+	struct pointIndex *pi = geneSide->pointIndex; \
+	struct bedLong *gene = NULL, **genes = NULL; \
+	long *classTally = NULL; \
+	int *stamp = NULL, i = 0, j = 0, g = 0, t = 0, c = 0, k = 0, r = 0, label = 0, weight = 1; \
+	\
+	if(NAMES) \
+	{ \
+		AllocArray(genes, max(slCount(geneSide->genes),1)); \
+		for(gene=geneSide->genes, g=0; gene != NULL; gene=gene->next, g++) \
+			genes[g] = gene; \
+	} \
+	AllocArray(classTally, max(context->classCount,1)); \
+	AllocArray(stamp, max(context->termCount,1)); \
+	for(t=0; t<context->termCount; t++) \
+		stamp[t] = -1; \
+	\
+	for(i=0; i<count; i++) \
+	{ \
+		if(segments[i] < 0 || (label = pi->labels[segments[i]]) == -1){continue;} \
+		if(WEIGHTED){weight = weights[i];} \
+		if(!NAMES && label >= 0) \
+		{ \
+			classTally[label] += weight; \
+			continue; \
+		} \
+		for(j=pi->offsets[segments[i]]; j<pi->offsets[segments[i]+1]; j++) \
+		{ \
+			g = pi->domains[j]; \
+			c = geneSide->geneClasses[g]; \
+			for(k=0; k<context->classTermCounts[c]; k++) \
+			{ \
+				t = context->classTerms[c][k]; \
+				if(stamp[t] == i){continue;} \
+				stamp[t] = i; \
+				retCounts[t] += weight; \
+				if(NAMES) \
+				{ \
+					if(genes[g]->name == NULL){errAbort("Error: told to list names, but hit has not name");} \
+					for(r=0; r<weight; r++) \
+						hashAdd(hitsHash, context->termNames[t], cloneString(genes[g]->name)); \
+				} \
+			} \
+		} \
+	} \
+	addClassTally(context, classTally, retCounts); \
+	freeMem(classTally); \
+	freeMem(stamp); \
+	freeMem(genes); \
+}
+
+LABEL_POINTS(labelPoints00, 0, 0)
+LABEL_POINTS(labelPoints10, 1, 0)
+LABEL_POINTS(labelPoints01, 0, 1)
+LABEL_POINTS(labelPoints11, 1, 1)
+
+
+static void labelPoints(struct shardWork *work, struct chromShard *geneSide, int *segments, int *weights, int count, long *retCounts, struct hash *hitsHash)
+{
+	/* labelRecords for one base elements.  The domains each one is in, */
+	/* and whether they are all of one class, come from its segment.  Each */
+	/* counts weights[i] times, or once when weights is NULL. */
+	static void (*labels[4])(struct shardWork *, struct chromShard *, int *, int *, int, long *, struct hash *) =
+		{labelPoints00, labelPoints10, labelPoints01, labelPoints11};
+
+	labels[(weights != NULL) | ((hitsHash != NULL) << 1)](work, geneSide, segments, weights, count, retCounts, hitsHash);
+}
+
+
+void geneSideTotalsShardJob(void *context, int shardIx)
+{
+	/* the balls and white balls, which only depend on the gene side */
+	struct shardWork *work = (struct shardWork *)context;
+	struct enrichContext *ec = work->context;
+	struct chromShard *shard = work->shards[shardIx];
+	struct shardCounts *counts = &work->counts[shardIx];
+
+	struct allowedChrom *allowedChrom = NULL;
+
+	if(ec->options.test == enrichBinomial)
+	{
+		allowedChrom = allowedIndexChrom(ec->allowed, shard->chrom);
+		counts->totalBalls = allowedChromTotal(allowedChrom);
+		bedLongGoBasesByTerm(shard->genes, ec->termIdHash, ec->termCount, allowedChrom, counts->whiteBalls);
+	}
+	else if(ec->options.test == enrichHypergeometric)
+	{
+		counts->totalBalls = slCount(shard->genes);
+		countClassGenes(work, shard, NULL, counts->whiteBalls, NULL);
+	}
+	else if(ec->options.test == enrichNullModel)
+	{
+		counts->totalBalls = (shard->packedLargeSet != NULL) ? shard->packedLargeSet->count : slCount(shard->largeSet);
+		labelLargeSet(work, shard, NULL, counts);
+	}
+}
+
+
+void nullModelShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx];
+	struct shardCounts *counts = &work->counts[shardIx];
+	int *picked = NULL, recordCount = 0, i = 0;
+
+	if(chromShardPack(shard))
+	{
+		recordCount = shard->packedLargeSet->count;
+		AllocArray(picked, max(recordCount,1));
+		packedOverlapFlags(shard->packedLargeSet, shard->packedElements, picked);
+	}
+	else
+	{
+		recordCount = slCount(shard->largeSet);
+		AllocArray(picked, max(recordCount,1));
+		bedLongOverlapFlags(shard->largeSet, shard->elements, picked);
+	}
+	for(i=0; i<recordCount; i++)
+	{
+		if(picked[i]){counts->totalPicks++;}
+	}
+	labelLargeSet(work, shard, picked, counts);
+	freeMem(picked);
+}
+
+
+void hypergeometricTotalsShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx], *geneSide = NULL;
+	struct shardCounts *counts = &work->counts[shardIx];
+	int *segments = NULL, *flags = NULL, count = 0, hitCount = 0;
+
+	chromShardPack(shard);
+	if((geneSide = pointGeneSide(work, shard)) != NULL)
+	{
+		segments = pointSegments(shard, geneSide->pointIndex, &count);
+		flags = pointGeneFlags(shard, geneSide, segments, count, &hitCount);
+		counts->totalPicks = hitCount;
+		freeMem(flags);
+		freeMem(segments);
+	}
+	else if(shard->packed){counts->totalPicks = packedIntersectCount(shard->packedGenes,shard->packedElements);}
+	else{counts->totalPicks = bedLongIntersectCount(shard->genes,shard->elements);}
+}
+
+
+static int *shardGeneFlags(struct shardWork *work, struct chromShard *shard)
+/* flags the genes of shard whose domains are hit by any element */
+{
+	struct chromShard *geneSide = NULL;
+	int *flags = NULL, *segments = NULL, count = 0, hitCount = 0;
+
+	if((geneSide = pointGeneSide(work, shard)) != NULL)
+	{
+		segments = pointSegments(shard, geneSide->pointIndex, &count);
+		flags = pointGeneFlags(shard, geneSide, segments, count, &hitCount);
+		freeMem(segments);
+	}
+	else
+	{
+		AllocArray(flags, max(slCount(shard->genes),1));
+		if(shard->packed){packedOverlapFlags(shard->packedGenes, shard->packedElements, flags);}
+		else{bedLongOverlapFlags(shard->genes, shard->elements, flags);}
+	}
+	return(flags);
+}
+
+
+void hypergeometricPicksShardJob(void *context, int shardIx)
+{
+	/* a gene is a picked white ball for all of its terms if any element hits its domain */
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx];
+	struct shardCounts *counts = &work->counts[shardIx];
+	int *flags = shardGeneFlags(work, shard);
+
+	countClassGenes(work, shard, flags, counts->whiteBallsPicked, counts->hitsHash);
+	freeMem(flags);
+}
+
+
+void binomialTotalsShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx], *geneSide = NULL;
+	struct shardCounts *counts = &work->counts[shardIx];
+	boolean countUnassigned = work->context->options.countUnassigned;
+	struct pointIndex *pi = NULL;
+	int *segments = NULL, *weights = NULL, count = 0, i = 0;
+
+	chromShardPack(shard);
+	if(!countUnassigned && (geneSide = pointGeneSide(work, shard)) != NULL)
+	{
+		pi = geneSide->pointIndex;
+		segments = pointSegments(shard, pi, &count);
+		weights = shard->packed ? shard->packedElements->counts : NULL;
+		for(i=0; i<count; i++)
+		{
+			if(segments[i] >= 0 && pi->offsets[segments[i]+1] > pi->offsets[segments[i]]){counts->totalPicks += (weights != NULL) ? weights[i] : 1;}
+		}
+		freeMem(segments);
+	}
+	else if(shard->packed)
+	{
+		if(countUnassigned){counts->totalPicks = packedRecordCount(shard->packedElements);}
+		else{counts->totalPicks = packedIntersectCount(shard->packedElements,shard->packedGenes);}
+	}
+	else
+	{
+		if(countUnassigned){counts->totalPicks = slCount(shard->elements);}
+		else{counts->totalPicks = bedLongIntersectCount(shard->elements,shard->genes);}
+	}
+}
+
+
+void binomialPicksShardJob(void *context, int shardIx)
+{
+	/* an element is a picked white ball for every term of the domains it hits */
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx], *geneSide = NULL;
+	struct shardCounts *counts = &work->counts[shardIx];
+	int *segments = NULL, count = 0;
+
+	if((geneSide = pointGeneSide(work, shard)) != NULL)
+	{
+		segments = pointSegments(shard, geneSide->pointIndex, &count);
+		labelPoints(work, geneSide, segments, shard->packed ? shard->packedElements->counts : NULL, count, counts->whiteBallsPicked, counts->hitsHash);
+		freeMem(segments);
+	}
+	else if(shard->packed){labelRecords(work, shard, NULL, shard->packedElements, NULL, counts->whiteBallsPicked, counts->hitsHash);}
+	else{labelRecords(work, shard, shard->elements, NULL, NULL, counts->whiteBallsPicked, counts->hitsHash);}
+}
+
+
+struct nearestGenes
+/* the genes of one chromosome as they are, for finding the one nearest an element */
+{
+	struct bedLong **genes;   /* sorted by start */
+	int *reach;               /* by place i, the gene of genes[0] to genes[i] that ends furthest, the first of equals */
+	int count;
+};
+
+
+static struct nearestGenes *nearestGenesNew(struct bedLong *genes)
+/* genes must be sorted by start */
+{
+	struct nearestGenes *ng = NULL;
+	struct bedLong *gene = NULL;
+	int i = 0;
+
+	AllocVar(ng);
+	ng->count = slCount(genes);
+	AllocArray(ng->genes, max(ng->count,1));
+	AllocArray(ng->reach, max(ng->count,1));
+	for(gene=genes, i=0; gene != NULL; gene=gene->next, i++)
+	{
+		ng->genes[i] = gene;
+		ng->reach[i] = (i > 0 && ng->genes[ng->reach[i-1]]->chromEnd >= gene->chromEnd) ? ng->reach[i-1] : i;
+	}
+	return(ng);
+}
+
+
+static void nearestGenesFree(struct nearestGenes **pNg)
+{
+	struct nearestGenes *ng = *pNg;
+	if(ng == NULL){return;}
+	freeMem(ng->genes);
+	freeMem(ng->reach);
+	freez(pNg);
+}
+
+
+static void endAssignment(struct nearestGenes *ng, struct bedLong *element, struct dyString *out)
+/* Ends the line of element, first adding the gene nearest it and the */
+/* distanceBetweenBeds to that gene when ng is given.  Of the genes that */
+/* start before the element ends, the one that ends furthest is the */
+/* nearest, and of the others the first to start, so only those two are */
+/* measured.  A tie goes to the gene before. */
+{
+	struct bedLong *before = NULL, *after = NULL, *nearest = NULL;
+	int lo = 0, hi = 0, mid = 0;
+
+	if(ng != NULL)
+	{
+		hi = ng->count;
+		while(lo < hi)
+		{
+			mid = (lo + hi) / 2;
+			if(ng->genes[mid]->chromStart < element->chromEnd){lo = mid + 1;}
+			else{hi = mid;}
+		}
+		if(lo > 0){before = ng->genes[ng->reach[lo-1]];}
+		if(lo < ng->count){after = ng->genes[lo];}
+		if(before == NULL){nearest = after;}
+		else if(after == NULL){nearest = before;}
+		else{nearest = (distanceBetweenBeds(element, before) <= distanceBetweenBeds(element, after)) ? before : after;}
+		if(nearest == NULL){dyStringPrintf(out, "\tNONE\tNONE");}
+		else{dyStringPrintf(out, "\t%s\t%ld", nearest->name, distanceBetweenBeds(element, nearest));}
+	}
+	dyStringAppendC(out, '\n');
+}
+
+
+struct elementCursor
+/* walks the elements of a shard as bedLongs, whether listed or packed */
+{
+	struct bedLong *list;
+	struct packedIntervals *packed;
+	int ix, repeat;
+	struct bedLong scratch;           /* the packed element being looked at */
+};
+
+
+static void elementCursorInit(struct elementCursor *cursor, struct chromShard *shard)
+{
+	ZeroVar(cursor);
+	cursor->list = shard->elements;
+	if(shard->elements == NULL){cursor->packed = shard->packedElements;}
+	cursor->ix = -1;
+	cursor->scratch.chrom = shard->chrom;
+}
+
+
+static struct bedLong *elementCursorNext(struct elementCursor *cursor)
+/* The next element, NULL at the end.  A packed element is given back as */
+/* many times as it was repeated, each time in the same scratch bedLong. */
+{
+	struct packedIntervals *packed = cursor->packed;
+	struct bedLong *futon = cursor->list;
+
+	if(packed == NULL)
+	{
+		if(futon != NULL){cursor->list = futon->next;}
+		return(futon);
+	}
+	if(cursor->repeat > 0)
+	{
+		cursor->repeat--;
+		return(&cursor->scratch);
+	}
+	if(++cursor->ix >= packed->count){return(NULL);}
+	cursor->repeat = ((packed->counts != NULL) ? packed->counts[cursor->ix] : 1) - 1;
+	cursor->scratch.chromStart = packed->starts[cursor->ix];
+	cursor->scratch.chromEnd = packed->ends[cursor->ix];
+	cursor->scratch.name = (packed->nameIds != NULL) ? packedName(packed->names, packed->nameIds[cursor->ix]) : NULL;
+	return(&cursor->scratch);
+}
+
+
+void assignmentStyle(struct elementCursor *elements, struct bedLong *genesList, struct bedLong *unexpandedGeneList, struct nearestGenes *ng, struct dyString *out)
+{
+	struct bedLong *bedLongOne = NULL, *bedLongTwo = NULL;
+
+	bedLongOne = elementCursorNext(elements);
+	bedLongTwo = genesList;
+
+	while(bedLongOne != NULL && bedLongTwo != NULL)
+	{
+		if(bedLongOverlap(bedLongOne,bedLongTwo))
+		{
+			dyStringPrintf(out,"%s\t%ld\t%ld\t%s\t%s\t%ld",bedLongOne->chrom, bedLongOne->chromStart, bedLongOne->chromEnd, bedLongOne->name, bedLongTwo->name, distanceBetweenBeds(bedLongOne, findNameInBedLongList(unexpandedGeneList, bedLongTwo->name)));
+			endAssignment(ng, bedLongOne, out);
+			bedLongOne = elementCursorNext(elements);
+		}
+		else if(bedLongCmpEnd(bedLongOne,bedLongTwo) < 0)
+		{
+			dyStringPrintf(out,"%s\t%ld\t%ld\t%s\tNONE\tNONE",bedLongOne->chrom, bedLongOne->chromStart, bedLongOne->chromEnd, bedLongOne->name);
+			endAssignment(ng, bedLongOne, out);
+			bedLongOne = elementCursorNext(elements);
+		}
+		else{bedLongTwo = bedLongTwo->next;}
+	}
+	while(bedLongOne != NULL)
+	{
+		dyStringPrintf(out,"%s\t%ld\t%ld\t%s\tNONE\tNONE",bedLongOne->chrom, bedLongOne->chromStart, bedLongOne->chromEnd, bedLongOne->name);
+		endAssignment(ng, bedLongOne, out);
+		bedLongOne = elementCursorNext(elements);
+	}
+}
+
+
+void assignPoints(struct chromShard *shard, struct chromShard *geneSide, struct nearestGenes *ng, struct dyString *out)
+{
+	/* assignmentStyle for one base elements.  The first domain of an */
+	/* element's segment is the first in the list it overlaps, the one the */
+	/* merge join would give it. */
+	struct pointIndex *pi = geneSide->pointIndex;
+	struct hash *unexpandedHash = newHash(12);
+	struct elementCursor elements;
+	struct bedLong *futon = NULL, *gene = NULL, **genes = NULL;
+	int g = 0, segment = -1;
+
+	AllocArray(genes, max(slCount(geneSide->genes),1));
+	for(gene=geneSide->genes, g=0; gene != NULL; gene=gene->next, g++)
+		genes[g] = gene;
+	//findNameInBedLongList gives the first gene with the name
+	for(gene=shard->unexpandedGenes; gene != NULL; gene=gene->next)
+	{
+		if(hashLookup(unexpandedHash, gene->name) == NULL){hashAdd(unexpandedHash, gene->name, gene);}
+	}
+
+	elementCursorInit(&elements, shard);
+	while((futon = elementCursorNext(&elements)) != NULL)
+	{
+		segment = pointIndexNext(pi, segment, futon->chromStart);
+		if(segment >= 0 && pi->offsets[segment+1] > pi->offsets[segment])
+		{
+			gene = genes[pi->domains[pi->offsets[segment]]];
+			dyStringPrintf(out,"%s\t%ld\t%ld\t%s\t%s\t%ld",futon->chrom, futon->chromStart, futon->chromEnd, futon->name, gene->name, distanceBetweenBeds(futon, hashFindVal(unexpandedHash, gene->name)));
+		}
+		else
+			dyStringPrintf(out,"%s\t%ld\t%ld\t%s\tNONE\tNONE",futon->chrom, futon->chromStart, futon->chromEnd, futon->name);
+		endAssignment(ng, futon, out);
+	}
+	freeMem(genes);
+	freeHash(&unexpandedHash);
+}
+
+
+void assignmentShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx], *geneSide = NULL;
+	struct shardCounts *counts = &work->counts[shardIx];
+	struct nearestGenes *ng = NULL;
+	struct elementCursor elements;
+
+	counts->output = newDyString(4096);
+	if(work->context->options.nearestGene){ng = nearestGenesNew(shard->unexpandedGenes);}
+	if((geneSide = pointGeneSide(work, shard)) != NULL){assignPoints(shard, geneSide, ng, counts->output);}
+	else
+	{
+		elementCursorInit(&elements, shard);
+		assignmentStyle(&elements, shard->genes, shard->unexpandedGenes, ng, counts->output);
+	}
+	nearestGenesFree(&ng);
+}
+
+
+void pointIndexShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx];
+
+	shard->pointIndex = pointIndexNew(shard->genes, shard->geneClasses);
+}
+
+
+static int mergeRegions(struct bedLong **pList)
+/* Joins the overlapping and touching records of a list sorted by start, */
+/* so that it holds disjoint intervals, and returns how many records were */
+/* joined into the one before and freed. */
+{
+	struct bedLong *futon = NULL, *last = NULL, *next = NULL;
+	int merged = 0;
+
+	for(futon=*pList; futon != NULL; futon=next)
+	{
+		next = futon->next;
+		if(last != NULL && futon->chromStart <= last->chromEnd)
+		{
+			last->chromEnd = max(last->chromEnd, futon->chromEnd);
+			last->next = next;
+			bedLongFree(&futon);
+			merged++;
+		}
+		else{last = futon;}
+	}
+	return(merged);
+}
+
+
+static int longCmp(const void *va, const void *vb)
+{
+	long a = *((const long *)va), b = *((const long *)vb);
+	if(a < b){return(-1);}
+	if(a > b){return(1);}
+	return(0);
+}
+
+
+static int countRepeats(struct bedLong *list, struct packedIntervals *packed)
+/* Records with the same start and end as another one before them, in a */
+/* list or packed intervals sorted by start.  Records with the same start */
+/* are rare outside of repeats, so only the ends of those runs are sorted. */
+{
+	struct bedLong *futon = list;
+	long *ends = NULL, start = 0, end = 0, runStart = -1;
+	int recordCount = 0, runCount = 0, endAlloc = 16, repeats = 0, i = 0, k = 0;
+
+	recordCount = (packed != NULL) ? packed->count : slCount(list);
+	AllocArray(ends, endAlloc);
+	for(i=0; i<=recordCount; i++)
+	{
+		if(i < recordCount && packed != NULL)
+		{
+			start = packed->starts[i];
+			end = packed->ends[i];
+		}
+		else if(i < recordCount)
+		{
+			start = futon->chromStart;
+			end = futon->chromEnd;
+			futon = futon->next;
+		}
+		if(i == recordCount || start != runStart)
+		{
+			if(runCount > 1)
+			{
+				qsort(ends, runCount, sizeof(long), longCmp);
+				for(k=1; k<runCount; k++)
+					repeats += (ends[k] == ends[k-1]);
+			}
+			runStart = start;
+			runCount = 0;
+		}
+		if(runCount == endAlloc)
+		{
+			ExpandArray(ends, endAlloc, 2*endAlloc);
+			endAlloc *= 2;
+		}
+		ends[runCount++] = end;
+	}
+	freeMem(ends);
+	return(repeats);
+}
+
+
+void prepareShardJob(void *context, int shardIx)
+{
+	/* sort every list, join the okRegions into disjoint intervals, keep a */
+	/* copy of the genes as they are, expand the genes into their domains */
+	/* and pack what fits */
+	struct shardWork *work = (struct shardWork *)context;
+	struct enrichOptions *options = &work->context->options;
+	struct chromShard *shard = work->shards[shardIx];
+	struct shardCounts *counts = &work->counts[shardIx];
+
+	slSort(&shard->genes, bedLongCmp);
+	slSort(&shard->okRegions, bedLongCmp);
+	slSort(&shard->largeSet, bedLongCmp);
+	counts->regionsMerged = mergeRegions(&shard->okRegions);
+	counts->largeSetRepeats = countRepeats(shard->largeSet, shard->packedLargeSet);
+
+	shard->unexpandedGenes = cloneBedLongList(shard->genes);
+	if(options->maxExpansion != 0)
+	{
+		if(options->noExpansionOverlap)
+			expandBedLongListToNeighbor(shard->genes,options->maxExpansion);
+		else
+			expandBedLongListByDistance(shard->genes,options->maxExpansion);
+	}
+	chromShardPackGeneSide(shard);
+}
+
+
+struct slName *filterGoTermsBySize(struct enrichOptions *options, struct slName *goTerms, struct bedLong *genesList, struct enrichContextStats *stats)
+{
+	/* keeps the terms that are on between minTermSize and maxTermSize genes */
+	struct hash *sizeHash = newHash(12);
+	struct hashEl *hel = NULL;
+	struct bedLong *gene = NULL;
+	struct slName *goTerm = NULL, *keep = NULL, *next = NULL;
+	int size = 0, dropped = 0;
+
+	for(gene=genesList; gene != NULL; gene=gene->next)
+	{
+		for(goTerm=gene->goTerms; goTerm != NULL; goTerm=goTerm->next)
+		{
+			hel = hashStore(sizeHash, goTerm->name);
+			hel->val = intToPt(ptToInt(hel->val) + 1);
+		}
+	}
+	for(goTerm=goTerms; goTerm != NULL; goTerm=next)
+	{
+		next = goTerm->next;
+		size = hashIntValDefault(sizeHash, goTerm->name, 0);
+		if(size < options->minTermSize || (options->maxTermSize > 0 && size > options->maxTermSize))
+		{
+			slNameFree(&goTerm);
+			dropped++;
+		}
+		else
+			slAddHead(&keep, goTerm);
+	}
+	slReverse(&keep);
+	stats->termsDropped = dropped;
+	stats->termsSized = dropped + slCount(keep);
+	freeHash(&sizeHash);
+	return(keep);
+}
+
+
+boolean loadCompact(char *fileName, int threads, boolean keepNames, struct packedChrom **retList, struct packedNames **retNames)
+{
+	/* Loads the coordinates of a file straight into 32 bit packed arrays, */
+	/* reading no more columns than it needs.  With keepNames the names in */
+	/* the fourth column are kept too, in *retNames.  Returns */
+	/* FALSE when keepNames is asked of a file without names, which is read */
+	/* as a list as it always was, or when its coordinates need 64 bits. */
+	struct packedNames *names = NULL;
+	int fieldCount = bedLongFileFieldCount(fileName);
+
+	if(fieldCount < 3 || (keepNames && fieldCount < 4)){return(FALSE);}
+	if(keepNames){names = packedNamesNew();}
+	if(!chunkedPackedChromLoad(fileName, threads, names, retList))
+	{
+		verbose(2, "Coordinates in %s are too large for 32 bits, loading it with 64 bit coordinates\n", fileName);
+		packedNamesFree(&names);
+		return(FALSE);
+	}
+	if(names != NULL)
+	{
+		packedNamesDone(names);
+		verbose(2, "Loaded %s as compact 32 bit intervals with %d names\n", fileName, names->count);
+	}
+	else{verbose(2, "Loaded %s as compact 32 bit intervals\n", fileName);}
+	*retNames = names;
+	return(TRUE);
+}
+
+struct slName *sliceGoTerms(struct enrichOptions *options, struct slName *goTerms, struct enrichContextStats *stats)
+{
+	/* keeps slice termSlice of termSlices equal runs of the terms, in order, */
+	/* so that separate runs can each test one slice */
+	struct slName *goTerm = NULL, *keep = NULL, *next = NULL;
+	int count = slCount(goTerms), first = 0, last = 0, i = 0;
+
+	first = (int)((long)count * options->termSlice / options->termSlices);
+	last = (int)((long)count * (options->termSlice + 1) / options->termSlices);
+	for(goTerm=goTerms, i=0; goTerm != NULL; goTerm=next, i++)
+	{
+		next = goTerm->next;
+		if(i < first || i >= last){slNameFree(&goTerm);}
+		else{slAddHead(&keep, goTerm);}
+	}
+	slReverse(&keep);
+	stats->termsSliced = count;
+	stats->sliceFirst = first;
+	stats->sliceEnd = last;
+	return(keep);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static int intCmp(const void *va, const void *vb)
+{
+	return(*((int *)va) - *((int *)vb));
+}
+
+
+static void assignGeneClasses(struct enrichContext *context)
+/* Genes with the same set of tested terms are put in one class, so that */
+/* the counting can tally classes and only turn them into term counts at */
+/* the end.  Each shard gets the class of every gene in its list order. */
+{
+	struct hash *classHash = newHash(12);
+	struct chromShard *shard = NULL;
+	struct bedLong *gene = NULL;
+	struct slName *goTerm = NULL;
+	struct dyString *key = dyStringNew(256);
+	int *ids = NULL, idAlloc = 16, idCount = 0, classAlloc = 64, geneIx = 0, geneCount = 0, i = 0, t = 0;
+	struct hashEl *hel = NULL;
+
+	AllocArray(ids, idAlloc);
+	AllocArray(context->classTermCounts, classAlloc);
+	AllocArray(context->classTerms, classAlloc);
+	for(shard=context->shardList; shard != NULL; shard=shard->next)
+	{
+		AllocArray(shard->geneClasses, max(slCount(shard->genes),1));
+		for(gene=shard->genes, geneIx=0; gene != NULL; gene=gene->next, geneIx++)
+		{
+			idCount = 0;
+			for(goTerm=gene->goTerms; goTerm != NULL; goTerm=goTerm->next)
+			{
+				if((t = hashIntValDefault(context->termIdHash, goTerm->name, -1)) < 0){continue;}
+				if(idCount == idAlloc)
+				{
+					ExpandArray(ids, idAlloc, 2*idAlloc);
+					idAlloc *= 2;
+				}
+				ids[idCount++] = t;
+			}
+			qsort(ids, idCount, sizeof(int), intCmp);
+			dyStringClear(key);
+			for(i=0; i<idCount; i++)
+			{
+				if(i > 0 && ids[i] == ids[i-1]){continue;}
+				dyStringPrintf(key, "%d,", ids[i]);
+			}
+
+			if((hel = hashLookup(classHash, key->string)) == NULL)
+			{
+				if(context->classCount == classAlloc)
+				{
+					ExpandArray(context->classTermCounts, classAlloc, 2*classAlloc);
+					ExpandArray(context->classTerms, classAlloc, 2*classAlloc);
+					classAlloc *= 2;
+				}
+				AllocArray(context->classTerms[context->classCount], max(idCount,1));
+				for(i=0; i<idCount; i++)
+				{
+					if(i > 0 && ids[i] == ids[i-1]){continue;}
+					context->classTerms[context->classCount][context->classTermCounts[context->classCount]++] = ids[i];
+				}
+				hel = hashAddInt(classHash, key->string, context->classCount++);
+			}
+			shard->geneClasses[geneIx] = ptToInt(hel->val);
+			geneCount++;
+		}
+	}
+	verbose(2,"Grouped %d genes into %d classes with the same terms\n", geneCount, context->classCount);
+	dyStringFree(&key);
+	freeMem(ids);
+	freeHash(&classHash);
+}
+
+
+struct termClasses
+/* the classes a term is found in, in class order */
+{
+	int term;
+	int count;
+	int *classes;
+};
+
+
+static boolean sameClasses(struct termClasses *a, struct termClasses *b)
+{
+	return(a->count == b->count && memcmp(a->classes, b->classes, a->count * sizeof(int)) == 0);
+}
+
+
+static int termClassesCmp(const void *va, const void *vb)
+/* by the classes, then by term, so the terms with the same classes end */
+/* up together with the first of them in front */
+{
+	const struct termClasses *a = (const struct termClasses *)va;
+	const struct termClasses *b = (const struct termClasses *)vb;
+	int i = 0;
+
+	if(a->count != b->count){return(a->count - b->count);}
+	for(i=0; i<a->count; i++)
+	{
+		if(a->classes[i] != b->classes[i]){return(a->classes[i] - b->classes[i]);}
+	}
+	return(a->term - b->term);
+}
+
+
+static void assignTermReps(struct enrichContext *context)
+/* Terms found in exactly the same classes have exactly the same genes, */
+/* so only the first of them, their rep, is kept in the classes and */
+/* counted.  The others are given the counts of their rep afterwards. */
+/* The class lists of the terms are laid out in one array and sorted, */
+/* which puts the terms with the same genes next to each other. */
+{
+	struct termClasses *lists = NULL, *tc = NULL;
+	int *classes = NULL;
+	long total = 0;
+	int c = 0, i = 0, t = 0, keep = 0, rep = 0;
+
+	AllocArray(lists, max(context->termCount,1));
+	for(c=0; c<context->classCount; c++)
+	{
+		for(i=0; i<context->classTermCounts[c]; i++)
+			lists[context->classTerms[c][i]].count++;
+	}
+	for(t=0; t<context->termCount; t++)
+		total += lists[t].count;
+	classes = needLargeMem(max(total,1) * sizeof(int));
+	for(t=0, total=0; t<context->termCount; t++)
+	{
+		lists[t].term = t;
+		lists[t].classes = classes + total;
+		total += lists[t].count;
+		lists[t].count = 0;
+	}
+	for(c=0; c<context->classCount; c++)
+	{
+		for(i=0; i<context->classTermCounts[c]; i++)
+		{
+			tc = &lists[context->classTerms[c][i]];
+			tc->classes[tc->count++] = c;
+		}
+	}
+	qsort(lists, context->termCount, sizeof(struct termClasses), termClassesCmp);
+
+	AllocArray(context->termReps, max(context->termCount,1));
+	for(i=0; i<context->termCount; i++)
+	{
+		if(i == 0 || !sameClasses(&lists[i-1], &lists[i]))
+		{
+			rep = lists[i].term;
+			context->repCount++;
+		}
+		context->termReps[lists[i].term] = rep;
+	}
+	freeMem(classes);
+	freeMem(lists);
+
+	for(c=0; c<context->classCount; c++)
+	{
+		for(i=0, keep=0; i<context->classTermCounts[c]; i++)
+		{
+			t = context->classTerms[c][i];
+			if(context->termReps[t] == t){context->classTerms[c][keep++] = t;}
+		}
+		context->classTermCounts[c] = keep;
+	}
+	verbose(2,"Found %d distinct gene sets among %d terms\n", context->repCount, context->termCount);
+}
+
+
+static void countGeneSideTotals(struct enrichContext *context)
+/* the balls and white balls of the context's test */
+{
+	struct chromShard **shards = NULL;
+	struct shardWork *work = NULL;
+	struct shardCounts *sum = NULL;
+	int shardCount = 0;
+
+	if(context->options.test == enrichNone)
+	{
+		AllocArray(context->whiteBalls, max(context->termCount,1));
+		return;
+	}
+	shards = chromShardArray(context->shardList, &shardCount);
+	work = newShardWork(context, shards, shardCount, FALSE);
+	verbose(2,"Counting the balls on %d chromosomes\n", shardCount);
+	jobPoolRun(context->options.threads, shardCount, geneSideTotalsShardJob, work);
+	sum = sumShardCounts(work, shardCount, NULL);
+	copyFromReps(context, sum->whiteBalls);
+	context->totalBalls = sum->totalBalls;
+	context->whiteBalls = sum->whiteBalls;
+	sum->whiteBalls = NULL;
+	freeShardCounts(&sum);
+	freeShardWork(&work, shardCount);
+	freeMem(shards);
+}
+
+
+static void tallyCanonical(struct shardWork *work, int shardCount, struct enrichContextStats *stats)
+/* what prepareShardJob found the background and largeSet to hold twice */
+{
+	int i = 0;
+
+	for(i=0; i<shardCount; i++)
+	{
+		stats->regionsJoined += work->counts[i].regionsMerged;
+		stats->largeSetRepeats += work->counts[i].largeSetRepeats;
+		stats->regionsLeft += slCount(work->shards[i]->okRegions);
+	}
+}
+
+
+struct enrichContext *enrichContextNew(struct bedLong *genes, struct bedLong *okRegions, struct bedLong *largeSet, struct packedChrom *packedLargeSet, struct enrichOptions *options)
+/* Prepares the gene side once for any number of runs.  The lists are */
+/* taken apart and kept by the context, and packedLargeSet is freed. */
+/* largeSet may come as a list or packed, and is only needed by the */
+/* null model test. */
+{
+	struct enrichContext *context = NULL;
+	struct chromShard *shard = NULL, **shards = NULL;
+	struct shardWork *work = NULL;
+	struct slName *term = NULL;
+	struct bedLong *futon = NULL;
+	int shardCount = 0, t = 0;
+
+	if(options->threads < 1){errAbort("Error: threads must be at least 1");}
+	if(options->termSlices > 0 && (options->termSlice < 0 || options->termSlice >= options->termSlices))
+		errAbort("Error: there is no term slice %d of %d", options->termSlice, options->termSlices);
+	if(options->test == enrichNullModel && largeSet == NULL && packedLargeSet == NULL)
+		errAbort("Error: the null model test needs a largeSet");
+	AllocVar(context);
+	context->options = *options;
+
+	if(options->guessTxStart)
+		bedLongGuessTxStart(genes);
+
+	context->goTerms = extractUniqGoTermsFromBedLong(genes);
+	context->testCountHash = namespaceTestCounts(options, context->goTerms);
+	if(options->minTermSize > 0 || options->maxTermSize > 0)
+		context->goTerms = filterGoTermsBySize(options, context->goTerms, genes, &context->stats);
+	if(options->termSlices > 1)
+		context->goTerms = sliceGoTerms(options, context->goTerms, &context->stats);
+	context->termCount = slCount(context->goTerms);
+	context->termIdHash = newHash(12);
+	AllocArray(context->termNames, max(context->termCount,1));
+	AllocArray(context->testCounts, max(context->termCount,1));
+	for(t=0, term=context->goTerms; term != NULL; t++, term=term->next)
+	{
+		hashAddInt(context->termIdHash, term->name, t);
+		context->termNames[t] = term->name;
+		context->testCounts[t] = termTestCount(options, context->testCountHash, term->name);
+	}
+
+	//split everything up by chromosome, then sort, expand and pack each one
+	verbose(2,"Sorting and expanding by chromosome\n");
+	context->hasLargeSet = (largeSet != NULL || packedLargeSet != NULL);
+	context->shardList = chromShardsFromLists(NULL, NULL, genes, okRegions, largeSet, packedLargeSet);
+	packedChromFreeList(&packedLargeSet);
+	context->shardHash = newHash(8);
+	for(shard=context->shardList; shard != NULL; shard=shard->next)
+		hashAdd(context->shardHash, shard->chrom, shard);
+	shards = chromShardArray(context->shardList, &shardCount);
+	work = newShardWork(context, shards, shardCount, FALSE);
+	jobPoolRun(options->threads, shardCount, prepareShardJob, work);
+	tallyCanonical(work, shardCount, &context->stats);
+	context->allowed = allowedIndexNew();
+	for(shard=context->shardList; shard != NULL; shard=shard->next)
+	{
+		for(futon=shard->okRegions; futon != NULL; futon=futon->next)
+			allowedIndexAdd(context->allowed, futon->chrom, futon->chromStart, futon->chromEnd);
+	}
+	allowedIndexFinish(context->allowed);
+	assignGeneClasses(context);
+	assignTermReps(context);
+	jobPoolRun(options->threads, shardCount, pointIndexShardJob, work);
+
+	freeShardWork(&work, shardCount);
+	freeMem(shards);
+	countGeneSideTotals(context);
+	return(context);
+}
+
+
+struct enrichContext *enrichContextForTest(struct enrichContext *context, enum enrichTest test)
+/* Another context for test that reads the prepared gene side of context */
+/* in place, so that several tests can be run from one load.  Only the */
+/* balls are counted again.  context must outlive it. */
+{
+	struct enrichContext *other = NULL;
+
+	if(context->geneSideOwner != NULL){context = context->geneSideOwner;}
+	if(test == enrichNullModel && !context->hasLargeSet)
+		errAbort("Error: the null model test needs a largeSet");
+	AllocVar(other);
+	*other = *context;
+	other->options.test = test;
+	other->geneSideOwner = context;
+	other->whiteBalls = NULL;
+	countGeneSideTotals(other);
+	return(other);
+}
+
+
+struct backgroundWork
+/* the contexts of enrichContextsForBackgrounds, counted together */
+{
+	struct enrichContext **contexts;
+	int count;
+	struct shardWork **works;   /* by context, the counts of every shard */
+};
+
+
+static void backgroundTotalsShardJob(void *context, int shardIx)
+{
+	/* the binomial balls of every background in one sweep over the domains */
+	struct backgroundWork *bw = (struct backgroundWork *)context;
+	struct enrichContext *ec = bw->contexts[0];
+	struct chromShard *shard = bw->works[0]->shards[shardIx];
+	struct allowedChrom **allowedChroms = NULL;
+	long **bases = NULL;
+	int b = 0;
+
+	AllocArray(allowedChroms, bw->count);
+	AllocArray(bases, bw->count);
+	for(b=0; b<bw->count; b++)
+	{
+		allowedChroms[b] = allowedIndexChrom(bw->contexts[b]->allowed, shard->chrom);
+		bw->works[b]->counts[shardIx].totalBalls = allowedChromTotal(allowedChroms[b]);
+		bases[b] = bw->works[b]->counts[shardIx].whiteBalls;
+	}
+	goBasesByTermMulti(shard->genes, ec->termIdHash, ec->termCount, allowedChroms, bw->count, bases);
+	freeMem(allowedChroms);
+	freeMem(bases);
+}
+
+
+void enrichContextsForBackgrounds(struct enrichContext *context, struct bedLong **okRegionsLists, int count, struct enrichContext **retContexts)
+/* A context for each of count other backgrounds, like enrichContextForTest */
+/* but with the allowed regions of okRegionsLists[i] in retContexts[i]. */
+/* Only the binomial test depends on the background.  The balls of every */
+/* background are counted in one sweep over the domains, and the lists */
+/* are freed.  context must outlive them. */
+{
+	struct backgroundWork bw;
+	struct chromShard **shards = NULL;
+	struct enrichContext *other = NULL;
+	struct shardCounts *sum = NULL;
+	struct bedLong *futon = NULL;
+	int shardCount = 0, b = 0;
+
+	if(context->geneSideOwner != NULL){context = context->geneSideOwner;}
+	if(context->options.test != enrichBinomial){errAbort("Error: only the binomial test depends on the background");}
+	if(count == 0){return;}
+	for(b=0; b<count; b++)
+	{
+		AllocVar(other);
+		*other = *context;
+		other->geneSideOwner = context;
+		other->whiteBalls = NULL;
+		other->allowed = allowedIndexNew();
+		for(futon=okRegionsLists[b]; futon != NULL; futon=futon->next)
+			allowedIndexAdd(other->allowed, futon->chrom, futon->chromStart, futon->chromEnd);
+		allowedIndexFinish(other->allowed);
+		bedLongFreeList(&okRegionsLists[b]);
+		retContexts[b] = other;
+	}
+
+	shards = chromShardArray(context->shardList, &shardCount);
+	ZeroVar(&bw);
+	bw.contexts = retContexts;
+	bw.count = count;
+	AllocArray(bw.works, count);
+	for(b=0; b<count; b++)
+		bw.works[b] = newShardWork(retContexts[b], shards, shardCount, FALSE);
+	verbose(2,"Counting the balls of %d backgrounds on %d chromosomes\n", count, shardCount);
+	jobPoolRun(context->options.threads, shardCount, backgroundTotalsShardJob, &bw);
+	for(b=0; b<count; b++)
+	{
+		sum = sumShardCounts(bw.works[b], shardCount, NULL);
+		copyFromReps(retContexts[b], sum->whiteBalls);
+		retContexts[b]->totalBalls = sum->totalBalls;
+		retContexts[b]->whiteBalls = sum->whiteBalls;
+		sum->whiteBalls = NULL;
+		freeShardCounts(&sum);
+		freeShardWork(&bw.works[b], shardCount);
+	}
+	freeMem(bw.works);
+	freeMem(shards);
+}
+
+
+void enrichContextFree(struct enrichContext **pContext)
+{
+	struct enrichContext *context = *pContext;
+	struct chromShard *shard = NULL;
+	int i = 0;
+
+	if(context == NULL){return;}
+	if(context->geneSideOwner != NULL)
+	{
+		if(context->allowed != context->geneSideOwner->allowed){allowedIndexFree(&context->allowed);}
+		freeMem(context->whiteBalls);
+		freez(pContext);
+		return;
+	}
+	for(shard=context->shardList; shard != NULL; shard=shard->next)
+	{
+		bedLongFreeList(&shard->unexpandedGenes);
+		freez(&shard->geneClasses);
+		pointIndexFree(&shard->pointIndex);
+		freez(&shard->chrom);
+	}
+	chromShardFreeList(&context->shardList);
+	freeHash(&context->shardHash);
+	allowedIndexFree(&context->allowed);
+	slNameFreeList(&context->goTerms);
+	freeHash(&context->termIdHash);
+	freeMem(context->termNames);
+	freeHash(&context->testCountHash);
+	freeMem(context->testCounts);
+	freeMem(context->whiteBalls);
+	for(i=0; i<context->classCount; i++)
+		freeMem(context->classTerms[i]);
+	freeMem(context->classTerms);
+	freeMem(context->classTermCounts);
+	freeMem(context->termReps);
+	freez(pContext);
+}
+
+
+struct slName *enrichNamespaceList(struct enrichContext *context)
+/* the namespaces of the context in sorted order, "all" without the namespaces option */
+{
+	struct hashEl *helList = hashElListHash(context->testCountHash), *hel = NULL;
+	struct slName *list = NULL;
+
+	slSort(&helList, hashElCmp);
+	for(hel=helList; hel != NULL; hel=hel->next)
+		slAddHead(&list, newSlName(hel->name));
+	slReverse(&list);
+	hashElFreeList(&helList);
+	return(list);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static struct elementChrom *elementChromFor(struct enrichElements *elements, char *chrom)
+{
+	struct elementChrom *ec = hashFindVal(elements->chromHash, chrom);
+	if(ec == NULL)
+	{
+		AllocVar(ec);
+		ec->chrom = cloneString(chrom);
+		hashAdd(elements->chromHash, chrom, ec);
+		slAddHead(&elements->chromList, ec);
+	}
+	return(ec);
+}
+
+
+static struct enrichElements *elementsFromLists(struct bedLong *list, struct packedChrom *packedList, struct packedNames *names)
+/* Takes apart list, and takes the packed intervals out of packedList, */
+/* whose names, if they have them, are in names.  Repeats of a packed */
+/* element are folded into it, to be counted by its multiplicity rather */
+/* than looked at again; the ones in a list are kept. */
+{
+	struct enrichElements *elements = NULL;
+	struct elementChrom *ec = NULL;
+	struct packedChrom *pc = NULL;
+	struct bedLong *futon = NULL;
+
+	AllocVar(elements);
+	elements->chromHash = newHash(8);
+	elements->names = names;
+	while((futon = slPopHead(&list)) != NULL)
+	{
+		ec = elementChromFor(elements, futon->chrom);
+		slAddHead(&ec->list, futon);
+		elements->count++;
+	}
+	for(pc=packedList; pc != NULL; pc=pc->next)
+	{
+		ec = elementChromFor(elements, pc->chrom);
+		ec->packed = pc->packed;
+		pc->packed = NULL;
+		elements->count += ec->packed->count;
+	}
+	for(ec=elements->chromList; ec != NULL; ec=ec->next)
+	{
+		slReverse(&ec->list);
+		slSort(&ec->list, bedLongCmp);
+		elements->repeatCount += countRepeats(ec->list, NULL);
+		if(ec->packed != NULL && ec->packed->nameIds != NULL)
+		{
+			//only repeats with the same name are folded, but all of them are reported
+			elements->repeatCount += countRepeats(NULL, ec->packed);
+			packedIntervalsCollapse(ec->packed);
+		}
+		else if(ec->packed != NULL){elements->repeatCount += packedIntervalsCollapse(ec->packed);}
+	}
+	slReverse(&elements->chromList);
+	return(elements);
+}
+
+
+struct enrichElements *enrichElementsFromArray(struct enrichElement *array, int count)
+/* Copies count elements out of array.  They are held as 32 bit packed */
+/* intervals when they fit, with their names when every one has a name. */
+{
+	struct enrichElements *elements = NULL;
+	struct hash *chromHash = NULL;
+	struct packedChrom *packedList = NULL;
+	struct packedNames *names = NULL;
+	struct bedLong *list = NULL, *futon = NULL;
+	int nameCount = 0, i = 0;
+	boolean fits = TRUE;
+
+	for(i=0; i<count; i++)
+	{
+		if(array[i].name != NULL){nameCount++;}
+	}
+	if(nameCount == 0 || nameCount == count)
+	{
+		chromHash = newHash(8);
+		if(nameCount > 0){names = packedNamesNew();}
+		for(i=0; i<count && fits; i++)
+		{
+			if(names != NULL){fits = packedChromAddNamed(chromHash, &packedList, names, array[i].chrom, array[i].start, array[i].end, array[i].name);}
+			else{fits = packedChromAddInterval(chromHash, &packedList, array[i].chrom, array[i].start, array[i].end);}
+		}
+		freeHash(&chromHash);
+		if(fits)
+		{
+			if(names != NULL){packedNamesDone(names);}
+			packedChromFinish(&packedList);
+			elements = elementsFromLists(NULL, packedList, names);
+			packedChromFreeList(&packedList);
+			return(elements);
+		}
+		packedChromFreeList(&packedList);
+		packedNamesFree(&names);
+	}
+
+	for(i=0; i<count; i++)
+	{
+		AllocVar(futon);
+		futon->chrom = cloneString(array[i].chrom);
+		futon->chromStart = array[i].start;
+		futon->chromEnd = array[i].end;
+		futon->name = cloneString(array[i].name);
+		slAddHead(&list, futon);
+	}
+	slReverse(&list);
+	return(elementsFromLists(list, NULL, NULL));
+}
+
+
+struct loadJob
+/* one input file, read at the same time as the others */
+{
+	char *fileName;
+	int threads;                      /* for parsing pieces of the file */
+	boolean compact;                  /* load it as packed intervals if it allows */
+	boolean keepNames;                /* keep the names of the packed intervals */
+	boolean isElements;               /* make an element set of it */
+	struct bedLong *list;
+	struct packedChrom *packedList;
+	struct packedNames *names;
+	struct enrichElements *elements;
+};
+
+
+static void loadFileJob(void *context, int jobIx)
+{
+	struct loadJob *job = &((struct loadJob *)context)[jobIx];
+
+	if(!job->compact || !loadCompact(job->fileName, job->threads, job->keepNames, &job->packedList, &job->names))
+		job->list = chunkedBedLongLoad(job->fileName, job->threads);
+	if(job->isElements)
+	{
+		job->elements = elementsFromLists(job->list, job->packedList, job->names);
+		job->list = NULL;
+		job->names = NULL;
+		packedChromFreeList(&job->packedList);
+	}
+}
+
+
+static void addLoadJob(struct loadJob *jobs, int *pJobCount, char *fileName, boolean compact, boolean keepNames, boolean isElements)
+{
+	struct loadJob *job = &jobs[(*pJobCount)++];
+
+	job->fileName = fileName;
+	job->compact = compact;
+	job->keepNames = keepNames;
+	job->isElements = isElements;
+}
+
+
+static void loadFiles(struct loadJob *jobs, int jobCount, int threads)
+/* Reads every file on its own thread.  The threads asked for are shared */
+/* out for parsing in proportion to file size, so that the biggest file, */
+/* which sets how long this takes, gets the most. */
+{
+	long totalSize = 0;
+	int i = 0;
+
+	for(i=0; i<jobCount; i++)
+		totalSize += max(fileSize(jobs[i].fileName), 1);
+	for(i=0; i<jobCount; i++)
+		jobs[i].threads = max(1, (int)((double)threads * max(fileSize(jobs[i].fileName), 1) / totalSize));
+	verbose(2,"Loading %d files\n", jobCount);
+	jobPoolRun(threads, jobCount, loadFileJob, jobs);
+}
+
+
+struct enrichContext *enrichContextLoadWithElements(char *elementsFile, boolean keepNames, struct enrichElements **retElements, char *genesFile, char *noGapFile, char *largeSetFile, struct enrichOptions *options)
+/* enrichContextLoad that also reads elementsFile, like enrichElementsLoad, */
+/* into *retElements.  All of the files are read and sorted at once on */
+/* options->threads threads.  elementsFile and largeSetFile may be NULL. */
+{
+	struct loadJob jobs[4];
+	int jobCount = 0, genesIx = 0, noGapIx = 0, largeSetIx = 0, elementsIx = 0;
+
+	ZeroVar(&jobs);
+	genesIx = jobCount;
+	addLoadJob(jobs, &jobCount, genesFile, FALSE, FALSE, FALSE);
+	noGapIx = jobCount;
+	addLoadJob(jobs, &jobCount, noGapFile, FALSE, FALSE, FALSE);
+	largeSetIx = jobCount;
+	if(largeSetFile != NULL){addLoadJob(jobs, &jobCount, largeSetFile, TRUE, FALSE, FALSE);}
+	elementsIx = jobCount;
+	if(elementsFile != NULL){addLoadJob(jobs, &jobCount, elementsFile, TRUE, keepNames, TRUE);}
+	loadFiles(jobs, jobCount, options->threads);
+
+	if(elementsFile != NULL){*retElements = jobs[elementsIx].elements;}
+	if(largeSetFile == NULL){return(enrichContextNew(jobs[genesIx].list, jobs[noGapIx].list, NULL, NULL, options));}
+	return(enrichContextNew(jobs[genesIx].list, jobs[noGapIx].list, jobs[largeSetIx].list, jobs[largeSetIx].packedList, options));
+}
+
+
+void enrichContextsForBackgroundFiles(struct enrichContext *context, char **fileNames, int count, struct enrichContext **retContexts)
+/* enrichContextsForBackgrounds on the contents of count files, which are */
+/* read at once on the context's threads */
+{
+	struct loadJob *jobs = NULL;
+	struct bedLong **lists = NULL;
+	int jobCount = 0, i = 0;
+
+	if(count == 0){return;}
+	AllocArray(jobs, count);
+	AllocArray(lists, count);
+	for(i=0; i<count; i++)
+		addLoadJob(jobs, &jobCount, fileNames[i], FALSE, FALSE, FALSE);
+	loadFiles(jobs, jobCount, context->options.threads);
+	for(i=0; i<count; i++)
+		lists[i] = jobs[i].list;
+	enrichContextsForBackgrounds(context, lists, count, retContexts);
+	freeMem(lists);
+	freeMem(jobs);
+}
+
+
+struct enrichContext *enrichContextLoad(char *genesFile, char *noGapFile, char *largeSetFile, struct enrichOptions *options)
+/* enrichContextNew on the contents of the files.  largeSetFile may be NULL. */
+{
+	return(enrichContextLoadWithElements(NULL, FALSE, NULL, genesFile, noGapFile, largeSetFile, options));
+}
+
+
+static double radicalInverse(unsigned int i)
+/* i with its bits reversed behind the binary point, so that the first n */
+/* values of i are spread evenly over [0,1) for every n */
+{
+	i = ((i >> 1) & 0x55555555) | ((i & 0x55555555) << 1);
+	i = ((i >> 2) & 0x33333333) | ((i & 0x33333333) << 2);
+	i = ((i >> 4) & 0x0f0f0f0f) | ((i & 0x0f0f0f0f) << 4);
+	i = ((i >> 8) & 0x00ff00ff) | ((i & 0x00ff00ff) << 8);
+	i = (i >> 16) | (i << 16);
+	return((double)i / 4294967296.0);
+}
+
+
+struct enrichElements *enrichElementsSample(struct enrichElements *elements, double fraction)
+/* About fraction of the elements of each chromosome, spread evenly along */
+/* it.  The element at place i of a chromosome is kept when the radical */
+/* inverse of i is under fraction, so the sample is always the same and the */
+/* sample of a bigger fraction holds every element of a smaller one. */
+{
+	struct enrichElements *sample = NULL;
+	struct elementChrom *ec = NULL, *sampleEc = NULL;
+	struct bedLong *futon = NULL;
+	int i = 0, k = 0, keep = 0, kept = 0, place = 0, copies = 0;
+
+	AllocVar(sample);
+	sample->chromHash = newHash(8);
+	for(ec=elements->chromList; ec != NULL; ec=ec->next)
+	{
+		sampleEc = elementChromFor(sample, ec->chrom);
+		if(ec->packed != NULL)
+		{
+			//each repeat of a folded element keeps its own place
+			sampleEc->packed = packedIntervalsNew(ec->packed->count);
+			if(ec->packed->counts != NULL){AllocArray(sampleEc->packed->counts, max(ec->packed->count,1));}
+			for(i=0, place=0, kept=0, keep=0; i<ec->packed->count; i++)
+			{
+				for(k=(ec->packed->counts != NULL) ? ec->packed->counts[i] : 1, copies=0; k>0; k--, place++)
+					copies += (radicalInverse(place) < fraction);
+				if(copies == 0){continue;}
+				sampleEc->packed->starts[kept] = ec->packed->starts[i];
+				sampleEc->packed->ends[kept] = ec->packed->ends[i];
+				if(sampleEc->packed->counts != NULL){sampleEc->packed->counts[kept] = copies;}
+				kept++;
+				keep += copies;
+			}
+			sampleEc->packed->count = kept;
+		}
+		else
+		{
+			for(futon=ec->list, i=0, keep=0; futon != NULL; futon=futon->next, i++)
+			{
+				if(radicalInverse(i) >= fraction){continue;}
+				slAddHead(&sampleEc->list, cloneBedLong(futon));
+				keep++;
+			}
+			slReverse(&sampleEc->list);
+		}
+		sample->count += keep;
+	}
+	slReverse(&sample->chromList);
+	return(sample);
+}
+
+
+struct enrichElements *enrichElementsLoad(char *fileName, boolean keepNames)
+/* Loads an element bed file, held as 32 bit packed intervals when the */
+/* coordinates fit.  Only keepNames keeps the names of the fourth column, */
+/* and a file without them is then held as bedLongs. */
+{
+	struct loadJob jobs[1];
+	int jobCount = 0;
+
+	ZeroVar(&jobs);
+	addLoadJob(jobs, &jobCount, fileName, TRUE, keepNames, TRUE);
+	loadFiles(jobs, jobCount, 1);
+	return(jobs[0].elements);
+}
+
+
+void enrichElementsFree(struct enrichElements **pElements)
+{
+	struct enrichElements *elements = *pElements;
+	struct elementChrom *ec = NULL;
+
+	if(elements == NULL){return;}
+	while((ec = slPopHead(&elements->chromList)) != NULL)
+	{
+		bedLongFreeList(&ec->list);
+		packedIntervalsFree(&ec->packed);
+		freeMem(ec->chrom);
+		freeMem(ec);
+	}
+	freeHash(&elements->chromHash);
+	packedNamesFree(&elements->names);
+	freez(pElements);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void copyElements(struct chromShard *shard, struct elementChrom *ec)
+{
+	if(ec == NULL){return;}
+	shard->elements = cloneBedLongList(ec->list);
+	if(ec->packed != NULL){shard->packedElements = packedIntervalsSlice(ec->packed, 0, ec->packed->count);}
+}
+
+
+static struct chromShard *runShards(struct enrichContext *context, struct enrichElements *elements)
+/* A shard for every chromosome with genes or elements.  Each reads the */
+/* gene side of the context in place and has its own copy of the elements. */
+/* Big chromosomes are cut up so that one of them does not hold up all the */
+/* threads. */
+{
+	struct chromShard *shardList = NULL, *shard = NULL, *geneSide = NULL;
+	struct elementChrom *ec = NULL;
+	int threads = context->options.threads;
+	long totalSize = 0;
+
+	for(geneSide=context->shardList; geneSide != NULL; geneSide=geneSide->next)
+	{
+		shard = chromShardShare(geneSide);
+		copyElements(shard, hashFindVal(elements->chromHash, geneSide->chrom));
+		slAddHead(&shardList, shard);
+	}
+	for(ec=elements->chromList; ec != NULL; ec=ec->next)
+	{
+		if(hashLookup(context->shardHash, ec->chrom) != NULL){continue;}
+		AllocVar(shard);
+		shard->chrom = ec->chrom;
+		copyElements(shard, ec);
+		slAddHead(&shardList, shard);
+	}
+	slSort(&shardList, chromShardCmp);
+
+	if(threads > 1)
+	{
+		for(shard=shardList; shard != NULL; shard=shard->next)
+			totalSize += chromShardSize(shard);
+		shardList = chromShardSplitLarge(shardList, totalSize / (threads * 2) + 1);
+	}
+	return(shardList);
+}
+
+
+static struct slName *hitsForTerm(struct hash *hitsHash, char *goTerm)
+/* the names hit for goTerm, in the order they were found */
+{
+	struct slName *hits = NULL;
+	struct hashEl *el = NULL;
+
+	for(el = hashLookup(hitsHash, goTerm); el != NULL; el = hashLookupNext(el))
+		slAddHead(&hits, newSlName((char *)el->val));
+	return(hits);
+}
+
+
+static struct enrichResult *newResult(struct enrichContext *context, int t, long whiteBallsPicked, long totalPicks, long whiteBalls, double pValue)
+{
+	struct enrichResult *result = NULL;
+	char namespace[256];
+
+	AllocVar(result);
+	result->term = cloneString(context->termNames[t]);
+	enrichTermNamespace(&context->options, result->term, namespace, sizeof(namespace));
+	result->namespace = cloneString(namespace);
+	result->whiteBallsPicked = whiteBallsPicked;
+	result->totalPicks = totalPicks;
+	result->whiteBalls = whiteBalls;
+	result->totalBalls = context->totalBalls;
+	result->expected = ((double)result->whiteBalls) / ((double)result->totalBalls) * ((double)totalPicks);
+	result->testCount = context->testCounts[t];
+	if(context->options.bonferroni)
+	{
+		pValue *= (double)context->testCounts[t];
+		if(pValue > 1){pValue = 1;}
+	}
+	result->pValue = pValue;
+	return(result);
+}
+
+
+static struct shardCounts *countShards(struct shardWork *work, int shardCount, struct hash *hitsHash, int *retBestCasePruned)
+/* Counts the balls and picks on every shard of work and sums them in */
+/* genome order.  With retBestCasePruned the terms that can not pass are */
+/* turned off between the totals and the picks. */
+{
+	struct enrichOptions *options = &work->context->options;
+	struct shardCounts *sum = NULL;
+	long totalPicks = 0;
+	int i = 0;
+
+	verbose(2,"  Counting %d shards on %d threads\n", shardCount, options->threads);
+	if(options->test == enrichNullModel)
+		jobPoolRun(options->threads, shardCount, nullModelShardJob, work);
+	else
+	{
+		jobPoolRun(options->threads, shardCount, (options->test == enrichBinomial) ? binomialTotalsShardJob : hypergeometricTotalsShardJob, work);
+		if(retBestCasePruned != NULL)
+		{
+			for(i=0; i<shardCount; i++)
+				totalPicks += work->counts[i].totalPicks;
+			*retBestCasePruned = pruneByBestCase(work, totalPicks);
+		}
+		jobPoolRun(options->threads, shardCount, (options->test == enrichBinomial) ? binomialPicksShardJob : hypergeometricPicksShardJob, work);
+	}
+	sum = sumShardCounts(work, shardCount, hitsHash);
+	copyFromReps(work->context, sum->whiteBallsPicked);
+	return(sum);
+}
+
+
+static struct enrichResult *resultsFromCounts(struct enrichContext *context, boolean *active, struct shardCounts *sum, struct hash *hitsHash, int *retExpectedPruned)
+/* the results of the active terms, or of every term when active is NULL, */
+/* leaving out those at or below their expected count that can not pass */
+{
+	struct enrichOptions *options = &context->options;
+	struct enrichResult *results = NULL, *result = NULL;
+	long totalPicks = sum->totalPicks;
+	double *pValues = NULL;
+	boolean *haveP = NULL;
+	int t = 0, r = 0;
+
+	/* terms with the same genes as their rep have its p-value too, only */
+	/* the correction, which counts every term, is done for each of them */
+	AllocArray(pValues, max(context->termCount,1));
+	AllocArray(haveP, max(context->termCount,1));
+	for(t=0; t<context->termCount; t++)
+	{
+		if(active != NULL && !active[t]){continue;}
+		if(cannotPass(options, 0.5, context->testCounts[t]) && atOrBelowExpected(sum->whiteBallsPicked[t], totalPicks, context->whiteBalls[t], context->totalBalls))
+		{
+			(*retExpectedPruned)++;
+			continue;
+		}
+		r = context->termReps[t];
+		if(!haveP[r])
+		{
+			pValues[r] = termPValue(options->test, sum->whiteBallsPicked[r], totalPicks, context->whiteBalls[r], context->totalBalls);
+			haveP[r] = TRUE;
+		}
+		result = newResult(context, t, sum->whiteBallsPicked[t], totalPicks, context->whiteBalls[t], pValues[r]);
+		if(hitsHash != NULL){result->hits = hitsForTerm(hitsHash, context->termNames[r]);}
+		slAddHead(&results, result);
+	}
+	freeMem(pValues);
+	freeMem(haveP);
+	slReverse(&results);
+	return(results);
+}
+
+
+static struct enrichResult *runOnShards(struct enrichContext *context, struct chromShard **shards, int shardCount)
+/* counts and scores the test of context on shards that hold the elements */
+{
+	struct enrichOptions *options = &context->options;
+	struct shardWork *work = NULL;
+	struct shardCounts *sum = NULL;
+	struct hash *hitsHash = NULL;
+	struct enrichResult *results = NULL;
+	int bestCasePruned = 0, expectedPruned = 0;
+
+	if(options->test == enrichNone){errAbort("Error: the context was made without a test to run");}
+	work = newShardWork(context, shards, shardCount, options->wantNames);
+	if(options->wantNames){hitsHash = newHash(9);}
+
+	verbose(2,"Calculating Stats with the %s overlap loops...\n", packedKernelName());
+	sum = countShards(work, shardCount, hitsHash, &bestCasePruned);
+	results = resultsFromCounts(context, work->active, sum, hitsHash, &expectedPruned);
+	reportPruning(context->termCount, bestCasePruned, expectedPruned);
+
+	freeHashAndVals(&hitsHash);
+	freeShardCounts(&sum);
+	freeShardWork(&work, shardCount);
+	return(results);
+}
+
+
+struct enrichResult *enrichRun(struct enrichContext *context, struct enrichElements *elements)
+/* Tests elements for every term of the context.  The context and elements */
+/* are only read, so runs on other threads can share them.  Results come */
+/* back in the order of context->goTerms.  Terms that can be told will not */
+/* get under maxPvalue without working out their p-value are left out. */
+{
+	struct chromShard *shardList = NULL, **shards = NULL;
+	struct enrichResult *results = NULL;
+	int shardCount = 0;
+
+	if(context->options.test == enrichNone){errAbort("Error: the context was made without a test to run");}
+	shardList = runShards(context, elements);
+	shards = chromShardArray(shardList, &shardCount);
+	results = runOnShards(context, shards, shardCount);
+	freeMem(shards);
+	chromShardFreeList(&shardList);
+	return(results);
+}
+
+
+void enrichRunTests(struct enrichContext **contexts, int count, struct enrichElements *elements, struct enrichResult **retResults)
+/* enrichRun for each of count contexts that share one gene side, from */
+/* enrichContextForTest, putting the results of contexts[i] in retResults[i]. */
+/* The elements are split up, sorted and packed against the domains once */
+/* and that is shared by every test. */
+{
+	struct enrichContext *owner = NULL;
+	struct chromShard *shardList = NULL, **shards = NULL;
+	int shardCount = 0, i = 0;
+
+	if(count == 0){return;}
+	owner = (contexts[0]->geneSideOwner != NULL) ? contexts[0]->geneSideOwner : contexts[0];
+	for(i=0; i<count; i++)
+	{
+		if(contexts[i] != owner && contexts[i]->geneSideOwner != owner)
+			errAbort("Error: the contexts of enrichRunTests must share one gene side");
+		if(contexts[i]->options.test == enrichNone){errAbort("Error: the context was made without a test to run");}
+	}
+	shardList = runShards(owner, elements);
+	shards = chromShardArray(shardList, &shardCount);
+	for(i=0; i<count; i++)
+		retResults[i] = runOnShards(contexts[i], shards, shardCount);
+	freeMem(shards);
+	chromShardFreeList(&shardList);
+}
+
+
+void enrichRunBackgrounds(struct enrichContext **contexts, int count, struct enrichElements *elements, struct enrichResult **retResults)
+/* enrichRun for each of count binomial contexts that share one gene side */
+/* and differ only in their background, from enrichContextsForBackgrounds, */
+/* putting the results of contexts[i] in retResults[i].  The picks do not */
+/* depend on the background, so the elements are overlapped with the */
+/* domains once, and only the p-values are worked out for each context. */
+{
+	struct enrichContext *owner = NULL;
+	struct enrichOptions *options = NULL;
+	struct chromShard *shardList = NULL, **shards = NULL;
+	struct shardWork *work = NULL;
+	struct shardCounts *sum = NULL;
+	struct hash *hitsHash = NULL;
+	boolean *active = NULL;
+	int shardCount = 0, bestCasePruned = 0, expectedPruned = 0, i = 0, t = 0;
+
+	if(count == 0){return;}
+	owner = (contexts[0]->geneSideOwner != NULL) ? contexts[0]->geneSideOwner : contexts[0];
+	for(i=0; i<count; i++)
+	{
+		if(contexts[i] != owner && contexts[i]->geneSideOwner != owner)
+			errAbort("Error: the contexts of enrichRunBackgrounds must share one gene side");
+		if(contexts[i]->options.test != enrichBinomial){errAbort("Error: only the binomial test depends on the background");}
+	}
+	options = &contexts[0]->options;
+	shardList = runShards(owner, elements);
+	shards = chromShardArray(shardList, &shardCount);
+	work = newShardWork(contexts[0], shards, shardCount, options->wantNames);
+	if(options->wantNames){hitsHash = newHash(9);}
+
+	//no term can be turned off before its picks are counted, since each background can pass different ones
+	verbose(2,"Calculating Stats with the %s overlap loops...\n", packedKernelName());
+	sum = countShards(work, shardCount, hitsHash, NULL);
+	AllocArray(active, max(owner->termCount,1));
+	for(i=0; i<count; i++)
+	{
+		for(t=0; t<owner->termCount; t++)
+			active[t] = TRUE;
+		bestCasePruned = bestCaseActive(contexts[i], sum->totalPicks, active);
+		expectedPruned = 0;
+		retResults[i] = resultsFromCounts(contexts[i], active, sum, hitsHash, &expectedPruned);
+		reportPruning(owner->termCount, bestCasePruned, expectedPruned);
+	}
+
+	freeMem(active);
+	freeHashAndVals(&hitsHash);
+	freeShardCounts(&sum);
+	freeShardWork(&work, shardCount);
+	freeMem(shards);
+	chromShardFreeList(&shardList);
+}
+
+
+struct enrichResult *enrichRunSpill(struct enrichContext *context, struct spillSort *sort)
+/* enrichRun on the elements of a finished spillSort, merged back one */
+/* chromosome at a time so that only that chromosome's elements are held. */
+/* The total picks are only known once the last chromosome is counted, so */
+/* no term is pruned before its picks are counted. */
+{
+	struct enrichOptions *options = &context->options;
+	struct chromShard *shardList = NULL, *geneSide = NULL, **shards = NULL;
+	struct shardWork *work = NULL;
+	struct shardCounts *sum = NULL, *chromSum = NULL;
+	struct hash *hitsHash = NULL;
+	struct enrichResult *results = NULL;
+	struct packedIntervals *packed = NULL;
+	struct bedLong *list = NULL;
+	char *chrom = NULL;
+	int shardCount = 0, t = 0, expectedPruned = 0;
+
+	if(options->test == enrichNone){errAbort("Error: the context was made without a test to run");}
+	if(options->wantNames){hitsHash = newHash(9);}
+	AllocVar(sum);
+	AllocArray(sum->whiteBallsPicked, max(context->termCount,1));
+
+	verbose(2,"Calculating Stats with the %s overlap loops...\n", packedKernelName());
+	while(spillSortNextChrom(sort, &chrom, &packed, &list))
+	{
+		if((geneSide = hashFindVal(context->shardHash, chrom)) != NULL)
+			shardList = chromShardShare(geneSide);
+		else
+		{
+			AllocVar(shardList);
+			shardList->chrom = chrom;
+		}
+		shardList->packedElements = packed;
+		shardList->elements = list;
+		if(options->threads > 1){shardList = chromShardSplitLarge(shardList, chromShardSize(shardList) / (options->threads * 2) + 1);}
+
+		shards = chromShardArray(shardList, &shardCount);
+		work = newShardWork(context, shards, shardCount, options->wantNames);
+		chromSum = countShards(work, shardCount, hitsHash, NULL);
+		sum->totalPicks += chromSum->totalPicks;
+		for(t=0; t<context->termCount; t++)
+			sum->whiteBallsPicked[t] += chromSum->whiteBallsPicked[t];
+
+		freeShardCounts(&chromSum);
+		freeShardWork(&work, shardCount);
+		freeMem(shards);
+		chromShardFreeList(&shardList);
+	}
+	results = resultsFromCounts(context, NULL, sum, hitsHash, &expectedPruned);
+	reportPruning(context->termCount, 0, expectedPruned);
+
+	freeHashAndVals(&hitsHash);
+	freeShardCounts(&sum);
+	return(results);
+}
+
+
+struct enrichResult *enrichRunArray(struct enrichContext *context, struct enrichElement *array, int count)
+/* enrichRun on count elements held in array */
+{
+	struct enrichElements *elements = enrichElementsFromArray(array, count);
+	struct enrichResult *results = enrichRun(context, elements);
+
+	enrichElementsFree(&elements);
+	return(results);
+}
+
+
+struct enrichResult *enrichResultsCorrect(struct enrichResult *results, struct enrichOptions *options)
+/* Leaves out the results a run with options would have left out and */
+/* corrects the rest, for results from a run with a maxPvalue of 1 and no */
+/* correction, such as the slices of one run tested apart.  The p-values */
+/* and counts of the results are what is used, so the contexts are not */
+/* needed.  The results left out are freed. */
+{
+	struct enrichResult *result = NULL, *keep = NULL;
+	long best = 0;
+	double bestPValue = 0;
+
+	while((result = slPopHead(&results)) != NULL)
+	{
+		best = (options->test == enrichBinomial) ? result->totalPicks : min(result->whiteBalls, result->totalPicks);
+		bestPValue = termPValue(options->test, best, result->totalPicks, result->whiteBalls, result->totalBalls);
+		if(cannotPass(options, bestPValue, result->testCount) || (cannotPass(options, 0.5, result->testCount) && atOrBelowExpected(result->whiteBallsPicked, result->totalPicks, result->whiteBalls, result->totalBalls)))
+		{
+			enrichResultFreeList(&result);
+			continue;
+		}
+		if(options->bonferroni)
+		{
+			result->pValue = min(1, result->pValue * (double)result->testCount);
+			result->pLow = min(1, result->pLow * (double)result->testCount);
+			result->pHigh = min(1, result->pHigh * (double)result->testCount);
+		}
+		slAddHead(&keep, result);
+	}
+	slReverse(&keep);
+	return(keep);
+}
+
+
+void enrichResultFreeList(struct enrichResult **pList)
+{
+	struct enrichResult *result = NULL;
+
+	while((result = slPopHead(pList)) != NULL)
+	{
+		freeMem(result->term);
+		freeMem(result->namespace);
+		slNameFreeList(&result->hits);
+		freeMem(result);
+	}
+}
+
+
+void enrichAssignments(struct enrichContext *context, struct enrichElements *elements, FILE *f)
+/* Writes every element with the gene whose domain it is in and its distance */
+/* to that gene, or NONE.  With the nearestGene option the gene nearest the */
+/* element and its distance follow.  The elements should have been loaded */
+/* with names. */
+{
+	struct chromShard *shardList = runShards(context, elements), **shards = NULL;
+	struct shardWork *work = NULL;
+	int shardCount = 0, i = 0;
+
+	shards = chromShardArray(shardList, &shardCount);
+	work = newShardWork(context, shards, shardCount, FALSE);
+	jobPoolRun(context->options.threads, shardCount, assignmentShardJob, work);
+	for(i=0; i<shardCount; i++)
+		fputs(work->counts[i].output->string, f);
+	freeShardWork(&work, shardCount);
+	freeMem(shards);
+	chromShardFreeList(&shardList);
+}
+
+/*---------------------------------------------------------------------------*/
+
+struct ontologyTerm
+/* the genes of one term, in genome order, and how much each still counts */
+{
+	int *genes;            /* ids of the genes with the term */
+	char *gone;            /* elim, by place in genes: left out for a significant descendant */
+	double *weights;       /* weight, by place in genes: what the gene counts for here */
+	int count;
+	long whiteBalls;       /* genes still in, or the weights summed and rounded */
+	long picked;           /* of those, the ones hit */
+	double weightedWhite;  /* weight: the sum of the weights */
+	double weightedPicked; /* weight: the sum of the weights of the genes hit */
+};
+
+
+struct ontologyRun
+/* what the passes over the ontology share */
+{
+	struct enrichContext *context;
+	struct ontology *ontology;
+	struct ontologyTerm *terms;  /* by term id */
+	struct bedLong **genes;      /* by gene id, in genome order */
+	char *geneHit;               /* by gene id */
+	int geneCount;
+	long totalPicks;             /* the genes hit */
+	int *ontologyIds;            /* by term id, its id in the ontology or -1 */
+	int *toContext;              /* by ontology id, its term id or -1 */
+	int *order;                  /* term ids, the deepest level first */
+	double *pValues;             /* by term id */
+	int *ancestors;              /* for ontologyAncestors */
+	int ancestorAlloc;
+	int *ancestorStamp;
+};
+
+
+static void ontologyFlagsShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+
+	chromShardPack(work->shards[shardIx]);
+	work->counts[shardIx].geneFlags = shardGeneFlags(work, work->shards[shardIx]);
+}
+
+
+static int firstAtOrAfter(int *values, int from, int count, int key)
+/* the first index at or after from with a value of at least key, galloping */
+{
+	int step = 1, lo = from, hi = from;
+
+	while(hi < count && values[hi] < key)
+	{
+		lo = hi + 1;
+		hi += step;
+		step *= 2;
+	}
+	hi = min(hi, count);
+	while(lo < hi)
+	{
+		int mid = lo + (hi - lo)/2;
+		if(values[mid] < key){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	return(lo);
+}
+
+
+static void ontologyTermGenes(struct ontologyRun *run, struct chromShard **shards, int shardCount, struct shardWork *work, boolean weighted)
+/* Gives every gene an id in genome order, and each term the ids of its */
+/* genes, with a weight of 1 for each when weighted. */
+{
+	struct enrichContext *context = run->context;
+	struct ontologyTerm *term = NULL;
+	struct bedLong *gene = NULL;
+	struct slName *goTerm = NULL;
+	int *termStamp = NULL, i = 0, g = 0, t = 0, tid = 0;
+
+	for(i=0; i<shardCount; i++)
+		run->geneCount += slCount(shards[i]->genes);
+	AllocArray(run->genes, max(run->geneCount,1));
+	AllocArray(run->geneHit, max(run->geneCount,1));
+	AllocArray(run->terms, max(context->termCount,1));
+	for(i=0, g=0; i<shardCount; i++)
+	{
+		for(gene=shards[i]->genes, tid=0; gene != NULL; gene=gene->next, tid++, g++)
+		{
+			run->genes[g] = gene;
+			run->geneHit[g] = work->counts[i].geneFlags[tid] != 0;
+			run->totalPicks += run->geneHit[g];
+		}
+	}
+
+	//counted on the first pass, filled on the second
+	AllocArray(termStamp, max(context->termCount,1));
+	for(t=0; t<context->termCount; t++)
+		termStamp[t] = -1;
+	for(i=0; i<2; i++)
+	{
+		for(g=0; g<run->geneCount; g++)
+		{
+			for(goTerm=run->genes[g]->goTerms; goTerm != NULL; goTerm=goTerm->next)
+			{
+				if((t = hashIntValDefault(context->termIdHash, goTerm->name, -1)) < 0 || termStamp[t] == g + i*run->geneCount){continue;}
+				termStamp[t] = g + i*run->geneCount;
+				if(i == 0){run->terms[t].count++;}
+				else{run->terms[t].genes[run->terms[t].whiteBalls++] = g;}
+			}
+		}
+		for(t=0; t<context->termCount && i == 0; t++)
+		{
+			AllocArray(run->terms[t].genes, max(run->terms[t].count,1));
+			if(weighted){AllocArray(run->terms[t].weights, max(run->terms[t].count,1));}
+			else{AllocArray(run->terms[t].gone, max(run->terms[t].count,1));}
+		}
+	}
+	for(t=0; t<context->termCount; t++)
+	{
+		term = &run->terms[t];
+		for(i=0; i<term->count; i++)
+			term->picked += run->geneHit[term->genes[i]];
+		if(weighted)
+		{
+			for(i=0; i<term->count; i++)
+				term->weights[i] = 1;
+			term->weightedWhite = term->whiteBalls;
+			term->weightedPicked = term->picked;
+		}
+	}
+	freeMem(termStamp);
+}
+
+
+static int ontologyLevelCmp(const void *va, const void *vb)
+/* deepest level first, then in goTerm order */
+{
+	const int *a = (const int *)va, *b = (const int *)vb;
+	if(a[0] != b[0]){return(b[0] - a[0]);}
+	return(a[1] - b[1]);
+}
+
+
+static void ontologyOrder(struct ontologyRun *run)
+/* Finds each term in the ontology and each ontology term among the */
+/* tested ones, and orders the terms from the deepest level up, so that */
+/* every term comes after all of its descendants. */
+{
+	struct enrichContext *context = run->context;
+	struct ontology *ontology = run->ontology;
+	int *levels = ontologyLevels(ontology), *pairs = NULL, i = 0, t = 0;
+
+	AllocArray(run->ontologyIds, max(context->termCount,1));
+	AllocArray(run->toContext, max(ontology->termCount,1));
+	for(i=0; i<ontology->termCount; i++)
+		run->toContext[i] = hashIntValDefault(context->termIdHash, ontology->terms[i], -1);
+	AllocArray(pairs, 2*max(context->termCount,1));
+	for(t=0; t<context->termCount; t++)
+	{
+		run->ontologyIds[t] = ontologyFind(ontology, context->termNames[t]);
+		pairs[2*t] = (run->ontologyIds[t] >= 0) ? levels[run->ontologyIds[t]] : 0;
+		pairs[2*t+1] = t;
+	}
+	qsort(pairs, context->termCount, 2*sizeof(int), ontologyLevelCmp);
+	AllocArray(run->order, max(context->termCount,1));
+	for(t=0; t<context->termCount; t++)
+		run->order[t] = pairs[2*t+1];
+
+	run->ancestorAlloc = 64;
+	AllocArray(run->ancestors, run->ancestorAlloc);
+	AllocArray(run->ancestorStamp, max(ontology->termCount,1));
+	for(i=0; i<ontology->termCount; i++)
+		run->ancestorStamp[i] = -1;
+	AllocArray(run->pValues, max(context->termCount,1));
+	freeMem(pairs);
+	freeMem(levels);
+}
+
+
+static int termAncestors(struct ontologyRun *run, int t)
+/* puts the term ids of the tested ancestors of term t in run->ancestors */
+{
+	int count = ontologyAncestors(run->ontology, run->ontologyIds[t], run->ancestorStamp, t, &run->ancestors, &run->ancestorAlloc);
+	int i = 0, kept = 0;
+
+	for(i=0; i<count; i++)
+	{
+		if(run->toContext[run->ancestors[i]] >= 0){run->ancestors[kept++] = run->toContext[run->ancestors[i]];}
+	}
+	return(kept);
+}
+
+
+static void elimFromTerm(struct ontologyTerm *ancestor, struct ontologyTerm *term, char *geneHit)
+/* Leaves the genes of term out of ancestor, taking each one off its counts */
+/* the first time.  Both lists are sorted and the term's is usually much */
+/* shorter, so its genes are galloped to in the ancestor's. */
+{
+	int i = 0, k = 0, g = 0;
+
+	for(i=0; i<term->count && k<ancestor->count; i++)
+	{
+		g = term->genes[i];
+		k = firstAtOrAfter(ancestor->genes, k, ancestor->count, g);
+		if(k == ancestor->count || ancestor->genes[k] != g || ancestor->gone[k]){continue;}
+		ancestor->gone[k] = 1;
+		ancestor->whiteBalls--;
+		if(geneHit[g]){ancestor->picked--;}
+	}
+}
+
+
+static int elimPass(struct ontologyRun *run)
+/* Tests every term from the deepest level up, and leaves the genes of */
+/* each one that passes maxPvalue out of all of its ancestors.  Returns */
+/* how many passed. */
+{
+	struct enrichContext *context = run->context;
+	struct ontologyTerm *term = NULL;
+	double pValue = 0;
+	int i = 0, t = 0, a = 0, ancestorCount = 0, significant = 0;
+
+	for(i=0; i<context->termCount; i++)
+	{
+		t = run->order[i];
+		term = &run->terms[t];
+		run->pValues[t] = termPValue(enrichHypergeometric, term->picked, run->totalPicks, term->whiteBalls, context->totalBalls);
+		pValue = context->options.bonferroni ? min(1, run->pValues[t] * (double)context->testCounts[t]) : run->pValues[t];
+		if(pValue > context->options.maxPvalue || run->ontologyIds[t] < 0){continue;}
+		significant++;
+		ancestorCount = termAncestors(run, t);
+		for(a=0; a<ancestorCount; a++)
+			elimFromTerm(&run->terms[run->ancestors[a]], term, run->geneHit);
+	}
+	return(significant);
+}
+
+
+static double weightScore(struct ontologyRun *run, int t)
+/* the p-value of term t from the weights of its genes, rounded to whole genes */
+{
+	struct ontologyTerm *term = &run->terms[t];
+
+	term->whiteBalls = (long)floor(term->weightedWhite + 0.5);
+	term->picked = (long)floor(term->weightedPicked + 0.5);
+	return(termPValue(enrichHypergeometric, term->picked, run->totalPicks, term->whiteBalls, run->context->totalBalls));
+}
+
+
+static void weightInTerm(struct ontologyTerm *ancestor, struct ontologyTerm *term, double factor, char *geneHit)
+/* multiplies the weight in ancestor of every gene of term by factor, */
+/* galloping through ancestor's genes as elimFromTerm does */
+{
+	double change = 0;
+	int i = 0, k = 0, g = 0;
+
+	for(i=0; i<term->count && k<ancestor->count; i++)
+	{
+		g = term->genes[i];
+		k = firstAtOrAfter(ancestor->genes, k, ancestor->count, g);
+		if(k == ancestor->count || ancestor->genes[k] != g){continue;}
+		change = ancestor->weights[k] * (factor - 1);
+		ancestor->weights[k] += change;
+		ancestor->weightedWhite += change;
+		if(geneHit[g]){ancestor->weightedPicked += change;}
+	}
+}
+
+
+static void weightPass(struct ontologyRun *run)
+/* Scores every term from the weights of its genes, from the deepest level */
+/* up.  Each child that scores better than its parent has its genes */
+/* weighed down in the parent and the parent's ancestors by the ratio of */
+/* the two p-values, and the parent is scored again against the children */
+/* left, until none of them scores better.  Those children then have */
+/* their own genes weighed down by the ratio, as the parent explains them */
+/* better.  Terms with no tested children keep the score of their genes. */
+{
+	struct enrichContext *context = run->context;
+	struct ontology *ontology = run->ontology;
+	double *pValues = run->pValues, ratio = 0;
+	int *children = NULL, childAlloc = 16, childCount = 0, better = 0, kept = 0;
+	int i = 0, k = 0, a = 0, c = 0, u = 0, id = 0, ancestorCount = -1;
+
+	AllocArray(children, childAlloc);
+	for(i=0; i<context->termCount; i++)
+	{
+		u = run->order[i];
+		pValues[u] = weightScore(run, u);
+		if((id = run->ontologyIds[u]) < 0){continue;}
+		for(k=ontology->childOffsets[id], childCount=0; k<ontology->childOffsets[id+1]; k++)
+		{
+			if((c = run->toContext[ontology->children[k]]) < 0){continue;}
+			if(childCount == childAlloc)
+			{
+				ExpandArray(children, childAlloc, 2*childAlloc);
+				childAlloc *= 2;
+			}
+			children[childCount++] = c;
+		}
+
+		ancestorCount = -1;
+		for(;;)
+		{
+			for(k=0, better=0; k<childCount; k++)
+				better += (pValues[children[k]] < pValues[u]);
+			if(better == 0){break;}
+			if(ancestorCount < 0){ancestorCount = termAncestors(run, u);}
+			for(k=0, kept=0; k<childCount; k++)
+			{
+				c = children[k];
+				if(pValues[c] >= pValues[u])
+				{
+					children[kept++] = c;
+					continue;
+				}
+				ratio = pValues[c] / pValues[u];
+				weightInTerm(&run->terms[u], &run->terms[c], ratio, run->geneHit);
+				for(a=0; a<ancestorCount; a++)
+					weightInTerm(&run->terms[run->ancestors[a]], &run->terms[c], ratio, run->geneHit);
+			}
+			childCount = kept;
+			pValues[u] = weightScore(run, u);
+		}
+
+		for(k=0; k<childCount; k++)
+		{
+			c = children[k];
+			if(pValues[c] <= pValues[u]){continue;}
+			weightInTerm(&run->terms[c], &run->terms[c], pValues[u] / pValues[c], run->geneHit);
+			pValues[c] = weightScore(run, c);
+		}
+	}
+	freeMem(children);
+}
+
+
+static boolean ontologyGeneCounts(struct ontologyTerm *term, int i)
+/* whether the gene at place i of term still counts for it, for its names */
+{
+	if(term->gone != NULL){return(!term->gone[i]);}
+	return(term->weights[i] >= 0.5);
+}
+
+
+static struct enrichResult *ontologyResults(struct ontologyRun *run)
+/* a result for every term, in the order of context->goTerms */
+{
+	struct enrichContext *context = run->context;
+	struct enrichResult *results = NULL, *result = NULL;
+	struct ontologyTerm *term = NULL;
+	int t = 0, i = 0, g = 0;
+
+	for(t=0; t<context->termCount; t++)
+	{
+		term = &run->terms[t];
+		result = newResult(context, t, term->picked, run->totalPicks, term->whiteBalls, run->pValues[t]);
+		if(context->options.wantNames)
+		{
+			for(i=0; i<term->count; i++)
+			{
+				g = term->genes[i];
+				if(!run->geneHit[g] || !ontologyGeneCounts(term, i)){continue;}
+				if(run->genes[g]->name == NULL){errAbort("Error: told to list names, but hit has not name");}
+				slAddHead(&result->hits, newSlName(run->genes[g]->name));
+			}
+			slReverse(&result->hits);
+		}
+		slAddHead(&results, result);
+	}
+	slReverse(&results);
+	return(results);
+}
+
+
+static void ontologyRunFree(struct ontologyRun *run)
+{
+	int t = 0;
+
+	for(t=0; t<run->context->termCount; t++)
+	{
+		freeMem(run->terms[t].genes);
+		freeMem(run->terms[t].gone);
+		freeMem(run->terms[t].weights);
+	}
+	freeMem(run->terms);
+	freeMem(run->genes);
+	freeMem(run->geneHit);
+	freeMem(run->ontologyIds);
+	freeMem(run->toContext);
+	freeMem(run->order);
+	freeMem(run->pValues);
+	freeMem(run->ancestors);
+	freeMem(run->ancestorStamp);
+}
+
+
+struct enrichResult *enrichRunOntology(struct enrichContext *context, struct enrichElements *elements, struct ontology *ontology, enum enrichOntologyMethod method)
+/* The hypergeometric test of every term from the most specific up, with */
+/* the terms decorrelated along ontology by one of the methods of Alexa et */
+/* al.  With enrichElim the genes of each term that passes maxPvalue are */
+/* left out of the tests of all of its ancestors.  With enrichWeight each */
+/* gene counts for a weight in each term, lowered wherever a child and its */
+/* parent score differently, and no cutoff is used.  Each term keeps its */
+/* own genes in genome order, and only its changes are taken off the */
+/* counts of its ancestors, so nothing is intersected again.  Results come */
+/* back for every term, in the order of context->goTerms. */
+{
+	struct enrichOptions *options = &context->options;
+	struct chromShard *shardList = NULL, **shards = NULL;
+	struct shardWork *work = NULL;
+	struct enrichResult *results = NULL;
+	struct ontologyRun run;
+	int shardCount = 0, significant = 0;
+
+	if(options->test != enrichHypergeometric){errAbort("Error: the ontology methods need the hypergeometric test");}
+	shardList = runShards(context, elements);
+	shards = chromShardArray(shardList, &shardCount);
+	work = newShardWork(context, shards, shardCount, FALSE);
+	jobPoolRun(options->threads, shardCount, ontologyFlagsShardJob, work);
+
+	ZeroVar(&run);
+	run.context = context;
+	run.ontology = ontology;
+	ontologyTermGenes(&run, shards, shardCount, work, method == enrichWeight);
+	ontologyOrder(&run);
+	verbose(2,"Testing %d goTerms from the deepest of the ontology up\n", context->termCount);
+	if(method == enrichWeight){weightPass(&run);}
+	else
+	{
+		significant = elimPass(&run);
+		verbose(2, "%d goTerms passed and had their genes left out of their ancestors\n", significant);
+	}
+	results = ontologyResults(&run);
+
+	ontologyRunFree(&run);
+	freeShardWork(&work, shardCount);
+	freeMem(shards);
+	chromShardFreeList(&shardList);
+	return(results);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void approxScale(struct enrichResult *results, struct enrichElements *elements, struct enrichElements *sample, long *lowPicked, long *highPicked)
+/* Scales the picks of binomial results on sample up to all of elements */
+/* and gives them their p-values.  The share of the sample's picks that */
+/* hit each term gets a 95% Wilson interval, narrowed by the share of the */
+/* elements in the sample, and the scaled ends of it are left in */
+/* lowPicked and highPicked by place in results, for approxBounds. */
+{
+	struct enrichResult *result = NULL;
+	double scale = (double)elements->count / (double)max(sample->count,1);
+	double sampled = (double)sample->count / (double)max(elements->count,1);
+	double z2 = 1.96 * 1.96 * max(0, 1 - sampled), n = 0, q = 0, center = 0, half = 0;
+	long totalPicks = 0;
+	int i = 0;
+
+	for(result=results, i=0; result != NULL; result=result->next, i++)
+	{
+		n = (double)result->totalPicks;
+		totalPicks = (long)floor(n * scale + 0.5);
+		if(n > 0)
+		{
+			q = (double)result->whiteBallsPicked / n;
+			center = (q + z2/(2*n)) / (1 + z2/n);
+			half = sqrt(z2) / (1 + z2/n) * sqrt(q*(1-q)/n + z2/(4*n*n));
+			lowPicked[i] = (long)floor(max(0, center - half) * totalPicks + 0.5);
+			highPicked[i] = (long)floor(min(1, center + half) * totalPicks + 0.5);
+		}
+		else{lowPicked[i] = highPicked[i] = 0;}
+		result->whiteBallsPicked = (long)floor(result->whiteBallsPicked * scale + 0.5);
+		result->totalPicks = totalPicks;
+		result->expected = ((double)result->whiteBalls) / ((double)result->totalBalls) * ((double)totalPicks);
+		result->pValue = termPValue(enrichBinomial, result->whiteBallsPicked, totalPicks, result->whiteBalls, result->totalBalls);
+	}
+}
+
+
+static void approxBounds(struct enrichResult *results, long *lowPicked, long *highPicked)
+/* pLow and pHigh of each result from the ends approxScale left, only */
+/* worked out for the last sample as each is two more binomial tails */
+{
+	struct enrichResult *result = NULL;
+	int i = 0;
+
+	for(result=results, i=0; result != NULL; result=result->next, i++)
+	{
+		result->pLow = termPValue(enrichBinomial, highPicked[i], result->totalPicks, result->whiteBalls, result->totalBalls);
+		result->pHigh = termPValue(enrichBinomial, lowPicked[i], result->totalPicks, result->whiteBalls, result->totalBalls);
+	}
+}
+
+
+static int approxTopCmp(const void *va, const void *vb)
+{
+	const struct enrichResult *a = *((struct enrichResult **)va);
+	const struct enrichResult *b = *((struct enrichResult **)vb);
+	if(a->pValue < b->pValue){return(-1);}
+	if(a->pValue > b->pValue){return(1);}
+	return(strcmp(a->term, b->term));
+}
+
+
+static struct slName *approxTop(struct enrichResult *results, int topCount)
+/* the terms of the topCount smallest p-values */
+{
+	struct enrichResult *result = NULL, **array = NULL;
+	struct slName *top = NULL;
+	int count = slCount(results), i = 0;
+
+	AllocArray(array, max(count,1));
+	for(result=results; result != NULL; result=result->next)
+		array[i++] = result;
+	qsort(array, count, sizeof(struct enrichResult *), approxTopCmp);
+	for(i=min(count,topCount)-1; i>=0; i--)
+		slAddHead(&top, newSlName(array[i]->term));
+	freeMem(array);
+	return(top);
+}
+
+
+static boolean allAmong(struct slName *names, struct slName *among)
+/* whether every one of names is also in among */
+{
+	struct slName *name = NULL;
+
+	for(name=names; name != NULL; name=name->next)
+	{
+		if(!slNameInList(among, name->name)){return(FALSE);}
+	}
+	return(TRUE);
+}
+
+
+struct enrichResult *enrichRunApprox(struct enrichContext *context, struct enrichElements *elements, double fraction, int topCount)
+/* A quick binomial estimate from enrichElementsSample.  The sample starts */
+/* at fraction of the elements and doubles until the ranking of the top */
+/* terms settles, or the sample is every element.  It has settled when */
+/* the topCount terms with the smallest p-values are all among the top */
+/* 2*topCount of the last sample and the other way round, so that terms */
+/* swapping places across the cut do not hold it up.  The picks of each */
+/* result are scaled up to all of the elements, and pLow and pHigh bound */
+/* its p-value.  The context must keep every term, with a maxPvalue of 1 */
+/* and no correction, so the results can be cut off with */
+/* enrichResultsCorrect. */
+{
+	struct enrichOptions *options = &context->options;
+	struct enrichElements *sample = NULL;
+	struct enrichResult *results = NULL;
+	struct slName *top = NULL, *wide = NULL, *lastTop = NULL, *lastWide = NULL;
+	long *lowPicked = NULL, *highPicked = NULL;
+	boolean stable = FALSE;
+
+	if(options->test != enrichBinomial){errAbort("Error: only the binomial test can be estimated from a sample");}
+	if(options->bonferroni || options->maxPvalue < 1){errAbort("Error: the context of enrichRunApprox must have a maxPvalue of 1 and no correction");}
+	if(fraction <= 0){errAbort("Error: the fraction of elements to sample must be above 0");}
+	for(;;)
+	{
+		fraction = min(fraction, 1);
+		sample = enrichElementsSample(elements, fraction);
+		enrichResultFreeList(&results);
+		results = enrichRun(context, sample);
+		freez(&lowPicked);
+		freez(&highPicked);
+		AllocArray(lowPicked, max(slCount(results),1));
+		AllocArray(highPicked, max(slCount(results),1));
+		approxScale(results, elements, sample, lowPicked, highPicked);
+		top = approxTop(results, topCount);
+		wide = approxTop(results, 2 * topCount);
+		stable = (lastTop != NULL && allAmong(top, lastWide) && allAmong(lastTop, wide));
+		if(sample->count == elements->count){verbose(2, "Tested all %d elements, so the estimates are exact\n", elements->count);}
+		else{verbose(2, "Estimated from %d of %d elements, the top %d goTerms are %s\n", sample->count, elements->count, slCount(top), stable ? "settled" : "not settled yet");}
+		enrichElementsFree(&sample);
+		slNameFreeList(&lastTop);
+		slNameFreeList(&lastWide);
+		lastTop = top;
+		lastWide = wide;
+		if(stable || fraction >= 1){break;}
+		fraction *= 2;
+	}
+	approxBounds(results, lowPicked, highPicked);
+	freeMem(lowPicked);
+	freeMem(highPicked);
+	slNameFreeList(&lastTop);
+	slNameFreeList(&lastWide);
+	return(results);
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+static bits64 assignmentsKey(struct enrichContext *context)
+/* the domains of every gene in the order the context has them, and the */
+/* settings they were made with */
+{
+	struct enrichOptions *options = &context->options;
+	struct chromShard *shard = NULL;
+	struct bedLong *gene = NULL;
+	bits64 key = 0;
+
+	key = elementAssignmentsKeyAdd(key, &options->maxExpansion, sizeof(long));
+	key = elementAssignmentsKeyAdd(key, &options->noExpansionOverlap, sizeof(boolean));
+	key = elementAssignmentsKeyAdd(key, &options->guessTxStart, sizeof(boolean));
+	for(shard=context->shardList; shard != NULL; shard=shard->next)
+	{
+		key = elementAssignmentsKeyAdd(key, shard->chrom, strlen(shard->chrom)+1);
+		for(gene=shard->genes; gene != NULL; gene=gene->next)
+		{
+			key = elementAssignmentsKeyAdd(key, &gene->chromStart, sizeof(gene->chromStart));
+			key = elementAssignmentsKeyAdd(key, &gene->chromEnd, sizeof(gene->chromEnd));
+			if(gene->name != NULL){key = elementAssignmentsKeyAdd(key, gene->name, strlen(gene->name)+1);}
+		}
+	}
+	return(key);
+}
+
+
+struct assignJob
+/* what the threads share while assigning the elements of each chromosome */
+{
+	struct enrichElements *elements;
+	struct chromShard **shards;
+	struct elementAssignments *ea;
+};
+
+
+static void assignChromJob(void *context, int shardIx)
+{
+	/* The same walk as labelRecords, keeping the index of every domain */
+	/* each element overlaps instead of counting its terms. */
+	struct assignJob *job = (struct assignJob *)context;
+	struct chromShard *shard = job->shards[shardIx];
+	struct assignedChrom *ac = &job->ea->chroms[shardIx];
+	struct elementChrom *ec = hashFindVal(job->elements->chromHash, shard->chrom);
+	struct bedLong *futon = NULL, *gene = shard->genes, **active = NULL;
+	long start = 0, end = 0;
+	int *activeIx = NULL, activeCount = 0, activeAlloc = 16, recordCount = 0, geneIx = 0, geneAlloc = 64, geneTotal = 0;
+	int i = 0, a = 0, keep = 0, repeat = 0;
+
+	ac->chrom = cloneString(shard->chrom);
+	ac->geneCount = slCount(shard->genes);
+	if(ec != NULL){recordCount = (ec->packed != NULL) ? ec->packed->count : slCount(ec->list);}
+	AllocArray(ac->offsets, ((ec != NULL && ec->packed != NULL) ? packedRecordCount(ec->packed) : recordCount) + 1);
+	AllocArray(ac->genes, geneAlloc);
+	AllocArray(active, activeAlloc);
+	AllocArray(activeIx, activeAlloc);
+	if(ec != NULL){futon = ec->list;}
+
+	for(i=0; i<recordCount; i++)
+	{
+		if(ec->packed != NULL)
+		{
+			start = ec->packed->starts[i];
+			end = ec->packed->ends[i];
+		}
+		else
+		{
+			start = futon->chromStart;
+			end = futon->chromEnd;
+			futon = futon->next;
+		}
+		for(a=0, keep=0; a<activeCount; a++)
+		{
+			if(active[a]->chromEnd > start)
+			{
+				active[keep] = active[a];
+				activeIx[keep++] = activeIx[a];
+			}
+		}
+		activeCount = keep;
+		for(; gene != NULL && gene->chromStart < end; gene=gene->next, geneIx++)
+		{
+			if(gene->chromEnd <= start){continue;}
+			if(activeCount == activeAlloc)
+			{
+				ExpandArray(active, activeAlloc, 2*activeAlloc);
+				ExpandArray(activeIx, activeAlloc, 2*activeAlloc);
+				activeAlloc *= 2;
+			}
+			active[activeCount] = gene;
+			activeIx[activeCount++] = geneIx;
+		}
+
+		//a folded element is written once for every record it stands for
+		repeat = (ec->packed != NULL && ec->packed->counts != NULL) ? ec->packed->counts[i] : 1;
+		for(; repeat > 0; repeat--)
+		{
+			for(a=0; a<activeCount; a++)
+			{
+				if(min(active[a]->chromEnd,end) - max(active[a]->chromStart,start) <= 0){continue;}
+				if(geneTotal == geneAlloc)
+				{
+					ExpandArray(ac->genes, geneAlloc, 2*geneAlloc);
+					geneAlloc *= 2;
+				}
+				ac->genes[geneTotal++] = activeIx[a];
+			}
+			if(geneTotal == ac->offsets[ac->elementCount]){break;}
+			ac->offsets[++ac->elementCount] = geneTotal;
+		}
+	}
+	freeMem(activeIx);
+	freeMem(active);
+}
+
+
+void enrichAssignmentsSave(struct enrichContext *context, struct enrichElements *elements, char *fileName)
+/* Writes which domains each element is in to fileName, for enrichRunAssignments */
+/* to test later without the elements.  Only contexts made from the same genes */
+/* and expansion settings can read it back. */
+{
+	struct assignJob job;
+	int shardCount = 0;
+
+	job.elements = elements;
+	job.shards = chromShardArray(context->shardList, &shardCount);
+	job.ea = elementAssignmentsNew(assignmentsKey(context), shardCount);
+	job.ea->elementCount = elements->count;
+	jobPoolRun(context->options.threads, shardCount, assignChromJob, &job);
+	elementAssignmentsWrite(job.ea, fileName);
+	elementAssignmentsFree(&job.ea);
+	freeMem(job.shards);
+}
+
+
+struct elementAssignments *enrichAssignmentsLoad(struct enrichContext *context, char *fileName)
+/* reads a file from enrichAssignmentsSave, which must have been made with the genes of context */
+{
+	struct elementAssignments *ea = elementAssignmentsRead(fileName);
+	struct chromShard *shard = NULL;
+	int i = 0;
+
+	if(ea->key != assignmentsKey(context))
+		errAbort("Error: %s was made with other genes or expansion settings than the ones given", fileName);
+	for(shard=context->shardList, i=0; shard != NULL; shard=shard->next, i++)
+	{
+		if(i >= ea->chromCount || !sameString(shard->chrom, ea->chroms[i].chrom) || ea->chroms[i].geneCount != slCount(shard->genes))
+			errAbort("Error: %s was made with other genes or expansion settings than the ones given", fileName);
+	}
+	if(i != ea->chromCount){errAbort("Error: %s was made with other genes or expansion settings than the ones given", fileName);}
+	return(ea);
+}
+
+
+static int *assignedGeneFlags(struct assignedChrom *ac, int *retHitCount)
+/* flags the genes hit by any element, like bedLongOverlapFlags */
+{
+	int *flags = NULL, i = 0;
+
+	AllocArray(flags, max(ac->geneCount,1));
+	*retHitCount = 0;
+	for(i=0; i<ac->offsets[ac->elementCount]; i++)
+	{
+		if(!flags[ac->genes[i]])
+		{
+			flags[ac->genes[i]] = 1;
+			(*retHitCount)++;
+		}
+	}
+	return(flags);
+}
+
+
+static void labelAssigned(struct shardWork *work, struct chromShard *shard, struct assignedChrom *ac, long *retCounts, struct hash *hitsHash)
+{
+	/* labelRecords on elements whose domains are already known */
+	struct enrichContext *context = work->context;
+	struct bedLong *gene = NULL, **genes = NULL;
+	long *classTally = NULL;
+	int *stamp = NULL, i = 0, j = 0, g = 0, t = 0, c = 0, k = 0, recordClass = 0;
+
+	if(hitsHash != NULL)
+	{
+		AllocArray(genes, max(ac->geneCount,1));
+		for(gene=shard->genes, g=0; gene != NULL; gene=gene->next, g++)
+			genes[g] = gene;
+	}
+	AllocArray(classTally, max(context->classCount,1));
+	AllocArray(stamp, max(context->termCount,1));
+	for(t=0; t<context->termCount; t++)
+		stamp[t] = -1;
+
+	for(i=0; i<ac->elementCount; i++)
+	{
+		recordClass = shard->geneClasses[ac->genes[ac->offsets[i]]];
+		for(j=ac->offsets[i]+1; j<ac->offsets[i+1]; j++)
+		{
+			if(shard->geneClasses[ac->genes[j]] != recordClass){recordClass = -2;}
+		}
+		if(recordClass >= 0 && hitsHash == NULL)
+		{
+			classTally[recordClass]++;
+			continue;
+		}
+		for(j=ac->offsets[i]; j<ac->offsets[i+1]; j++)
+		{
+			g = ac->genes[j];
+			c = shard->geneClasses[g];
+			for(k=0; k<context->classTermCounts[c]; k++)
+			{
+				t = context->classTerms[c][k];
+				if(stamp[t] == i){continue;}
+				stamp[t] = i;
+				retCounts[t]++;
+				if(hitsHash != NULL)
+				{
+					if(genes[g]->name == NULL){errAbort("Error: told to list names, but hit has not name");}
+					hashAdd(hitsHash, context->termNames[t], cloneString(genes[g]->name));
+				}
+			}
+		}
+	}
+	addClassTally(context, classTally, retCounts);
+	freeMem(classTally);
+	freeMem(stamp);
+	freeMem(genes);
+}
+
+
+static void assignedTotalsShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+	struct assignedChrom *ac = &work->assigned->chroms[shardIx];
+	struct shardCounts *counts = &work->counts[shardIx];
+	int *flags = NULL, hitCount = 0;
+
+	if(work->context->options.test == enrichBinomial){counts->totalPicks = ac->elementCount;}
+	else
+	{
+		flags = assignedGeneFlags(ac, &hitCount);
+		counts->totalPicks = hitCount;
+		freeMem(flags);
+	}
+}
+
+
+static void assignedPicksShardJob(void *context, int shardIx)
+{
+	struct shardWork *work = (struct shardWork *)context;
+	struct chromShard *shard = work->shards[shardIx];
+	struct assignedChrom *ac = &work->assigned->chroms[shardIx];
+	struct shardCounts *counts = &work->counts[shardIx];
+	int *flags = NULL, hitCount = 0;
+
+	if(work->context->options.test == enrichBinomial){labelAssigned(work, shard, ac, counts->whiteBallsPicked, counts->hitsHash);}
+	else
+	{
+		flags = assignedGeneFlags(ac, &hitCount);
+		countClassGenes(work, shard, flags, counts->whiteBallsPicked, counts->hitsHash);
+		freeMem(flags);
+	}
+}
+
+
+struct enrichResult *enrichRunAssignments(struct enrichContext *context, struct elementAssignments *ea)
+/* enrichRun on elements saved by enrichAssignmentsSave, which never touches */
+/* an interval.  The null model needs the elements themselves, so it can not */
+/* be run this way. */
+{
+	struct enrichOptions *options = &context->options;
+	struct chromShard **shards = NULL;
+	struct shardWork *work = NULL;
+	struct shardCounts *sum = NULL;
+	struct hash *hitsHash = NULL;
+	struct enrichResult *results = NULL;
+	long totalPicks = 0;
+	int shardCount = 0, i = 0, bestCasePruned = 0, expectedPruned = 0;
+
+	if(options->test == enrichNone){errAbort("Error: the context was made without a test to run");}
+	if(options->test == enrichNullModel){errAbort("Error: the null model needs the elements, it can not be run from assignments");}
+	shards = chromShardArray(context->shardList, &shardCount);
+	if(shardCount != ea->chromCount){errAbort("Error: the assignments were not made with the genes of this context");}
+	work = newShardWork(context, shards, shardCount, options->wantNames);
+	work->assigned = ea;
+	if(options->wantNames){hitsHash = newHash(9);}
+
+	verbose(2,"Calculating Stats from the saved assignments on %d threads\n", options->threads);
+	jobPoolRun(options->threads, shardCount, assignedTotalsShardJob, work);
+	for(i=0; i<shardCount; i++)
+		totalPicks += work->counts[i].totalPicks;
+	if(options->test == enrichBinomial && options->countUnassigned){totalPicks = ea->elementCount;}
+	bestCasePruned = pruneByBestCase(work, totalPicks);
+	jobPoolRun(options->threads, shardCount, assignedPicksShardJob, work);
+	sum = sumShardCounts(work, shardCount, hitsHash);
+	copyFromReps(context, sum->whiteBallsPicked);
+	sum->totalPicks = totalPicks;
+	results = resultsFromCounts(context, work->active, sum, hitsHash, &expectedPruned);
+	reportPruning(context->termCount, bestCasePruned, expectedPruned);
+
+	freeHashAndVals(&hitsHash);
+	freeShardCounts(&sum);
+	freeShardWork(&work, shardCount);
+	freeMem(shards);
+	return(results);
+}
+
+/*---------------------------------------------------------------------------*/
+
+struct enrichEdits *enrichEditsNew(struct enrichContext *context, struct enrichElements *elements)
+/* Counts elements into a form where single elements can then be added and */
+/* removed cheaply.  The context must outlive the edits. */
+{
+	struct enrichEdits *edits = NULL;
+	struct chromShard **shards = NULL;
+	struct elementChrom *ec = NULL;
+	struct bedLong *futon = NULL;
+	enum incrementalStyle style = incBinomial;
+	int shardCount = 0, i = 0, k = 0;
+
+	if(context->options.test == enrichNone){errAbort("Error: the context was made without a test to run");}
+	if(context->options.test == enrichHypergeometric){style = incHypergeometric;}
+	else if(context->options.test == enrichNullModel){style = incNullModel;}
+
+	AllocVar(edits);
+	edits->context = context;
+	shards = chromShardArray(context->shardList, &shardCount);
+	edits->inc = incrementalNew(style, shards, shardCount, context->termIdHash, context->termCount, context->options.countUnassigned, context->totalBalls, context->whiteBalls);
+	freeMem(shards);
+	for(ec=elements->chromList; ec != NULL; ec=ec->next)
+	{
+		if(ec->list != NULL)
+		{
+			for(futon=ec->list; futon != NULL; futon=futon->next)
+				incrementalElement(edits->inc, futon->chrom, futon->chromStart, futon->chromEnd, 1);
+		}
+		else if(ec->packed != NULL)
+		{
+			for(i=0; i<ec->packed->count; i++)
+			{
+				for(k=(ec->packed->counts != NULL) ? ec->packed->counts[i] : 1; k>0; k--)
+					incrementalElement(edits->inc, ec->chrom, ec->packed->starts[i], ec->packed->ends[i], 1);
+			}
+		}
+	}
+	AllocArray(edits->pValues, max(context->termCount,1));
+	edits->fresh = TRUE;
+	return(edits);
+}
+
+
+void enrichEditsElement(struct enrichEdits *edits, char *chrom, long start, long end, int delta)
+/* adds (delta 1) or removes (delta -1) one element */
+{
+	incrementalElement(edits->inc, chrom, start, end, delta);
+}
+
+
+struct enrichResult *enrichEditsResults(struct enrichEdits *edits)
+/* Results for every term of the elements as they stand now.  Only the */
+/* terms whose counts moved since the last call have their p-value worked */
+/* out again, unless the total picks moved, which moves them all. */
+{
+	struct enrichContext *context = edits->context;
+	struct incremental *inc = edits->inc;
+	struct enrichResult *results = NULL;
+	int t = 0, redone = 0;
+
+	for(t=0; t<inc->termCount; t++)
+	{
+		if(edits->fresh || inc->totalChanged || inc->changed[t])
+		{
+			edits->pValues[t] = termPValue(context->options.test, inc->whiteBallsPicked[t], inc->totalPicks, inc->whiteBalls[t], inc->totalBalls);
+			redone++;
+		}
+		slAddHead(&results, newResult(context, t, inc->whiteBallsPicked[t], inc->totalPicks, context->whiteBalls[t], edits->pValues[t]));
+	}
+	slReverse(&results);
+	verbose(2, "  edits changed %d of %d terms\n", redone, inc->termCount);
+	incrementalClearChanged(inc);
+	edits->fresh = FALSE;
+	return(results);
+}
+
+
+void enrichEditsFree(struct enrichEdits **pEdits)
+{
+	struct enrichEdits *edits = *pEdits;
+
+	if(edits == NULL){return;}
+	incrementalFree(&edits->inc);
+	freeMem(edits->pValues);
+	freez(pEdits);
+}
@@ -0,0 +1,245 @@
+/*
+
+enrichments.h
+
+The enrichment tests of bedToEnrichments as a library.  The genes,
+background regions and expansion settings are loaded and prepared once
+into an enrichContext, and any number of element sets can then be
+tested against it, from any number of threads at once, since a run only
+reads the context.
+
+*/
+
+#ifndef ENRICHMENTS_H
+#define ENRICHMENTS_H
+
+#ifndef HASH_H
+#include "hash.h"
+#endif
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+#ifndef PACKEDINTERVALS_H
+#include "packedIntervals.h"
+#endif
+
+#ifndef CHROMSHARD_H
+#include "chromShard.h"
+#endif
+
+#ifndef INCREMENTAL_H
+#include "incremental.h"
+#endif
+
+#ifndef SPILLSORT_H
+#include "spillSort.h"
+#endif
+
+#ifndef ALLOWEDINDEX_H
+#include "allowedIndex.h"
+#endif
+
+#ifndef ONTOLOGY_H
+#include "ontology.h"
+#endif
+
+#ifndef ELEMENTASSIGNMENTS_H
+#include "elementAssignments.h"
+#endif
+
+enum enrichTest
+/* what is counted as a ball and as a pick */
+{
+	enrichBinomial,        /* elements hitting domains, against the bases domains cover */
+	enrichHypergeometric,  /* genes whose domains are hit by elements */
+	enrichNullModel,       /* hypergeometric on the largeSet records hit by elements */
+	enrichNone,            /* no test, only enrichAssignments will be used */
+};
+
+enum enrichOntologyMethod
+/* how enrichRunOntology decorrelates a term from its descendants */
+{
+	enrichElim,    /* genes of terms that pass are left out of their ancestors */
+	enrichWeight,  /* genes are weighed down where a child and its parent score differently */
+};
+
+struct enrichOptions
+/* settings for a context.  Start from enrichOptionsDefault */
+{
+	enum enrichTest test;
+	long maxExpansion;          /* how far a gene's domain reaches, 0 to leave genes as they are */
+	boolean noExpansionOverlap; /* domains only grow into bases no other gene has */
+	boolean guessTxStart;       /* shrink each gene to the base its strand says it starts at */
+	boolean countUnassigned;    /* -binom counts the elements outside every domain as picks */
+	boolean bonferroni;         /* correct the p-values for the tests in each namespace */
+	double maxPvalue;           /* terms that can not get under this may be skipped */
+	boolean namespaces;         /* the part of a goTerm before its colon is its namespace */
+	int minTermSize;            /* only test goTerms on at least this many genes */
+	int maxTermSize;            /* and at most this many, 0 for no limit */
+	int threads;                /* threads for each run or context load */
+	boolean wantNames;          /* gather the names of the genes hit by each term */
+	boolean nearestGene;        /* enrichAssignments also gives the gene nearest each element */
+	int termSlice;              /* with termSlices, only test slice termSlice, from 0, of the terms */
+	int termSlices;             /* cut the terms into this many slices in goTerm order, 0 to test them all */
+};
+
+struct enrichElement
+/* one element to test, for callers that have them in memory */
+{
+	char *chrom;
+	long start;
+	long end;
+	char *name;   /* only needed by enrichAssignments, may be NULL */
+};
+
+struct elementChrom
+/* the elements of one chromosome, sorted by start */
+{
+	struct elementChrom *next;
+	char *chrom;
+	struct bedLong *list;           /* NULL when only held packed */
+	struct packedIntervals *packed;
+};
+
+struct enrichElements
+/* an element set, split by chromosome and sorted, ready to test */
+{
+	struct hash *chromHash;          /* chrom to struct elementChrom */
+	struct elementChrom *chromList;  /* in the order they were first seen */
+	int count;
+	int repeatCount;                 /* elements with the same coordinates as another */
+	struct packedNames *names;       /* the names of the packed elements, NULL without */
+};
+
+struct enrichContextStats
+/* what making a context found in its input, for the caller to report */
+{
+	int termsSized;                 /* goTerms the size filter looked at, 0 without one */
+	int termsDropped;               /* of those, the ones on too few or too many genes */
+	int termsSliced;                /* goTerms the slice was cut from, 0 without termSlices */
+	int sliceFirst;                 /* the slice tested is goTerms [sliceFirst,sliceEnd) of them */
+	int sliceEnd;
+	int regionsJoined;              /* okRegions joined to an overlapping or touching one */
+	int regionsLeft;                /* the disjoint okRegions left */
+	int largeSetRepeats;            /* largeSet records with the same coordinates as another */
+};
+
+struct enrichContext
+/* Everything that does not depend on the elements.  It is only read */
+/* once it has been made. */
+{
+	struct enrichOptions options;
+	struct chromShard *shardList;   /* gene side of each chromosome, sorted, expanded and packed */
+	struct hash *shardHash;         /* chrom to its shard */
+	struct allowedIndex *allowed;   /* the okRegions as a rank index, for allowed bases in any interval */
+	boolean hasLargeSet;            /* the shards have a largeSet, so the null model can be run */
+	struct enrichContext *geneSideOwner;  /* from enrichContextForTest, the context whose gene side */
+	                                      /* this reads, NULL if it is its own */
+	struct slName *goTerms;         /* the terms tested, after the size filter */
+	int termCount;
+	struct hash *termIdHash;        /* goTerm to its index in goTerms */
+	char **termNames;               /* and back again */
+	struct hash *testCountHash;     /* tests in each namespace, before the size filter */
+	int *testCounts;                /* tests in each term's namespace, by term id */
+	long totalBalls;
+	long *whiteBalls;               /* by term id */
+	int classCount;                 /* genes with the same set of tested terms are one class */
+	int *classTermCounts;           /* by class */
+	int **classTerms;               /* the term ids of each class, only terms that are their own rep */
+	int *termReps;                  /* by term id, the first term with exactly the same genes */
+	int repCount;                   /* terms that are their own rep, the ones that are counted */
+	struct enrichContextStats stats;
+};
+
+struct enrichResult
+/* the test of one term */
+{
+	struct enrichResult *next;
+	char *term;
+	char *namespace;          /* "all" unless the namespaces option is on */
+	double pValue;            /* Bonferroni corrected within its namespace if asked for */
+	long whiteBallsPicked;
+	long totalPicks;
+	long whiteBalls;
+	long totalBalls;
+	double expected;          /* whiteBallsPicked expected by chance */
+	int testCount;            /* tests in its namespace, the Bonferroni correction */
+	struct slName *hits;      /* names of the genes hit, in genome order, with wantNames */
+	double pLow;              /* from enrichRunApprox, the interval the p-value is estimated */
+	double pHigh;             /* to be in, both 0 otherwise */
+};
+
+struct enrichEdits
+/* the counts of one element set, kept so that elements can come and go */
+{
+	struct enrichContext *context;
+	struct incremental *inc;
+	double *pValues;          /* uncorrected, by term id */
+	boolean fresh;            /* nothing has been scored yet */
+};
+
+void enrichOptionsDefault(struct enrichOptions *options);
+
+void enrichTermNamespace(struct enrichOptions *options, char *goTerm, char *retNamespace, int size);
+
+struct enrichContext *enrichContextNew(struct bedLong *genes, struct bedLong *okRegions, struct bedLong *largeSet, struct packedChrom *packedLargeSet, struct enrichOptions *options);
+
+struct enrichContext *enrichContextLoad(char *genesFile, char *noGapFile, char *largeSetFile, struct enrichOptions *options);
+
+struct enrichContext *enrichContextLoadWithElements(char *elementsFile, boolean keepNames, struct enrichElements **retElements, char *genesFile, char *noGapFile, char *largeSetFile, struct enrichOptions *options);
+
+struct enrichContext *enrichContextForTest(struct enrichContext *context, enum enrichTest test);
+
+void enrichContextsForBackgrounds(struct enrichContext *context, struct bedLong **okRegionsLists, int count, struct enrichContext **retContexts);
+
+void enrichContextsForBackgroundFiles(struct enrichContext *context, char **fileNames, int count, struct enrichContext **retContexts);
+
+void enrichContextFree(struct enrichContext **pContext);
+
+struct slName *enrichNamespaceList(struct enrichContext *context);
+
+struct enrichElements *enrichElementsFromArray(struct enrichElement *array, int count);
+
+struct enrichElements *enrichElementsLoad(char *fileName, boolean keepNames);
+
+struct enrichElements *enrichElementsSample(struct enrichElements *elements, double fraction);
+
+void enrichElementsFree(struct enrichElements **pElements);
+
+struct enrichResult *enrichRun(struct enrichContext *context, struct enrichElements *elements);
+
+struct enrichResult *enrichRunArray(struct enrichContext *context, struct enrichElement *array, int count);
+
+void enrichRunTests(struct enrichContext **contexts, int count, struct enrichElements *elements, struct enrichResult **retResults);
+
+void enrichRunBackgrounds(struct enrichContext **contexts, int count, struct enrichElements *elements, struct enrichResult **retResults);
+
+struct enrichResult *enrichRunSpill(struct enrichContext *context, struct spillSort *sort);
+
+struct enrichResult *enrichRunOntology(struct enrichContext *context, struct enrichElements *elements, struct ontology *ontology, enum enrichOntologyMethod method);
+
+struct enrichResult *enrichRunApprox(struct enrichContext *context, struct enrichElements *elements, double fraction, int topCount);
+
+struct enrichResult *enrichResultsCorrect(struct enrichResult *results, struct enrichOptions *options);
+
+void enrichResultFreeList(struct enrichResult **pList);
+
+void enrichAssignments(struct enrichContext *context, struct enrichElements *elements, FILE *f);
+
+void enrichAssignmentsSave(struct enrichContext *context, struct enrichElements *elements, char *fileName);
+
+struct elementAssignments *enrichAssignmentsLoad(struct enrichContext *context, char *fileName);
+
+struct enrichResult *enrichRunAssignments(struct enrichContext *context, struct elementAssignments *ea);
+
+struct enrichEdits *enrichEditsNew(struct enrichContext *context, struct enrichElements *elements);
+
+void enrichEditsElement(struct enrichEdits *edits, char *chrom, long start, long end, int delta);
+
+struct enrichResult *enrichEditsResults(struct enrichEdits *edits);
+
+void enrichEditsFree(struct enrichEdits **pEdits);
+
+#endif
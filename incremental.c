@@ -0,0 +1,233 @@
+/*
+
+incremental.c
+
+The totals that do not depend on the elements (the white balls and
+total balls) are taken from the analysis context.  Everything that does
+is built up here by adding the elements one at a time, which also fills
+in how many elements sit on each gene or largeSet record.  After that an
+element that comes or goes only visits the domains or records it
+overlaps.
+
+*/
+
+#include "common.h"
+#include "hash.h"
+#include "bedLong.h"
+#include "packedIntervals.h"
+#include "chromShard.h"
+#include "domainIndex.h"
+#include "incremental.h"
+
+
+static void addDomainTerms(struct incremental *inc, struct bedLong *gene, int id)
+/* remembers the term ids of gene, each one once */
+{
+	struct slName *goTerm = NULL;
+	int t = 0, count = 0;
+
+	inc->stampNow++;
+	AllocArray(inc->domainTerms[id], max(slCount(gene->goTerms),1));
+	for(goTerm=gene->goTerms; goTerm != NULL; goTerm=goTerm->next)
+	{
+		if((t = hashIntValDefault(inc->termIdHash, goTerm->name, -1)) < 0 || inc->stamp[t] == inc->stampNow){continue;}
+		inc->stamp[t] = inc->stampNow;
+		inc->domainTerms[id][count++] = t;
+	}
+	inc->domainTermCount[id] = count;
+}
+
+
+static void buildIndexes(struct incremental *inc, struct chromShard **shards, int shardCount)
+{
+	struct bedLong *futon = NULL;
+	int i = 0, id = 0, geneCount = 0;
+
+	for(i=0; i<shardCount; i++)
+		geneCount += slCount(shards[i]->genes);
+	AllocArray(inc->domainTerms, max(geneCount,1));
+	AllocArray(inc->domainTermCount, max(geneCount,1));
+
+	inc->domains = domainIndexNew();
+	for(i=0; i<shardCount; i++)
+	{
+		for(futon=shards[i]->genes; futon != NULL; futon=futon->next)
+		{
+			id = domainIndexAdd(inc->domains, futon);
+			addDomainTerms(inc, futon, id);
+		}
+	}
+	domainIndexFinish(inc->domains);
+
+	if(inc->style == incNullModel)
+	{
+		inc->largeSet = domainIndexNew();
+		for(i=0; i<shardCount; i++)
+		{
+			//largeSet records that were only loaded packed need a bedLong to be indexed,
+			//which is kept here so that the shards are only read
+			futon = shards[i]->largeSet;
+			if(futon == NULL && shards[i]->packedLargeSet != NULL)
+			{
+				futon = bedLongListFromPacked(shards[i]->chrom, shards[i]->packedLargeSet);
+				slAddHead(&inc->madeLargeSets, slRefNew(futon));
+			}
+			for(; futon != NULL; futon=futon->next)
+				domainIndexAdd(inc->largeSet, futon);
+		}
+		domainIndexFinish(inc->largeSet);
+		AllocArray(inc->hitCount, max(inc->largeSet->count,1));
+	}
+	else if(inc->style == incHypergeometric)
+		AllocArray(inc->hitCount, max(geneCount,1));
+}
+
+
+struct incremental *incrementalNew(enum incrementalStyle style, struct chromShard **shards, int shardCount, struct hash *termIdHash, int termCount, boolean countUnassigned, long totalBalls, long *whiteBalls)
+/* Sets up empty counts over the gene side of the shards, which must have */
+/* been prepared already and are not changed.  totalBalls and whiteBalls */
+/* are copied, since adding and removing elements does not move them. */
+/* Elements are then added with incrementalElement. */
+{
+	struct incremental *inc = NULL;
+
+	AllocVar(inc);
+	inc->style = style;
+	inc->countUnassigned = countUnassigned;
+	inc->termIdHash = termIdHash;
+	inc->termCount = termCount;
+	inc->totalBalls = totalBalls;
+	AllocArray(inc->whiteBalls, max(termCount,1));
+	AllocArray(inc->whiteBallsPicked, max(termCount,1));
+	AllocArray(inc->changed, max(termCount,1));
+	AllocArray(inc->stamp, max(termCount,1));
+	memcpy(inc->whiteBalls, whiteBalls, termCount * sizeof(long));
+	inc->elementHash = newHash(16);
+
+	buildIndexes(inc, shards, shardCount);
+	return(inc);
+}
+
+
+void incrementalFree(struct incremental **pInc)
+{
+	struct incremental *inc = *pInc;
+	struct slRef *ref = NULL;
+	struct bedLong *list = NULL;
+	int i = 0;
+
+	if(inc == NULL){return;}
+	for(i=0; i<inc->domains->count; i++)
+		freeMem(inc->domainTerms[i]);
+	freeMem(inc->domainTerms);
+	freeMem(inc->domainTermCount);
+	domainIndexFree(&inc->domains);
+	domainIndexFree(&inc->largeSet);
+	for(ref=inc->madeLargeSets; ref != NULL; ref=ref->next)
+	{
+		list = ref->val;
+		bedLongFreeList(&list);
+	}
+	slFreeList(&inc->madeLargeSets);
+	freeMem(inc->hitCount);
+	freeHash(&inc->elementHash);
+	freeMem(inc->whiteBalls);
+	freeMem(inc->whiteBallsPicked);
+	freeMem(inc->changed);
+	freeMem(inc->stamp);
+	freeMem(inc->ids);
+	freeMem(inc->moreIds);
+	freez(pInc);
+}
+
+
+static void changeTerms(struct incremental *inc, int *termIds, int termIdCount, int delta)
+/* moves the picked white balls of every term not yet seen since the last stampNow++ */
+{
+	int i = 0, t = 0;
+
+	for(i=0; i<termIdCount; i++)
+	{
+		t = termIds[i];
+		if(inc->stamp[t] == inc->stampNow){continue;}
+		inc->stamp[t] = inc->stampNow;
+		inc->whiteBallsPicked[t] += delta;
+		inc->changed[t] = TRUE;
+	}
+}
+
+
+static boolean changeHitCount(struct incremental *inc, int id, int delta)
+/* returns TRUE if the record went from no elements to some, or back */
+{
+	int before = inc->hitCount[id];
+
+	inc->hitCount[id] += delta;
+	return((before == 0) != (inc->hitCount[id] == 0));
+}
+
+
+static void changeElementCopies(struct incremental *inc, char *chrom, long start, long end, int delta)
+{
+	char key[512];
+	struct hashEl *hel = NULL;
+	int copies = 0;
+
+	safef(key, sizeof(key), "%s:%ld-%ld", chrom, start, end);
+	hel = hashStore(inc->elementHash, key);
+	copies = ptToInt(hel->val) + delta;
+	if(copies < 0){errAbort("Error: can not remove element %s, it is not in the element set", key);}
+	hel->val = intToPt(copies);
+}
+
+
+void incrementalElement(struct incremental *inc, char *chrom, long start, long end, int delta)
+/* Adds (delta 1) or removes (delta -1) one element, and marks the terms */
+/* whose counts moved. */
+{
+	int count = 0, moreCount = 0, i = 0, j = 0, id = 0;
+	struct bedLong *record = NULL;
+
+	changeElementCopies(inc, chrom, start, end, delta);
+	count = domainIndexOverlaps((inc->style == incNullModel) ? inc->largeSet : inc->domains, chrom, start, end, &inc->ids, &inc->idAlloc);
+
+	if(inc->style == incBinomial)
+	{
+		if(count > 0 || inc->countUnassigned)
+		{
+			inc->totalPicks += delta;
+			inc->totalChanged = TRUE;
+		}
+		inc->stampNow++;
+		for(i=0; i<count; i++)
+			changeTerms(inc, inc->domainTerms[inc->ids[i]], inc->domainTermCount[inc->ids[i]], delta);
+	}
+	else
+	{
+		for(i=0; i<count; i++)
+		{
+			id = inc->ids[i];
+			if(!changeHitCount(inc, id, delta)){continue;}
+			inc->totalPicks += delta;
+			inc->totalChanged = TRUE;
+			inc->stampNow++;
+			if(inc->style == incHypergeometric)
+				changeTerms(inc, inc->domainTerms[id], inc->domainTermCount[id], delta);
+			else
+			{
+				//a largeSet record brings along the terms of every domain it overlaps
+				record = inc->largeSet->records[id];
+				moreCount = domainIndexOverlaps(inc->domains, record->chrom, record->chromStart, record->chromEnd, &inc->moreIds, &inc->moreIdAlloc);
+				for(j=0; j<moreCount; j++)
+					changeTerms(inc, inc->domainTerms[inc->moreIds[j]], inc->domainTermCount[inc->moreIds[j]], delta);
+			}
+		}
+	}
+}
+
+
+void incrementalClearChanged(struct incremental *inc)
+{
+	memset(inc->changed, 0, inc->termCount * sizeof(boolean));
+	inc->totalChanged = FALSE;
+}
@@ -0,0 +1,69 @@
+/*
+
+incremental.h
+
+Keeps the per-term counts of a finished run in memory along with how
+many elements hit each gene or largeSet record, so that elements can
+be added and removed one at a time and only the counts they touch
+are changed.
+
+*/
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+#ifndef CHROMSHARD_H
+#include "chromShard.h"
+#endif
+
+#ifndef DOMAININDEX_H
+#include "domainIndex.h"
+#endif
+
+enum incrementalStyle
+/* which of the tests the counts are for */
+{
+	incBinomial,        /* elements hitting domains */
+	incHypergeometric,  /* genes hit by elements */
+	incNullModel,       /* largeSet records hit by elements */
+};
+
+struct incremental
+/* everything needed to move the counts along as elements come and go */
+{
+	enum incrementalStyle style;
+	boolean countUnassigned;
+	struct hash *termIdHash;     /* goTerm to term id */
+	int termCount;
+	struct domainIndex *domains;
+	int **domainTerms;           /* term ids of each domain, by domain id */
+	int *domainTermCount;
+	struct domainIndex *largeSet;
+	struct slRef *madeLargeSets;    /* largeSet lists made here from packed records */
+	int *hitCount;               /* elements on each gene or largeSet record */
+	struct hash *elementHash;    /* how many copies of each element there are */
+	long totalBalls;
+	long totalPicks;
+	long *whiteBalls;            /* by term id */
+	long *whiteBallsPicked;
+	boolean *changed;            /* terms whose counts moved since the last incrementalClearChanged */
+	boolean totalChanged;
+	int *stamp;                  /* for counting each term once per element */
+	int stampNow;
+	int *ids, idAlloc;           /* scratch for index lookups */
+	int *moreIds, moreIdAlloc;
+};
+
+struct incremental *incrementalNew(enum incrementalStyle style, struct chromShard **shards, int shardCount, struct hash *termIdHash, int termCount, boolean countUnassigned, long totalBalls, long *whiteBalls);
+
+void incrementalFree(struct incremental **pInc);
+
+void incrementalElement(struct incremental *inc, char *chrom, long start, long end, int delta);
+
+void incrementalClearChanged(struct incremental *inc);
+
+#endif
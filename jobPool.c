@@ -0,0 +1,75 @@
+/*
+
+jobPool.c
+
+A small pthread work pool.  Jobs are handed out in order, so callers
+that want the longest jobs started first should number them that way.
+
+*/
+
+#include <pthread.h>
+#include "common.h"
+#include "jobPool.h"
+
+
+struct jobPool
+{
+	pthread_mutex_t lock;
+	int nextJob;
+	int jobCount;
+	void (*doJob)(void *context, int jobIx);
+	void *context;
+};
+
+
+static void *jobPoolWorker(void *vPool)
+{
+	struct jobPool *pool = (struct jobPool *)vPool;
+	int jobIx = 0;
+
+	while(TRUE)
+	{
+		pthread_mutex_lock(&pool->lock);
+		jobIx = pool->nextJob;
+		pool->nextJob++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if(jobIx >= pool->jobCount){break;}
+		pool->doJob(pool->context, jobIx);
+	}
+	return(NULL);
+}
+
+
+void jobPoolRun(int threadCount, int jobCount, void (*doJob)(void *context, int jobIx), void *context)
+{
+	struct jobPool pool;
+	pthread_t *threads = NULL;
+	int i = 0, err = 0;
+
+	if(threadCount > jobCount){threadCount = jobCount;}
+	if(threadCount <= 1)
+	{
+		for(i=0; i<jobCount; i++)
+			doJob(context, i);
+		return;
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pool.nextJob = 0;
+	pool.jobCount = jobCount;
+	pool.doJob = doJob;
+	pool.context = context;
+
+	AllocArray(threads, threadCount);
+	for(i=0; i<threadCount; i++)
+	{
+		err = pthread_create(&threads[i], NULL, jobPoolWorker, &pool);
+		if(err != 0){errAbort("Error: could not start thread %d of %d (error %d)", i+1, threadCount, err);}
+	}
+	for(i=0; i<threadCount; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&pool.lock);
+	freeMem(threads);
+}
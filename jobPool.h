@@ -0,0 +1,17 @@
+/*
+
+jobPool.h
+
+A small pthread work pool.  A fixed number of worker threads pull
+job numbers from a shared counter until every job has been run.
+
+*/
+
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+void jobPoolRun(int threadCount, int jobCount, void (*doJob)(void *context, int jobIx), void *context);
+/* Call doJob(context, jobIx) once for every jobIx in [0,jobCount) using up to */
+/* threadCount threads.  Returns when all of the jobs have finished. */
+
+#endif
@@ -0,0 +1,172 @@
+/*
+
+ontology.c
+
+The edges are read into a list, then the parents of each term are laid
+out one term after another, and the children of each the same way.
+The level of a term is the longest path to it from a term with no
+parents, so every term is on a deeper level than all of its ancestors,
+and working from the deepest level up reaches every term after all of
+its descendants.
+
+*/
+
+#include "common.h"
+#include "linefile.h"
+#include "hash.h"
+#include "ontology.h"
+
+
+struct ontologyEdge
+{
+	struct ontologyEdge *next;
+	int child;
+	int parent;
+};
+
+
+static int termId(struct ontology *ontology, char *term, int *pAlloc)
+/* the id of term, added if it is new */
+{
+	struct hashEl *hel = hashLookup(ontology->termHash, term);
+
+	if(hel != NULL){return(ptToInt(hel->val));}
+	if(ontology->termCount == *pAlloc)
+	{
+		ExpandArray(ontology->terms, *pAlloc, 2 * *pAlloc);
+		*pAlloc *= 2;
+	}
+	hel = hashAddInt(ontology->termHash, term, ontology->termCount);
+	ontology->terms[ontology->termCount] = hel->name;
+	return(ontology->termCount++);
+}
+
+
+struct ontology *ontologyLoad(char *fileName)
+{
+	struct ontology *ontology = NULL;
+	struct ontologyEdge *edgeList = NULL, *edge = NULL;
+	struct lineFile *lf = lineFileOpen(fileName, TRUE);
+	char *row[2];
+	int termAlloc = 1024, edgeCount = 0, *fill = NULL, i = 0;
+
+	AllocVar(ontology);
+	ontology->termHash = newHash(14);
+	AllocArray(ontology->terms, termAlloc);
+	while(lineFileRow(lf, row))
+	{
+		AllocVar(edge);
+		edge->child = termId(ontology, row[0], &termAlloc);
+		edge->parent = termId(ontology, row[1], &termAlloc);
+		slAddHead(&edgeList, edge);
+		edgeCount++;
+	}
+	lineFileClose(&lf);
+	slReverse(&edgeList);
+
+	AllocArray(ontology->parentOffsets, ontology->termCount+1);
+	AllocArray(ontology->parents, max(edgeCount,1));
+	for(edge=edgeList; edge != NULL; edge=edge->next)
+		ontology->parentOffsets[edge->child+1]++;
+	for(i=0; i<ontology->termCount; i++)
+		ontology->parentOffsets[i+1] += ontology->parentOffsets[i];
+	AllocArray(ontology->childOffsets, ontology->termCount+1);
+	AllocArray(ontology->children, max(edgeCount,1));
+	for(edge=edgeList; edge != NULL; edge=edge->next)
+		ontology->childOffsets[edge->parent+1]++;
+	for(i=0; i<ontology->termCount; i++)
+		ontology->childOffsets[i+1] += ontology->childOffsets[i];
+	AllocArray(fill, max(ontology->termCount,1));
+	for(edge=edgeList; edge != NULL; edge=edge->next)
+		ontology->parents[ontology->parentOffsets[edge->child] + fill[edge->child]++] = edge->parent;
+	for(i=0; i<ontology->termCount; i++)
+		fill[i] = 0;
+	for(edge=edgeList; edge != NULL; edge=edge->next)
+		ontology->children[ontology->childOffsets[edge->parent] + fill[edge->parent]++] = edge->child;
+	freeMem(fill);
+	slFreeList(&edgeList);
+	verbose(2, "Read %d edges between %d terms from %s\n", edgeCount, ontology->termCount, fileName);
+	return(ontology);
+}
+
+
+int ontologyFind(struct ontology *ontology, char *term)
+/* the id of term, -1 if the ontology does not have it */
+{
+	struct hashEl *hel = hashLookup(ontology->termHash, term);
+	return(hel == NULL ? -1 : ptToInt(hel->val));
+}
+
+
+static int termLevel(struct ontology *ontology, int term, int *levels, int *state)
+/* the level of term, working out those of its parents first */
+{
+	int i = 0, level = 0;
+
+	if(state[term] == 2){return(levels[term]);}
+	if(state[term] == 1){errAbort("Error: the ontology has a cycle through %s", ontology->terms[term]);}
+	state[term] = 1;
+	for(i=ontology->parentOffsets[term]; i<ontology->parentOffsets[term+1]; i++)
+		level = max(level, termLevel(ontology, ontology->parents[i], levels, state) + 1);
+	levels[term] = level;
+	state[term] = 2;
+	return(level);
+}
+
+
+int *ontologyLevels(struct ontology *ontology)
+/* the level of every term, by id, 0 for those without parents */
+{
+	int *levels = NULL, *state = NULL, i = 0;
+
+	AllocArray(levels, max(ontology->termCount,1));
+	AllocArray(state, max(ontology->termCount,1));
+	for(i=0; i<ontology->termCount; i++)
+		termLevel(ontology, i, levels, state);
+	freeMem(state);
+	return(levels);
+}
+
+
+int ontologyAncestors(struct ontology *ontology, int term, int *stamp, int stampValue, int **pIds, int *pAlloc)
+/* Puts the ids of every ancestor of term into *pIds, growing it as needed, */
+/* and returns how many there are.  stamp has a place for every term, and */
+/* stampValue must differ from every value in it, so that each ancestor is */
+/* only given once without clearing stamp between calls. */
+{
+	int count = 0, next = 0, t = 0, i = 0, parent = 0;
+
+	stamp[term] = stampValue;
+	for(t=term; ; t=(*pIds)[next++])
+	{
+		for(i=ontology->parentOffsets[t]; i<ontology->parentOffsets[t+1]; i++)
+		{
+			parent = ontology->parents[i];
+			if(stamp[parent] == stampValue){continue;}
+			stamp[parent] = stampValue;
+			if(count == *pAlloc)
+			{
+				ExpandArray(*pIds, *pAlloc, 2 * *pAlloc);
+				*pAlloc *= 2;
+			}
+			(*pIds)[count++] = parent;
+		}
+		if(next == count){break;}
+	}
+	return(count);
+}
+
+
+void ontologyFree(struct ontology **pOntology)
+{
+	struct ontology *ontology = *pOntology;
+
+	if(ontology == NULL){return;}
+	freeHash(&ontology->termHash);
+	freeMem(ontology->terms);
+	freeMem(ontology->parentOffsets);
+	freeMem(ontology->parents);
+	freeMem(ontology->childOffsets);
+	freeMem(ontology->children);
+	freez(pOntology);
+}
@@ -0,0 +1,37 @@
+/*
+
+ontology.h
+
+The is_a edges between terms, such as those of the Gene Ontology, read
+from a file of 'childTerm parentTerm' lines.  Terms that are only named
+in the file are kept too, so that ancestors are still found through
+terms that are not being tested.
+
+*/
+
+#ifndef ONTOLOGY_H
+#define ONTOLOGY_H
+
+struct ontology
+/* the terms and the parents of each */
+{
+	struct hash *termHash;   /* term to its id */
+	char **terms;            /* by id */
+	int termCount;
+	int *parentOffsets;      /* termCount+1 offsets into parents */
+	int *parents;            /* the ids of the parents of each term */
+	int *childOffsets;       /* termCount+1 offsets into children */
+	int *children;           /* the ids of the children of each term */
+};
+
+struct ontology *ontologyLoad(char *fileName);
+
+int ontologyFind(struct ontology *ontology, char *term);
+
+int *ontologyLevels(struct ontology *ontology);
+
+int ontologyAncestors(struct ontology *ontology, int term, int *stamp, int stampValue, int **pIds, int *pAlloc);
+
+void ontologyFree(struct ontology **pOntology);
+
+#endif
@@ -0,0 +1,313 @@
+/*
+
+packedBench.c
+
+Runs every version of the packed interval loops this cpu has (plain C,
+SSE4.1 and AVX2) over random intervals and over the shapes that tend to
+break vector code: lengths that are not a multiple of the vector width,
+empty and zero length intervals, nesting, touching ends, coordinates
+near INT_MAX and windows that miss everything or cover everything.
+Any answer that differs from the plain C one is an error.  The time each
+version takes on the random intervals is then reported.
+
+*/
+
+#include <limits.h>
+#include <time.h>
+#include "common.h"
+#include "options.h"
+#include "hash.h"
+#include "bedLong.h"
+#include "packedIntervals.h"
+
+
+/*---------------------------------------------------------------------------*/
+
+static struct optionSpec optionSpecs[] =
+/* command line option specifications */
+{
+	{"count", OPTION_INT},
+	{"reps", OPTION_INT},
+	{"seed", OPTION_INT},
+	{NULL, 0}
+};
+
+int optCount = 4000000;
+int optReps = 5;
+int optSeed = 1;
+
+
+void usage()
+/* Explain usage and exit. */
+{
+errAbort(
+	"packedBench - check the vector versions of the packed interval loops\n"
+	"   against the plain C ones and time them\n"
+	"usage:\n"
+	"   packedBench [options]\n"
+	"options:\n"
+	"   -count=N  intervals in the timed runs (default %d)\n"
+	"   -reps=N   timed runs of each loop, the fastest is reported (default %d)\n"
+	"   -seed=N   for the random intervals (default %d)\n"
+	"notes:\n"
+	"   \"make check\" runs this with a small count, \"make bench\" with the defaults\n"
+	, optCount, optReps, optSeed);
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+static bits64 randomState = 1;
+
+static bits32 randomNext()
+/* xorshift, so the intervals are the same on every machine */
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 7;
+	randomState ^= randomState << 17;
+	return((bits32)(randomState >> 32));
+}
+
+
+static int randomBelow(int n)
+{
+	return(n <= 1 ? 0 : (int)(randomNext() % (bits32)n));
+}
+
+
+static struct packedIntervals *randomIntervals(int count, int maxGap, int maxLength, int base)
+/* count intervals sorted by start, that overlap when a length beats the gaps */
+{
+	struct packedIntervals *packed = packedIntervalsNew(count);
+	long start = base, end = 0;
+	int i = 0;
+
+	for(i=0; i<count; i++)
+	{
+		start += randomBelow(maxGap + 1);
+		end = start + randomBelow(maxLength + 1);
+		packed->starts[i] = (int)min(start, INT_MAX);
+		packed->ends[i] = (int)min(end, INT_MAX);
+	}
+	return(packed);
+}
+
+
+static double nowSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+static int checksRun = 0;
+
+static void checkWindow(struct packedKernels *tiers, int tierCount, char *caseName, struct packedIntervals *packed, int lo, int hi, int winStart, int winEnd)
+/* markOverlaps and clippedBases of every tier on one window of one case */
+{
+	int *want = NULL, *got = NULL;
+	long wantBases = 0, gotBases = 0;
+	int t = 0, i = 0;
+
+	AllocArray(want, max(packed->count,1));
+	AllocArray(got, max(packed->count,1));
+	/* flags only ever gain bits, so start some of them set */
+	for(i=0; i<packed->count; i++)
+		want[i] = (i % 3 == 0) ? -1 : 0;
+	memcpy(got, want, packed->count * sizeof(int));
+	tiers[0].markOverlaps(packed->starts, packed->ends, lo, hi, winStart, winEnd, want);
+	wantBases = tiers[0].clippedBases(packed->starts, packed->ends, lo, hi, winStart, winEnd);
+	for(t=1; t<tierCount; t++)
+	{
+		for(i=0; i<packed->count; i++)
+			got[i] = (i % 3 == 0) ? -1 : 0;
+		tiers[t].markOverlaps(packed->starts, packed->ends, lo, hi, winStart, winEnd, got);
+		for(i=0; i<packed->count; i++)
+		{
+			if(got[i] != want[i])
+				errAbort("%s markOverlaps differs from scalar on %s [%d,%d) window %d-%d at %d: %d not %d",
+					tiers[t].name, caseName, lo, hi, winStart, winEnd, i, got[i], want[i]);
+		}
+		gotBases = tiers[t].clippedBases(packed->starts, packed->ends, lo, hi, winStart, winEnd);
+		if(gotBases != wantBases)
+			errAbort("%s clippedBases differs from scalar on %s [%d,%d) window %d-%d: %ld not %ld",
+				tiers[t].name, caseName, lo, hi, winStart, winEnd, gotBases, wantBases);
+	}
+	checksRun += 2 * tierCount;
+	freeMem(want);
+	freeMem(got);
+}
+
+
+static void checkCase(struct packedKernels *tiers, int tierCount, char *caseName, struct packedIntervals *packed)
+/* every loop of every tier on one set of intervals, against the plain C answers */
+{
+	int lo = 0, hi = 0, last = 0, first = 0, middle = 0;
+
+	first = (packed->count > 0) ? packed->starts[0] : 0;
+	last = (packed->count > 0) ? packed->ends[packed->count-1] : 0;
+	middle = first + (last - first) / 2;
+
+	/* windows that miss, cover, cut into and sit inside the intervals, */
+	/* over the whole array and over ranges that start at odd offsets */
+	for(lo=0; lo<=min(packed->count, 9); lo++)
+	{
+		for(hi=max(lo, packed->count-9); hi<=packed->count; hi++)
+		{
+			checkWindow(tiers, tierCount, caseName, packed, lo, hi, 0, INT_MAX);
+			checkWindow(tiers, tierCount, caseName, packed, lo, hi, 0, 0);
+			checkWindow(tiers, tierCount, caseName, packed, lo, hi, last, INT_MAX);
+			checkWindow(tiers, tierCount, caseName, packed, lo, hi, first, first + 1);
+			checkWindow(tiers, tierCount, caseName, packed, lo, hi, first + (last - first) / 3, first + 2 * (last - first) / 3);
+			checkWindow(tiers, tierCount, caseName, packed, lo, hi, middle, middle);
+		}
+	}
+}
+
+
+static void checkAll(struct packedKernels *tiers, int tierCount)
+/* the random and edge cases, each at every length up to a few vectors */
+{
+	struct packedIntervals *packed = NULL;
+	char caseName[256];
+	int n = 0, i = 0;
+
+	for(n=0; n<=35; n++)
+	{
+		safef(caseName, sizeof(caseName), "%d random overlapping", n);
+		packed = randomIntervals(n, 50, 200, 0);
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+
+		safef(caseName, sizeof(caseName), "%d random disjoint", n);
+		packed = randomIntervals(n, 500, 100, 1000);
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+
+		safef(caseName, sizeof(caseName), "%d with zero length", n);
+		packed = randomIntervals(n, 20, 3, 0);
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+
+		safef(caseName, sizeof(caseName), "%d near INT_MAX", n);
+		packed = randomIntervals(n, 1000, 100000, INT_MAX - 40000);
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+
+		safef(caseName, sizeof(caseName), "%d identical", n);
+		packed = packedIntervalsNew(n);
+		for(i=0; i<n; i++){packed->starts[i] = 100; packed->ends[i] = 200;}
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+
+		safef(caseName, sizeof(caseName), "%d nested in the first", n);
+		packed = packedIntervalsNew(n);
+		for(i=0; i<n; i++){packed->starts[i] = 10 * i; packed->ends[i] = (i == 0) ? 100000 : 10 * i + 5;}
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+
+		safef(caseName, sizeof(caseName), "%d touching", n);
+		packed = packedIntervalsNew(n);
+		for(i=0; i<n; i++){packed->starts[i] = 7 * i; packed->ends[i] = 7 * (i + 1);}
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+
+		safef(caseName, sizeof(caseName), "%d whole chromosome", n);
+		packed = packedIntervalsNew(n);
+		for(i=0; i<n; i++){packed->starts[i] = i; packed->ends[i] = INT_MAX - i;}
+		checkCase(tiers, tierCount, caseName, packed);
+		packedIntervalsFree(&packed);
+	}
+	packed = randomIntervals(100003, 300, 2000, 0);
+	checkCase(tiers, tierCount, "100003 random", packed);
+	packedIntervalsFree(&packed);
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+static void timeTiers(struct packedKernels *tiers, int tierCount, int count, int reps)
+/* The fastest of reps runs of each loop of each tier on count random */
+/* intervals.  markOverlaps and clippedBases are given windows of about */
+/* 64 intervals each, like the domains the shard joins hand them. */
+{
+	struct packedIntervals *packed = randomIntervals(count, 300, 2000, 0);
+	int *flags = NULL, t = 0, r = 0, lo = 0, hi = 0, winStart = 0, winEnd = 0;
+	double best[2] = {0, 0}, scalarBest[2] = {0, 0}, start = 0, took = 0;
+	long answer[2] = {0, 0}, scalarAnswer[2] = {0, 0}, sum = 0;
+	int k = 0;
+
+	AllocArray(flags, max(count,1));
+	printf("%-8s %14s %14s   (ns per interval, fastest of %d runs over %d intervals)\n",
+		"tier", "markOverlaps", "clippedBases", reps, count);
+	for(t=0; t<tierCount; t++)
+	{
+		for(k=0; k<2; k++){best[k] = 0;}
+		for(r=0; r<reps; r++)
+		{
+			memset(flags, 0, count * sizeof(int));
+			start = nowSeconds();
+			for(lo=0; lo<count; lo=hi)
+			{
+				hi = min(lo + 64, count);
+				winStart = packed->starts[lo] + 150;
+				winEnd = packed->ends[hi-1] - 150;
+				tiers[t].markOverlaps(packed->starts, packed->ends, lo, hi, winStart, winEnd, flags);
+			}
+			took = nowSeconds() - start;
+			if(r == 0 || took < best[0]){best[0] = took;}
+			for(lo=0, sum=0; lo<count; lo++){sum += flags[lo] != 0;}
+			answer[0] = sum;
+
+			start = nowSeconds();
+			for(lo=0, sum=0; lo<count; lo=hi)
+			{
+				hi = min(lo + 64, count);
+				winStart = packed->starts[lo] + 150;
+				winEnd = packed->ends[hi-1] - 150;
+				sum += tiers[t].clippedBases(packed->starts, packed->ends, lo, hi, winStart, winEnd);
+			}
+			took = nowSeconds() - start;
+			if(r == 0 || took < best[1]){best[1] = took;}
+			answer[1] = sum;
+		}
+		if(t == 0)
+		{
+			for(k=0; k<2; k++){scalarBest[k] = best[k]; scalarAnswer[k] = answer[k];}
+		}
+		for(k=0; k<2; k++)
+		{
+			if(answer[k] != scalarAnswer[k])
+				errAbort("%s gave %ld where scalar gave %ld in timed loop %d", tiers[t].name, answer[k], scalarAnswer[k], k);
+		}
+		printf("%-8s", tiers[t].name);
+		for(k=0; k<2; k++)
+			printf(" %7.2f (%4.1fx)", 1e9 * best[k] / max(count,1), (best[k] > 0) ? scalarBest[k] / best[k] : 0);
+		printf("\n");
+	}
+	freeMem(flags);
+	packedIntervalsFree(&packed);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct packedKernels *tiers = NULL;
+	int tierCount = 0;
+
+	optionInit(&argc, argv, optionSpecs);
+	optCount = optionInt("count", optCount);
+	optReps = optionInt("reps", optReps);
+	optSeed = optionInt("seed", optSeed);
+	if(argc != 1 || optCount < 1 || optReps < 1){usage();}
+	randomState = 0x9E3779B97F4A7C15ULL ^ (bits64)optSeed;
+
+	tiers = packedKernelTiers(&tierCount);
+	checkAll(tiers, tierCount);
+	printf("%d checks of %d tiers agree (the joins use %s)\n", checksRun, tierCount, packedKernelName());
+	timeTiers(tiers, tierCount, optCount, optReps);
+	return(0);
+}
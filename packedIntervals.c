@@ -0,0 +1,797 @@
+/*
+
+packedIntervals.c
+
+The inner loops of the overlap and coverage counting, written over
+packed int arrays.  Each loop has an AVX2 (8 intervals at a time),
+an SSE4.1 (4 at a time) and a plain C version.  The one to use is
+picked once, the first time any of them is needed, from what the cpu
+says it supports.
+
+*/
+
+#include <limits.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PACKED_X86
+#endif
+#include "common.h"
+#include "linefile.h"
+#include "hash.h"
+#include "bedLong.h"
+#include "packedIntervals.h"
+
+
+/* one side of a join has to be this many times the size of the other */
+/* before the walk gallops over the bigger side instead of stepping */
+#define GALLOP_RATIO 16
+
+static struct packedKernels tiers[3];	/* plain C first, the fastest last */
+static int tierCount = 0;
+static pthread_once_t kernelsOnce = PTHREAD_ONCE_INIT;
+
+
+/*---------------------------------------------------------------------------*/
+/* plain C */
+
+static void markOverlapsScalar(int *starts, int *ends, int lo, int hi, int winStart, int winEnd, int *flags)
+/* sets flags[i] for every interval in [lo,hi) with at least one base in the window */
+{
+	int i = 0;
+	for(i=lo; i<hi; i++)
+	{
+		if(min(ends[i],winEnd) > max(starts[i],winStart)){flags[i] = -1;}
+	}
+}
+
+
+static long clippedBasesScalar(int *starts, int *ends, int lo, int hi, int winStart, int winEnd)
+/* total length of the intervals in [lo,hi) after clipping them to the window */
+{
+	long sum = 0;
+	int i = 0, overlap = 0;
+	for(i=lo; i<hi; i++)
+	{
+		overlap = min(ends[i],winEnd) - max(starts[i],winStart);
+		if(overlap > 0){sum += overlap;}
+	}
+	return(sum);
+}
+
+
+#ifdef PACKED_X86
+/*---------------------------------------------------------------------------*/
+/* SSE4.1, four at a time */
+
+__attribute__((target("sse4.1")))
+static void markOverlapsSse(int *starts, int *ends, int lo, int hi, int winStart, int winEnd, int *flags)
+{
+	__m128i ws = _mm_set1_epi32(winStart), we = _mm_set1_epi32(winEnd);
+	__m128i s, e, hit;
+	int i = lo;
+
+	for(i=lo; i+4<=hi; i+=4)
+	{
+		s = _mm_loadu_si128((__m128i *)(starts+i));
+		e = _mm_loadu_si128((__m128i *)(ends+i));
+		hit = _mm_cmpgt_epi32(_mm_min_epi32(e, we), _mm_max_epi32(s, ws));
+		hit = _mm_or_si128(hit, _mm_loadu_si128((__m128i *)(flags+i)));
+		_mm_storeu_si128((__m128i *)(flags+i), hit);
+	}
+	markOverlapsScalar(starts, ends, i, hi, winStart, winEnd, flags);
+}
+
+
+__attribute__((target("sse4.1")))
+static long clippedBasesSse(int *starts, int *ends, int lo, int hi, int winStart, int winEnd)
+{
+	__m128i ws = _mm_set1_epi32(winStart), we = _mm_set1_epi32(winEnd), zero = _mm_setzero_si128();
+	__m128i sum = _mm_setzero_si128(), s, e, length;
+	int i = lo;
+
+	for(i=lo; i+4<=hi; i+=4)
+	{
+		s = _mm_loadu_si128((__m128i *)(starts+i));
+		e = _mm_loadu_si128((__m128i *)(ends+i));
+		length = _mm_max_epi32(_mm_sub_epi32(_mm_min_epi32(e, we), _mm_max_epi32(s, ws)), zero);
+		sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(length));
+		sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(_mm_srli_si128(length, 8)));
+	}
+	return(_mm_extract_epi64(sum, 0) + _mm_extract_epi64(sum, 1) + clippedBasesScalar(starts, ends, i, hi, winStart, winEnd));
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* AVX2, eight at a time */
+
+__attribute__((target("avx2")))
+static long sumEpi64Avx2(__m256i sum)
+{
+	__m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	return(_mm_extract_epi64(half, 0) + _mm_extract_epi64(half, 1));
+}
+
+
+__attribute__((target("avx2")))
+static void markOverlapsAvx2(int *starts, int *ends, int lo, int hi, int winStart, int winEnd, int *flags)
+{
+	__m256i ws = _mm256_set1_epi32(winStart), we = _mm256_set1_epi32(winEnd);
+	__m256i s, e, hit;
+	int i = lo;
+
+	for(i=lo; i+8<=hi; i+=8)
+	{
+		s = _mm256_loadu_si256((__m256i *)(starts+i));
+		e = _mm256_loadu_si256((__m256i *)(ends+i));
+		hit = _mm256_cmpgt_epi32(_mm256_min_epi32(e, we), _mm256_max_epi32(s, ws));
+		hit = _mm256_or_si256(hit, _mm256_loadu_si256((__m256i *)(flags+i)));
+		_mm256_storeu_si256((__m256i *)(flags+i), hit);
+	}
+	markOverlapsScalar(starts, ends, i, hi, winStart, winEnd, flags);
+}
+
+
+__attribute__((target("avx2")))
+static long clippedBasesAvx2(int *starts, int *ends, int lo, int hi, int winStart, int winEnd)
+{
+	__m256i ws = _mm256_set1_epi32(winStart), we = _mm256_set1_epi32(winEnd), zero = _mm256_setzero_si256();
+	__m256i sum = _mm256_setzero_si256(), s, e, length;
+	int i = lo;
+
+	for(i=lo; i+8<=hi; i+=8)
+	{
+		s = _mm256_loadu_si256((__m256i *)(starts+i));
+		e = _mm256_loadu_si256((__m256i *)(ends+i));
+		length = _mm256_max_epi32(_mm256_sub_epi32(_mm256_min_epi32(e, we), _mm256_max_epi32(s, ws)), zero);
+		sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(length)));
+		sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(length, 1)));
+	}
+	return(sumEpi64Avx2(sum) + clippedBasesScalar(starts, ends, i, hi, winStart, winEnd));
+}
+#endif
+
+
+/*---------------------------------------------------------------------------*/
+
+static void addTier(char *name, void (*markOverlaps)(int *, int *, int, int, int, int, int *),
+	long (*clippedBases)(int *, int *, int, int, int, int))
+{
+	struct packedKernels *k = &tiers[tierCount++];
+	k->name = name;
+	k->markOverlaps = markOverlaps;
+	k->clippedBases = clippedBases;
+}
+
+
+static void findTiers()
+{
+	addTier("scalar", markOverlapsScalar, clippedBasesScalar);
+#ifdef PACKED_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse4.1"))
+		addTier("sse4.1", markOverlapsSse, clippedBasesSse);
+	if(__builtin_cpu_supports("avx2"))
+		addTier("avx2", markOverlapsAvx2, clippedBasesAvx2);
+#endif
+}
+
+
+static struct packedKernels *getKernels()
+/* the fastest versions this cpu will run */
+{
+	pthread_once(&kernelsOnce, findTiers);
+	return(&tiers[tierCount-1]);
+}
+
+
+struct packedKernels *packedKernelTiers(int *retCount)
+/* Every version of the loops this cpu can run, plain C first and the one */
+/* the joins use last, so packedBench can check them against each other. */
+{
+	pthread_once(&kernelsOnce, findTiers);
+	*retCount = tierCount;
+	return(tiers);
+}
+
+
+char *packedKernelName()
+{
+	return(getKernels()->name);
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+struct packedNames *packedNamesNew()
+{
+	struct packedNames *names = NULL;
+	AllocVar(names);
+	names->hash = newHash(16);
+	names->alloc = 1024;
+	names->textAlloc = 16 * names->alloc;
+	names->offsets = needLargeMem(names->alloc * sizeof(long));
+	names->text = needLargeMem(names->textAlloc);
+	return(names);
+}
+
+
+static int packedNamesAppend(struct packedNames *names, char *name, int size)
+/* copies the size bytes of name, its 0 included, onto the end of the text */
+{
+	if(names->count == names->alloc)
+	{
+		names->alloc *= 2;
+		names->offsets = needLargeMemResize(names->offsets, names->alloc * sizeof(long));
+	}
+	while(names->textSize + size > names->textAlloc)
+	{
+		names->textAlloc *= 2;
+		names->text = needLargeMemResize(names->text, names->textAlloc);
+	}
+	memcpy(names->text + names->textSize, name, size);
+	names->offsets[names->count] = names->textSize;
+	names->textSize += size;
+	return(names->count++);
+}
+
+
+int packedNamesAdd(struct packedNames *names, char *name)
+/* the number of name, adding it if it is new */
+{
+	struct hashEl *hel = hashLookup(names->hash, name);
+	int id = 0;
+
+	if(hel != NULL){return(ptToInt(hel->val));}
+	id = packedNamesAppend(names, name, strlen(name) + 1);
+	hashAdd(names->hash, name, intToPt(id));
+	return(id);
+}
+
+
+int packedNamesAddAll(struct packedNames *names, struct packedNames *more)
+/* Adds every name of more without looking for them in names, so a name */
+/* that is in both is held twice.  Returns the number the first of them */
+/* has in names; the others follow it in order. */
+{
+	int first = names->count, i = 0;
+	long end = 0;
+
+	for(i=0; i<more->count; i++)
+	{
+		end = (i+1 < more->count) ? more->offsets[i+1] : more->textSize;
+		packedNamesAppend(names, more->text + more->offsets[i], end - more->offsets[i]);
+	}
+	return(first);
+}
+
+
+void packedNamesDone(struct packedNames *names)
+/* frees the hash once every name has been added, leaving only the text */
+{
+	freeHash(&names->hash);
+}
+
+
+void packedNamesFree(struct packedNames **pNames)
+{
+	struct packedNames *names = *pNames;
+	if(names == NULL){return;}
+	freeHash(&names->hash);
+	freeMem(names->offsets);
+	freeMem(names->text);
+	freez(pNames);
+}
+
+
+struct packedIntervals *packedIntervalsNew(int count)
+{
+	struct packedIntervals *packed = NULL;
+	AllocVar(packed);
+	packed->count = count;
+	AllocArray(packed->starts, max(count,1));
+	AllocArray(packed->ends, max(count,1));
+	return(packed);
+}
+
+
+struct packedIntervals *packedIntervalsFromBedLong(struct bedLong *bedLongList, char *goTerm)
+/* Copies the coordinates of the sorted list, or only of those records */
+/* with goTerm when it is not NULL.  Returns NULL when a coordinate will */
+/* not fit in an int, and the caller should stay with the list. */
+{
+	struct packedIntervals *packed = NULL;
+	struct bedLong *futon = NULL;
+	int count = 0;
+
+	for(futon=bedLongList; futon != NULL; futon=futon->next)
+	{
+		if(goTerm != NULL && !bedLongHasGoTerm(futon, goTerm)){continue;}
+		if(futon->chromStart < 0 || futon->chromEnd > INT_MAX || futon->chromEnd < futon->chromStart){return(NULL);}
+		count++;
+	}
+
+	packed = packedIntervalsNew(count);
+	count = 0;
+	for(futon=bedLongList; futon != NULL; futon=futon->next)
+	{
+		if(goTerm != NULL && !bedLongHasGoTerm(futon, goTerm)){continue;}
+		packed->starts[count] = (int)futon->chromStart;
+		packed->ends[count] = (int)futon->chromEnd;
+		count++;
+	}
+	return(packed);
+}
+
+
+void packedIntervalsFree(struct packedIntervals **pPacked)
+{
+	struct packedIntervals *packed = *pPacked;
+	if(packed == NULL){return;}
+	freeMem(packed->starts);
+	freeMem(packed->ends);
+	freeMem(packed->counts);
+	freeMem(packed->nameIds);
+	freeMem(packed->maxEnds);
+	packedIntervalsFree(&packed->merged);
+	freez(pPacked);
+}
+
+
+struct packedIntervals *packedUnion(struct packedIntervals *packed)
+/* returns the sorted, non-overlapping intervals covering the same bases */
+{
+	struct packedIntervals *merged = packedIntervalsNew(packed->count);
+	int i = 0, count = 0;
+
+	for(i=0; i<packed->count; i++)
+	{
+		if(packed->ends[i] <= packed->starts[i]){continue;}
+		if(count > 0 && packed->starts[i] <= merged->ends[count-1])
+		{
+			merged->ends[count-1] = max(merged->ends[count-1], packed->ends[i]);
+		}
+		else
+		{
+			merged->starts[count] = packed->starts[i];
+			merged->ends[count] = packed->ends[i];
+			count++;
+		}
+	}
+	merged->count = count;
+	return(merged);
+}
+
+
+void packedIntervalsIndex(struct packedIntervals *packed)
+/* Works out the running largest end and the union of intervals that will */
+/* be joined against many times, so the joins can jump straight to the */
+/* part of them that matters.  The intervals must not change after this. */
+{
+	int i = 0;
+
+	if(packed->maxEnds != NULL){return;}
+	AllocArray(packed->maxEnds, max(packed->count,1));
+	for(i=0; i<packed->count; i++)
+		packed->maxEnds[i] = (i == 0) ? packed->ends[i] : max(packed->maxEnds[i-1], packed->ends[i]);
+	packed->merged = packedUnion(packed);
+}
+
+
+static boolean sameInterval(struct packedIntervals *packed, int i, int j)
+/* whether intervals i and j have the same coordinates and name */
+{
+	if(packed->starts[i] != packed->starts[j] || packed->ends[i] != packed->ends[j]){return(FALSE);}
+	return(packed->nameIds == NULL || packed->nameIds[i] == packed->nameIds[j]);
+}
+
+
+int packedIntervalsCollapse(struct packedIntervals *packed)
+/* Folds every run of identical intervals, which sorting by start and end */
+/* puts next to each other, into its first one, keeping in counts how many */
+/* records each interval left stands for.  Named intervals are kept in file */
+/* order among those with the same start, so only repeats in a row with */
+/* the same name are folded.  Returns how many were folded. */
+{
+	int i = 0, count = 0, folded = 0;
+
+	for(i=1; i<packed->count; i++)
+	{
+		if(sameInterval(packed, i, i-1)){break;}
+	}
+	if(i >= packed->count){return(0);}
+	if(packed->counts == NULL)
+	{
+		AllocArray(packed->counts, packed->count);
+		for(i=0; i<packed->count; i++)
+			packed->counts[i] = 1;
+	}
+	for(i=0; i<packed->count; i++)
+	{
+		if(count > 0 && sameInterval(packed, i, count-1))
+		{
+			packed->counts[count-1] += packed->counts[i];
+			folded++;
+			continue;
+		}
+		packed->starts[count] = packed->starts[i];
+		packed->ends[count] = packed->ends[i];
+		if(packed->nameIds != NULL){packed->nameIds[count] = packed->nameIds[i];}
+		packed->counts[count++] = packed->counts[i];
+	}
+	packed->count = count;
+	return(folded);
+}
+
+
+long packedRecordCount(struct packedIntervals *packed)
+/* the records the intervals stand for, counting each repeat */
+{
+	long total = 0;
+	int i = 0;
+
+	if(packed->counts == NULL){return(packed->count);}
+	for(i=0; i<packed->count; i++)
+		total += packed->counts[i];
+	return(total);
+}
+
+
+static int gallopPast(int *values, int from, int count, int key)
+/* The first index at or after from whose value is above key, or count if */
+/* none is.  values must not go down.  The step doubles until it passes */
+/* key and is then binary searched, so a jump of d costs about log d. */
+{
+	int step = 1, lo = from, hi = from;
+
+	while(hi < count && values[hi] <= key)
+	{
+		lo = hi + 1;
+		hi = from + step;
+		step *= 2;
+	}
+	hi = min(hi, count);
+	while(lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+		if(values[mid] <= key){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	return(lo);
+}
+
+
+void packedOverlapFlags(struct packedIntervals *listOne, struct packedIntervals *listTwo, int *flags)
+{
+	/* Sets flags[i] to non-zero for every interval i of listOne that overlaps */
+	/* anything in listTwo.  flags must start out zeroed.  When the sizes are */
+	/* far apart the walk is driven by the smaller side: with few windows and */
+	/* an indexed listOne it gallops to the intervals near each window, and */
+	/* with few intervals it gallops through the windows, which being disjoint */
+	/* have ends that only go up. */
+	struct packedKernels *k = getKernels();
+	struct packedIntervals *windows = NULL;
+	int w = 0, lo = 0, hi = 0, i = 0;
+
+	if(listOne->count == 0 || listTwo->count == 0){return;}
+	windows = (listTwo->merged != NULL) ? listTwo->merged : packedUnion(listTwo);
+	if(listOne->maxEnds != NULL && (long)windows->count * GALLOP_RATIO < listOne->count)
+	{
+		for(w=0; w<windows->count; w++)
+		{
+			hi = gallopPast(listOne->starts, hi, listOne->count, windows->ends[w] - 1);
+			lo = gallopPast(listOne->maxEnds, lo, hi, windows->starts[w]);
+			k->markOverlaps(listOne->starts, listOne->ends, lo, hi, windows->starts[w], windows->ends[w], flags);
+		}
+	}
+	else if((long)listOne->count * GALLOP_RATIO < windows->count)
+	{
+		for(i=0; i<listOne->count && w<windows->count; i++)
+		{
+			w = gallopPast(windows->ends, w, windows->count, listOne->starts[i]);
+			if(w < windows->count && windows->starts[w] < listOne->ends[i] && listOne->starts[i] < listOne->ends[i]){flags[i] = -1;}
+		}
+	}
+	else
+	{
+		for(w=0; w<windows->count; w++)
+		{
+			while(hi < listOne->count && listOne->starts[hi] < windows->ends[w]){hi++;}
+			while(lo < hi && listOne->ends[lo] <= windows->starts[w]){lo++;}
+			k->markOverlaps(listOne->starts, listOne->ends, lo, hi, windows->starts[w], windows->ends[w], flags);
+		}
+	}
+	if(windows != listTwo->merged){packedIntervalsFree(&windows);}
+}
+
+
+int packedIntersectCount(struct packedIntervals *listOne, struct packedIntervals *listTwo)
+/* same as bedLongIntersectCount: the number of records in listOne that */
+/* overlap anything in listTwo, counting each repeat */
+{
+	int *flags = NULL;
+	int i = 0, count = 0;
+
+	if(listOne->count == 0 || listTwo->count == 0){return(0);}
+	AllocArray(flags, listOne->count);
+	packedOverlapFlags(listOne, listTwo, flags);
+	for(i=0; i<listOne->count; i++)
+	{
+		if(flags[i] != 0){count += (listOne->counts != NULL) ? listOne->counts[i] : 1;}
+	}
+	freeMem(flags);
+	return(count);
+}
+
+
+long packedIntersectBases(struct packedIntervals *packed, struct packedIntervals *disjoint)
+/* Bases covered by both lists, each counted once. */
+/* The second list must already be disjoint, as packedUnion returns. */
+{
+	struct packedKernels *k = getKernels();
+	struct packedIntervals *windows = NULL;
+	boolean gallop = FALSE;
+	long sum = 0;
+	int w = 0, lo = 0, hi = 0;
+
+	if(packed->count == 0 || disjoint->count == 0){return(0);}
+	windows = (packed->merged != NULL) ? packed->merged : packedUnion(packed);
+	gallop = ((long)windows->count * GALLOP_RATIO < disjoint->count);
+	for(w=0; w<windows->count; w++)
+	{
+		if(gallop)
+		{
+			lo = gallopPast(disjoint->ends, lo, disjoint->count, windows->starts[w]);
+			hi = gallopPast(disjoint->starts, max(hi, lo), disjoint->count, windows->ends[w] - 1);
+		}
+		else
+		{
+			while(lo < disjoint->count && disjoint->ends[lo] <= windows->starts[w]){lo++;}
+			hi = max(hi, lo);
+			while(hi < disjoint->count && disjoint->starts[hi] < windows->ends[w]){hi++;}
+		}
+		sum += k->clippedBases(disjoint->starts, disjoint->ends, lo, hi, windows->starts[w], windows->ends[w]);
+	}
+	if(windows != packed->merged){packedIntervalsFree(&windows);}
+	return(sum);
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+struct bedLong *bedLongListFromPacked(char *chrom, struct packedIntervals *packed)
+/* turns packed intervals back into a list, for the code that needs 64 bit coordinates */
+{
+	struct bedLong *list = NULL, *futon = NULL;
+	int i = 0, k = 0;
+
+	for(i=packed->count-1; i>=0; i--)
+	{
+		//a repeated interval is given back as that many records
+		for(k=(packed->counts != NULL) ? packed->counts[i] : 1; k>0; k--)
+		{
+			AllocVar(futon);
+			futon->chrom = cloneString(chrom);
+			futon->chromStart = packed->starts[i];
+			futon->chromEnd = packed->ends[i];
+			if(packed->nameIds != NULL){futon->name = cloneString(packedName(packed->names, packed->nameIds[i]));}
+			slAddHead(&list, futon);
+		}
+	}
+	return(list);
+}
+
+
+struct packedIntervals *packedIntervalsSlice(struct packedIntervals *packed, int start, int end)
+/* a copy of intervals [start,end) of packed */
+{
+	struct packedIntervals *slice = packedIntervalsNew(end - start);
+	memcpy(slice->starts, packed->starts + start, (end - start) * sizeof(int));
+	memcpy(slice->ends, packed->ends + start, (end - start) * sizeof(int));
+	if(packed->counts != NULL)
+	{
+		AllocArray(slice->counts, max(end - start,1));
+		memcpy(slice->counts, packed->counts + start, (end - start) * sizeof(int));
+	}
+	if(packed->nameIds != NULL)
+	{
+		AllocArray(slice->nameIds, max(end - start,1));
+		memcpy(slice->nameIds, packed->nameIds + start, (end - start) * sizeof(int));
+		slice->names = packed->names;
+	}
+	return(slice);
+}
+
+
+int packedFirstStartAtOrAfter(struct packedIntervals *packed, long position)
+/* index of the first interval that starts at or after position */
+{
+	int lo = 0, hi = packed->count, mid = 0;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if(packed->starts[mid] < position){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	return(lo);
+}
+
+
+static struct packedChrom *packedChromFind(struct hash *chromHash, struct packedChrom **pList, char *chrom)
+{
+	struct packedChrom *pc = hashFindVal(chromHash, chrom);
+	if(pc == NULL)
+	{
+		AllocVar(pc);
+		pc->chrom = cloneString(chrom);
+		pc->packed = packedIntervalsNew(0);
+		hashAdd(chromHash, chrom, pc);
+		slAddHead(pList, pc);
+	}
+	return(pc);
+}
+
+
+static void packedChromAdd(struct packedChrom *pc, int start, int end, int nameId)
+/* adds one interval, with the number of its name or -1 for none */
+{
+	struct packedIntervals *packed = pc->packed;
+	if(packed->count == pc->alloc)
+	{
+		pc->alloc = max(1024, 2 * pc->alloc);
+		packed->starts = needLargeMemResize(packed->starts, pc->alloc * sizeof(int));
+		packed->ends = needLargeMemResize(packed->ends, pc->alloc * sizeof(int));
+		if(nameId >= 0){packed->nameIds = needLargeMemResize(packed->nameIds, pc->alloc * sizeof(int));}
+	}
+	packed->starts[packed->count] = start;
+	packed->ends[packed->count] = end;
+	if(nameId >= 0){packed->nameIds[packed->count] = nameId;}
+	packed->count++;
+}
+
+
+static int bits64Cmp(const void *va, const void *vb)
+{
+	bits64 a = *((bits64 *)va), b = *((bits64 *)vb);
+	if(a > b){return(1);}
+	else if(a == b){return(0);}
+	else{return(-1);}
+}
+
+
+static void packedIntervalsSort(struct packedIntervals *packed)
+/* Sorts by start, like bedLongCmp within a chromosome, and then by end. */
+/* Named intervals are sorted by start and then kept in file order, as a */
+/* list of them would be, so that they come out in the same order. */
+{
+	bits64 *keys = NULL;
+	int *ends = NULL, *nameIds = NULL;
+	int i = 0, from = 0;
+
+	if(packed->count < 2){return;}
+	keys = needLargeMem(packed->count * sizeof(bits64));
+	if(packed->nameIds == NULL)
+	{
+		for(i=0; i<packed->count; i++)
+			keys[i] = (((bits64)packed->starts[i]) << 32) | (bits32)packed->ends[i];
+		qsort(keys, packed->count, sizeof(bits64), bits64Cmp);
+		for(i=0; i<packed->count; i++)
+		{
+			packed->starts[i] = (int)(keys[i] >> 32);
+			packed->ends[i] = (int)(keys[i] & 0xffffffff);
+		}
+		freeMem(keys);
+		return;
+	}
+	for(i=0; i<packed->count; i++)
+		keys[i] = (((bits64)packed->starts[i]) << 32) | (bits32)i;
+	qsort(keys, packed->count, sizeof(bits64), bits64Cmp);
+	ends = needLargeMem(packed->count * sizeof(int));
+	nameIds = needLargeMem(packed->count * sizeof(int));
+	for(i=0; i<packed->count; i++)
+	{
+		from = (int)(keys[i] & 0xffffffff);
+		packed->starts[i] = (int)(keys[i] >> 32);
+		ends[i] = packed->ends[from];
+		nameIds[i] = packed->nameIds[from];
+	}
+	freeMem(packed->ends);
+	freeMem(packed->nameIds);
+	packed->ends = ends;
+	packed->nameIds = nameIds;
+	freeMem(keys);
+}
+
+
+void packedChromFreeList(struct packedChrom **pList)
+{
+	struct packedChrom *pc = NULL, *next = NULL;
+	for(pc = *pList; pc != NULL; pc = next)
+	{
+		next = pc->next;
+		freeMem(pc->chrom);
+		packedIntervalsFree(&pc->packed);
+		freeMem(pc);
+	}
+	*pList = NULL;
+}
+
+
+boolean packedChromAddInterval(struct hash *chromHash, struct packedChrom **pList, char *chrom, long start, long end)
+/* Adds one interval to the packedChrom of chrom in *pList, starting a new one */
+/* if need be.  Returns FALSE when the interval does not fit in an int. */
+{
+	struct packedChrom *pc = *pList;
+
+	if(start < 0 || end > INT_MAX || end < start){return(FALSE);}
+	if(pc == NULL || differentString(pc->chrom, chrom))
+		pc = packedChromFind(chromHash, pList, chrom);
+	packedChromAdd(pc, (int)start, (int)end, -1);
+	return(TRUE);
+}
+
+
+boolean packedChromAddNamed(struct hash *chromHash, struct packedChrom **pList, struct packedNames *names, char *chrom, long start, long end, char *name)
+/* packedChromAddInterval for an interval with a name, which is kept once */
+/* in names and referred to by its number */
+{
+	struct packedChrom *pc = *pList;
+
+	if(start < 0 || end > INT_MAX || end < start){return(FALSE);}
+	if(pc == NULL || differentString(pc->chrom, chrom))
+		pc = packedChromFind(chromHash, pList, chrom);
+	pc->packed->names = names;
+	packedChromAdd(pc, (int)start, (int)end, packedNamesAdd(names, name));
+	return(TRUE);
+}
+
+
+void packedChromFinish(struct packedChrom **pList)
+/* sorts the intervals of every chromosome once they have all been added */
+{
+	struct packedChrom *pc = NULL;
+
+	for(pc = *pList; pc != NULL; pc = pc->next)
+		packedIntervalsSort(pc->packed);
+	slReverse(pList);
+}
+
+
+boolean packedChromLoad(char *filename, struct packedNames *names, struct packedChrom **retList)
+/* Loads a bed file straight into sorted packed intervals, one per */
+/* chromosome, without making a bedLong for every line.  That is 8 bytes a */
+/* record instead of a struct and a chromosome string.  With names the */
+/* fourth column is kept in it as well, at 4 bytes a record and each name */
+/* once; without, only the first 3 columns are read.  Returns FALSE when a */
+/* coordinate does not fit in an int; the file then has to be loaded with */
+/* filenameToBedLong instead. */
+{
+	struct lineFile *lf = lineFileOpen(filename, TRUE);
+	struct hash *chromHash = newHash(8);
+	struct packedChrom *list = NULL;
+	char *row[4];
+	long start = 0, end = 0;
+	boolean fits = TRUE;
+
+	while(lineFileNextRow(lf, row, (names != NULL) ? 4 : 3))
+	{
+		start = stringToLong(row[1]);
+		end = stringToLong(row[2]);
+		if(names != NULL){fits = packedChromAddNamed(chromHash, &list, names, row[0], start, end, row[3]);}
+		else{fits = packedChromAddInterval(chromHash, &list, row[0], start, end);}
+		if(!fits)
+		{
+			verbose(2, "  %s:%ld-%ld in %s does not fit in 32 bits\n", row[0], start, end, filename);
+			lineFileClose(&lf);
+			freeHash(&chromHash);
+			packedChromFreeList(&list);
+			return(FALSE);
+		}
+	}
+	lineFileClose(&lf);
+	freeHash(&chromHash);
+
+	packedChromFinish(&list);
+	*retList = list;
+	return(TRUE);
+}
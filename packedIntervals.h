@@ -0,0 +1,121 @@
+/*
+
+packedIntervals.h
+
+The coordinates of a sorted interval list copied into two plain int
+arrays, so the overlap and coverage loops can be run several intervals
+at a time with AVX2 or SSE4.1, falling back to plain C when the cpu
+has neither.  Named intervals also keep the number of their name in a
+table of the file's distinct names, so a name repeated on many records
+is held once.
+
+*/
+
+#ifndef PACKEDINTERVALS_H
+#define PACKEDINTERVALS_H
+
+#ifndef HASH_H
+#include "hash.h"
+#endif
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+struct packedNames
+/* the distinct names of one file, that packed intervals refer to by */
+/* number, held one after another in a single block of text */
+{
+	struct hash *hash;	/* name to its number, freed once they are all in */
+	char *text;	/* the names, each ended by a 0 */
+	long *offsets;	/* by number, where each name starts in text */
+	long textSize;
+	long textAlloc;
+	int count;
+	int alloc;
+};
+
+#define packedName(names, id) ((names)->text + (names)->offsets[(id)])
+/* the name with number id */
+
+struct packedIntervals
+/* starts and ends of intervals from one chromosome, sorted by start */
+{
+	int count;
+	int *starts;	/* all coordinates are between 0 and INT_MAX */
+	int *ends;
+	int *counts;	/* records each interval stands for, NULL when one each */
+	int *nameIds;	/* by interval, the number of its name, NULL without names */
+	struct packedNames *names;	/* shared by every chromosome of a file, not freed with these */
+	int *maxEnds;	/* largest end of intervals [0,i], NULL until indexed */
+	struct packedIntervals *merged;	/* packedUnion of these, NULL until indexed */
+};
+
+struct packedChrom
+/* the packed intervals of one chromosome of a file */
+{
+	struct packedChrom *next;
+	char *chrom;
+	struct packedIntervals *packed;
+	int alloc;	/* room in packed, while it is being loaded */
+};
+
+struct packedKernels
+/* one version of the inner loops over packed arrays */
+{
+	char *name;
+	void (*markOverlaps)(int *starts, int *ends, int lo, int hi, int winStart, int winEnd, int *flags);
+	long (*clippedBases)(int *starts, int *ends, int lo, int hi, int winStart, int winEnd);
+};
+
+struct packedNames *packedNamesNew();
+
+int packedNamesAdd(struct packedNames *names, char *name);
+
+int packedNamesAddAll(struct packedNames *names, struct packedNames *more);
+
+void packedNamesDone(struct packedNames *names);
+
+void packedNamesFree(struct packedNames **pNames);
+
+struct packedIntervals *packedIntervalsNew(int count);
+
+struct packedIntervals *packedIntervalsFromBedLong(struct bedLong *bedLongList, char *goTerm);
+
+void packedIntervalsFree(struct packedIntervals **pPacked);
+
+struct packedIntervals *packedUnion(struct packedIntervals *packed);
+
+void packedIntervalsIndex(struct packedIntervals *packed);
+
+int packedIntervalsCollapse(struct packedIntervals *packed);
+
+long packedRecordCount(struct packedIntervals *packed);
+
+void packedOverlapFlags(struct packedIntervals *listOne, struct packedIntervals *listTwo, int *flags);
+
+int packedIntersectCount(struct packedIntervals *listOne, struct packedIntervals *listTwo);
+
+long packedIntersectBases(struct packedIntervals *packed, struct packedIntervals *disjoint);
+
+char *packedKernelName();
+
+struct packedKernels *packedKernelTiers(int *retCount);
+
+struct bedLong *bedLongListFromPacked(char *chrom, struct packedIntervals *packed);
+
+struct packedIntervals *packedIntervalsSlice(struct packedIntervals *packed, int start, int end);
+
+int packedFirstStartAtOrAfter(struct packedIntervals *packed, long position);
+
+boolean packedChromAddInterval(struct hash *chromHash, struct packedChrom **pList, char *chrom, long start, long end);
+
+boolean packedChromAddNamed(struct hash *chromHash, struct packedChrom **pList, struct packedNames *names, char *chrom, long start, long end, char *name);
+
+void packedChromFinish(struct packedChrom **pList);
+
+boolean packedChromLoad(char *filename, struct packedNames *names, struct packedChrom **retList);
+
+void packedChromFreeList(struct packedChrom **pList);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+
+pointIndex.c
+
+The bounds are every distinct start and end.  One sweep over them in
+order keeps the domains covering the current segment in list order:
+domains join when the sweep reaches their start and leave when it
+reaches their end, so a domain that has started and not ended covers
+the whole of every segment in between.  Empty domains cover nothing.
+
+*/
+
+#include "common.h"
+#include "bedLong.h"
+#include "pointIndex.h"
+
+
+static int longCmp(const void *va, const void *vb)
+{
+	long a = *((const long *)va), b = *((const long *)vb);
+	if(a < b){return(-1);}
+	if(a > b){return(1);}
+	return(0);
+}
+
+
+struct pointIndex *pointIndexNew(struct bedLong *domains, int *domainLabels)
+/* Cuts domains, which must be sorted by start, into segments.  The ids of */
+/* the domains are their places in the list, and domainLabels has the label */
+/* of each, by id. */
+{
+	struct pointIndex *pi = NULL;
+	struct bedLong *futon = NULL, **records = NULL;
+	int *active = NULL, activeCount = 0, domainCount = slCount(domains), next = 0;
+	int boundCount = 0, domainAlloc = 0, total = 0, i = 0, a = 0, keep = 0, k = 0, label = 0;
+
+	AllocVar(pi);
+	AllocArray(records, max(domainCount,1));
+	AllocArray(active, max(domainCount,1));
+	AllocArray(pi->bounds, max(2*domainCount,1));
+	for(futon=domains, i=0; futon != NULL; futon=futon->next, i++)
+	{
+		records[i] = futon;
+		if(futon->chromEnd <= futon->chromStart){continue;}
+		pi->bounds[boundCount++] = futon->chromStart;
+		pi->bounds[boundCount++] = futon->chromEnd;
+	}
+	qsort(pi->bounds, boundCount, sizeof(long), longCmp);
+	for(i=0, k=0; i<boundCount; i++)
+	{
+		if(k == 0 || pi->bounds[i] != pi->bounds[k-1]){pi->bounds[k++] = pi->bounds[i];}
+	}
+	pi->count = max(k-1, 0);
+
+	domainAlloc = max(domainCount,16);
+	AllocArray(pi->domains, domainAlloc);
+	AllocArray(pi->offsets, pi->count+1);
+	AllocArray(pi->labels, max(pi->count,1));
+	for(k=0; k<pi->count; k++)
+	{
+		for(a=0, keep=0; a<activeCount; a++)
+		{
+			if(records[active[a]]->chromEnd > pi->bounds[k]){active[keep++] = active[a];}
+		}
+		activeCount = keep;
+		for(; next < domainCount && records[next]->chromStart <= pi->bounds[k]; next++)
+		{
+			if(records[next]->chromEnd > pi->bounds[k]){active[activeCount++] = next;}
+		}
+
+		if(total + activeCount > domainAlloc)
+		{
+			ExpandArray(pi->domains, domainAlloc, max(2*domainAlloc, total + activeCount));
+			domainAlloc = max(2*domainAlloc, total + activeCount);
+		}
+		label = -1;
+		for(a=0; a<activeCount; a++)
+		{
+			pi->domains[total++] = active[a];
+			if(label == -1){label = domainLabels[active[a]];}
+			else if(label != domainLabels[active[a]]){label = -2;}
+		}
+		pi->labels[k] = label;
+		pi->offsets[k+1] = total;
+	}
+	freeMem(active);
+	freeMem(records);
+	return(pi);
+}
+
+
+int pointIndexFind(struct pointIndex *pi, long position)
+/* the segment position is in, -1 if it is outside every domain */
+{
+	int lo = 0, hi = pi->count, mid = 0;
+
+	//lo becomes the first segment that starts after position
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo)/2;
+		if(pi->bounds[mid] <= position){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	if(lo == 0 || position >= pi->bounds[pi->count]){return(-1);}
+	return(lo - 1);
+}
+
+
+int pointIndexNext(struct pointIndex *pi, int segment, long position)
+/* pointIndexFind for a position at or after the start of segment, from */
+/* the segment of the position before it, stepping forward when it is close */
+{
+	int k = 0;
+
+	if(segment < 0){return(pointIndexFind(pi, position));}
+	for(k=segment; k < segment+8 && k < pi->count; k++)
+	{
+		if(position < pi->bounds[k+1]){return(k);}
+	}
+	return(pointIndexFind(pi, position));
+}
+
+
+void pointIndexFree(struct pointIndex **pPi)
+{
+	struct pointIndex *pi = *pPi;
+
+	if(pi == NULL){return;}
+	freeMem(pi->bounds);
+	freeMem(pi->offsets);
+	freeMem(pi->domains);
+	freeMem(pi->labels);
+	freez(pPi);
+}
@@ -0,0 +1,41 @@
+/*
+
+pointIndex.h
+
+The domains of one chromosome cut at every start and end into
+segments, so that each segment is covered by one fixed set of domains.
+A one base element is then in the domains of the one segment it falls
+in, found by a binary search, or by stepping forward when the elements
+come in sorted order, with none of the overlap arithmetic of a merge
+join.  Each segment also keeps the label its domains share, such as the
+term set class of their genes.
+
+*/
+
+#ifndef POINTINDEX_H
+#define POINTINDEX_H
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+struct pointIndex
+/* the segments of one chromosome and the domains covering each */
+{
+	int count;        /* segments */
+	long *bounds;     /* count+1 sorted positions, segment k is bounds[k] up to bounds[k+1] */
+	int *offsets;     /* count+1 offsets into domains */
+	int *domains;     /* the ids of the domains covering each segment, in list order */
+	int *labels;      /* by segment, the label all of its domains share, -1 without */
+	                  /* domains and -2 when they do not all have the same one */
+};
+
+struct pointIndex *pointIndexNew(struct bedLong *domains, int *domainLabels);
+
+int pointIndexFind(struct pointIndex *pi, long position);
+
+int pointIndexNext(struct pointIndex *pi, int segment, long position);
+
+void pointIndexFree(struct pointIndex **pPi);
+
+#endif
@@ -0,0 +1,190 @@
+/*
+
+resultSlice.c
+
+A magic number and version, the slice and how the run was set up, the
+namespaces and terms, then the results of each test.  Strings are their
+length followed by their bytes, and everything else is written as it is
+held in memory, so a file is read back on the same kind of machine.
+
+*/
+
+#include "common.h"
+#include "hash.h"
+#include "enrichments.h"
+#include "resultSlice.h"
+
+#define SLICE_MAGIC 0x50455442   /* "BTEP" */
+#define SLICE_VERSION 1
+
+
+static void writeSliceString(FILE *f, char *s)
+{
+	int size = strlen(s);
+
+	mustWrite(f, &size, sizeof(int));
+	mustWrite(f, s, size);
+}
+
+
+static char *readSliceString(FILE *f, char *fileName)
+{
+	char *s = NULL;
+	int size = 0;
+
+	mustRead(f, &size, sizeof(int));
+	if(size < 0){errAbort("Error: %s is not a good slice file", fileName);}
+	s = needMem(size+1);
+	mustRead(f, s, size);
+	return(s);
+}
+
+
+static void writeNameList(FILE *f, struct slName *list)
+{
+	int count = slCount(list);
+
+	mustWrite(f, &count, sizeof(int));
+	for(; list != NULL; list=list->next)
+		writeSliceString(f, list->name);
+}
+
+
+static struct slName *readNameList(FILE *f, char *fileName)
+{
+	struct slName *list = NULL;
+	char *name = NULL;
+	int count = 0, i = 0;
+
+	mustRead(f, &count, sizeof(int));
+	for(i=0; i<count; i++)
+	{
+		name = readSliceString(f, fileName);
+		slAddHead(&list, newSlName(name));
+		freeMem(name);
+	}
+	slReverse(&list);
+	return(list);
+}
+
+
+static void writeResults(FILE *f, struct enrichResult *results)
+{
+	struct enrichResult *result = NULL;
+	int count = slCount(results);
+
+	mustWrite(f, &count, sizeof(int));
+	for(result=results; result != NULL; result=result->next)
+	{
+		writeSliceString(f, result->term);
+		writeSliceString(f, result->namespace);
+		mustWrite(f, &result->pValue, sizeof(double));
+		mustWrite(f, &result->whiteBallsPicked, sizeof(long));
+		mustWrite(f, &result->totalPicks, sizeof(long));
+		mustWrite(f, &result->whiteBalls, sizeof(long));
+		mustWrite(f, &result->totalBalls, sizeof(long));
+		mustWrite(f, &result->expected, sizeof(double));
+		mustWrite(f, &result->testCount, sizeof(int));
+		writeNameList(f, result->hits);
+	}
+}
+
+
+static struct enrichResult *readResults(FILE *f, char *fileName)
+{
+	struct enrichResult *results = NULL, *result = NULL;
+	int count = 0, i = 0;
+
+	mustRead(f, &count, sizeof(int));
+	for(i=0; i<count; i++)
+	{
+		AllocVar(result);
+		result->term = readSliceString(f, fileName);
+		result->namespace = readSliceString(f, fileName);
+		mustRead(f, &result->pValue, sizeof(double));
+		mustRead(f, &result->whiteBallsPicked, sizeof(long));
+		mustRead(f, &result->totalPicks, sizeof(long));
+		mustRead(f, &result->whiteBalls, sizeof(long));
+		mustRead(f, &result->totalBalls, sizeof(long));
+		mustRead(f, &result->expected, sizeof(double));
+		mustRead(f, &result->testCount, sizeof(int));
+		result->hits = readNameList(f, fileName);
+		slAddHead(&results, result);
+	}
+	slReverse(&results);
+	return(results);
+}
+
+
+void resultSliceWrite(struct resultSlice *rs, FILE *f)
+{
+	int magic = SLICE_MAGIC, version = SLICE_VERSION, test = 0, i = 0;
+
+	mustWrite(f, &magic, sizeof(int));
+	mustWrite(f, &version, sizeof(int));
+	mustWrite(f, &rs->slice, sizeof(int));
+	mustWrite(f, &rs->slices, sizeof(int));
+	mustWrite(f, &rs->namespaces, sizeof(boolean));
+	mustWrite(f, &rs->wantNames, sizeof(boolean));
+	mustWrite(f, &rs->testCount, sizeof(int));
+	for(i=0; i<rs->testCount; i++)
+	{
+		test = rs->tests[i];
+		mustWrite(f, &test, sizeof(int));
+	}
+	writeNameList(f, rs->namespaceList);
+	writeNameList(f, rs->goTerms);
+	for(i=0; i<rs->testCount; i++)
+		writeResults(f, rs->results[i]);
+	if(fflush(f) != 0){errAbort("Error: could not write the results of slice %d", rs->slice+1);}
+}
+
+
+struct resultSlice *resultSliceRead(char *fileName)
+{
+	FILE *f = mustOpen(fileName, "rb");
+	struct resultSlice *rs = NULL;
+	int magic = 0, version = 0, test = 0, i = 0;
+
+	mustRead(f, &magic, sizeof(int));
+	if(magic != SLICE_MAGIC){errAbort("Error: %s is not a slice file made with -shard", fileName);}
+	mustRead(f, &version, sizeof(int));
+	if(version != SLICE_VERSION){errAbort("Error: %s is version %d of the slice file, only version %d can be read", fileName, version, SLICE_VERSION);}
+	AllocVar(rs);
+	mustRead(f, &rs->slice, sizeof(int));
+	mustRead(f, &rs->slices, sizeof(int));
+	mustRead(f, &rs->namespaces, sizeof(boolean));
+	mustRead(f, &rs->wantNames, sizeof(boolean));
+	mustRead(f, &rs->testCount, sizeof(int));
+	if(rs->slices < 1 || rs->slice < 0 || rs->slice >= rs->slices || rs->testCount < 1 || rs->testCount > 3)
+		errAbort("Error: %s is not a good slice file", fileName);
+	AllocArray(rs->tests, rs->testCount);
+	AllocArray(rs->results, rs->testCount);
+	for(i=0; i<rs->testCount; i++)
+	{
+		mustRead(f, &test, sizeof(int));
+		rs->tests[i] = test;
+	}
+	rs->namespaceList = readNameList(f, fileName);
+	rs->goTerms = readNameList(f, fileName);
+	for(i=0; i<rs->testCount; i++)
+		rs->results[i] = readResults(f, fileName);
+	carefulClose(&f);
+	return(rs);
+}
+
+
+void resultSliceFree(struct resultSlice **pRs)
+{
+	struct resultSlice *rs = *pRs;
+	int i = 0;
+
+	if(rs == NULL){return;}
+	for(i=0; i<rs->testCount; i++)
+		enrichResultFreeList(&rs->results[i]);
+	freeMem(rs->results);
+	freeMem(rs->tests);
+	slNameFreeList(&rs->namespaceList);
+	slNameFreeList(&rs->goTerms);
+	freez(pRs);
+}
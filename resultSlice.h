@@ -0,0 +1,40 @@
+/*
+
+resultSlice.h
+
+The uncorrected results of one slice of the terms, from a run given
+-shard, in a binary file.  Each slice can be tested by its own process
+on any machine, and merging the files of every slice gives the results
+of the whole run, corrected and cut off only then.
+
+*/
+
+#ifndef RESULTSLICE_H
+#define RESULTSLICE_H
+
+#ifndef ENRICHMENTS_H
+#include "enrichments.h"
+#endif
+
+struct resultSlice
+/* everything a merge needs from one slice */
+{
+	struct resultSlice *next;
+	int slice;                  /* from 0 */
+	int slices;
+	boolean namespaces;         /* the terms were split into namespaces */
+	boolean wantNames;          /* the results have the names hit */
+	int testCount;
+	enum enrichTest *tests;
+	struct slName *namespaceList;  /* every namespace of the run, in sorted order */
+	struct slName *goTerms;        /* the terms of this slice, in goTerm order */
+	struct enrichResult **results; /* by test */
+};
+
+void resultSliceWrite(struct resultSlice *rs, FILE *f);
+
+struct resultSlice *resultSliceRead(char *fileName);
+
+void resultSliceFree(struct resultSlice **pRs);
+
+#endif
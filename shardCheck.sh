@@ -0,0 +1,86 @@
+#!/bin/sh
+#
+# shardCheck.sh
+#
+# Checks -shard and merge on one machine: each run is made once whole,
+# then as n shards run side by side as separate processes, whose slice
+# files are merged in reverse order and compared with the whole run.
+# The slice files hold raw C values, so this is also what catches a
+# change to their layout that merge was not changed to match.  The
+# inputs are the made up genome of benchRuns.sh.
+#
+# usage: shardCheck.sh [-shards=N] [-scale=N] [-keep=dir] bedToEnrichments
+#    -shards=N   shards to cut each run into (default 4)
+#    -scale=N    passed on to benchRuns.sh for the inputs (default 0.1)
+#    -keep=dir   make the inputs and outputs in dir and leave them there
+# Exits with the number of runs whose merged output differed.  "make
+# shardCheck" runs it on the bedToEnrichments that was just built.
+#
+
+shards=4
+scale=0.1
+keep=
+while true; do
+	case "$1" in
+		-shards=*) shards=${1#-shards=}; shift ;;
+		-scale=*) scale=${1#-scale=}; shift ;;
+		-keep=*) keep=${1#-keep=}; shift ;;
+		*) break ;;
+	esac
+done
+if [ $# -ne 1 ]; then
+	sed -n '3,18p' $0 | sed 's/^# \{0,1\}//'
+	exit 255
+fi
+here=$(cd $(dirname $0) && pwd)
+binary=$(cd $(dirname $1) && pwd)/$(basename $1)
+
+if [ -n "$keep" ]; then
+	dir=$keep
+	mkdir -p $dir
+else
+	dir=$(mktemp -d ${TMPDIR:-/tmp}/shardCheck.XXXXXX)
+	trap 'rm -rf $dir' 0
+fi
+
+# benchRuns.sh makes its inputs in dir and, given no case it knows, times nothing
+sh $here/benchRuns.sh -reps=1 -scale=$scale -keep=$dir $binary noSuchCase > /dev/null || exit 255
+cd $dir || exit 255
+
+failed=0
+
+checkCase()
+# checkCase name "run options" "merge options" inputs..., with the merge
+# options given to the whole run too
+{
+	name=$1; runOpts=$2; mergeOpts=$3; shift 3
+	rm -f slice.* whole.out merged.out
+	if ! $binary $runOpts $mergeOpts "$@" > whole.out 2> run.err; then
+		printf "%-16s %s\n" $name "whole run failed"
+		failed=$((failed + 1))
+		return
+	fi
+	i=1
+	while [ $i -le $shards ]; do
+		$binary $runOpts -shard=$i/$shards "$@" > slice.$i 2> slice.$i.err &
+		i=$((i + 1))
+	done
+	wait
+	if ! $binary merge $mergeOpts $(ls slice.* | grep -v err | sort -r) > merged.out 2> run.err; then
+		printf "%-16s %s\n" $name "merge failed"
+		failed=$((failed + 1))
+	elif cmp -s whole.out merged.out; then
+		printf "%-16s %s\n" $name same
+	else
+		printf "%-16s %s\n" $name DIFF
+		failed=$((failed + 1))
+	fi
+}
+
+checkCase binom "-binom" "-maxPvalue=1" elements.bed genes.bedLong noGaps.bed
+checkCase hypergeo "-hypergeo" "-bonferroni -maxPvalue=1" elements.bed genes.bedLong noGaps.bed
+checkCase nullModel "-hypergeo -largeSet=largeSet.bed" "-maxPvalue=1" elements.bed genes.bedLong noGaps.bed
+checkCase allTests "-binom -hypergeo -largeSet=largeSet.bed" "-maxPvalue=1" elements.bed genes.bedLong noGaps.bed
+checkCase names "-hypergeo -showNames" "-showNames -maxPvalue=1" elementsHot.bed genesPropagated.bedLong noGaps.bed
+checkCase points "-binom" "-bonferroni -maxPvalue=1" elementsPoints.bed genes.bedLong noGaps.bed
+exit $failed
@@ -0,0 +1,405 @@
+/*
+
+spillSort.c
+
+A run on disk is a series of chromosome blocks in sorted order, each
+one the chromosome index and record count followed by the start and end
+of every record.  Runs are merged with a heap keyed on their next
+record.  Chromosomes sort by name with strcmp, the same order the
+shards are worked on in.
+
+*/
+
+#include "common.h"
+#include "linefile.h"
+#include "hash.h"
+#include "bedLong.h"
+#include "packedIntervals.h"
+#include "spillSort.h"
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+
+
+struct spillRun
+/* one sorted run in a temporary file, and how far the merge has read it */
+{
+	struct spillRun *next;
+	FILE *f;
+	long left;                  /* records not yet read */
+	long blockLeft;             /* of those, how many are in the current chromosome block */
+	struct spillRecord record;  /* the record read last, which is next in the merge */
+};
+
+
+struct spillSort *spillSortNew(long memLimit, char *tmpDir)
+/* Starts an empty sort that writes a run to tmpDir each time memLimit */
+/* bytes of elements have been added.  A memLimit of 0 never spills. */
+{
+	struct spillSort *sort = NULL;
+
+	AllocVar(sort);
+	sort->tmpDir = cloneString(tmpDir);
+	sort->chromHash = newHash(8);
+	sort->chromAlloc = 64;
+	AllocArray(sort->chromNames, sort->chromAlloc);
+	sort->bufferSize = (memLimit > 0) ? max(memLimit / (long)sizeof(struct spillRecord), 1024) : 0;
+	sort->buffer = needLargeMem(1024 * sizeof(struct spillRecord));
+	return(sort);
+}
+
+
+static int chromIxFor(struct spillSort *sort, char *chrom)
+{
+	struct hashEl *hel = hashLookup(sort->chromHash, chrom);
+
+	if(hel != NULL){return(ptToInt(hel->val));}
+	if(sort->chromCount == sort->chromAlloc)
+	{
+		ExpandArray(sort->chromNames, sort->chromAlloc, 2*sort->chromAlloc);
+		sort->chromAlloc *= 2;
+	}
+	sort->chromNames[sort->chromCount] = cloneString(chrom);
+	hashAdd(sort->chromHash, chrom, intToPt(sort->chromCount));
+	return(sort->chromCount++);
+}
+
+
+static int nameIxCmp(const void *va, const void *vb)
+{
+	const char *a = **((char ***)va);
+	const char *b = **((char ***)vb);
+	return(strcmp(a, b));
+}
+
+
+static int spillRecordCmp(const void *va, const void *vb)
+/* orders records whose chromIx has been turned into a rank */
+{
+	const struct spillRecord *a = (const struct spillRecord *)va;
+	const struct spillRecord *b = (const struct spillRecord *)vb;
+	if(a->chromIx != b->chromIx){return(a->chromIx - b->chromIx);}
+	if(a->start != b->start){return((a->start < b->start) ? -1 : 1);}
+	if(a->end != b->end){return((a->end < b->end) ? -1 : 1);}
+	return(0);
+}
+
+
+static void sortBuffer(struct spillSort *sort)
+/* Sorts the buffer by chromosome name, start and end.  The chromosome */
+/* indices are swapped for their rank in name order while qsort runs, so */
+/* that the comparison does not need the names. */
+{
+	char ***byName = NULL;
+	int *rank = NULL, *ixOfRank = NULL, i = 0;
+	long r = 0;
+
+	AllocArray(byName, max(sort->chromCount,1));
+	AllocArray(rank, max(sort->chromCount,1));
+	AllocArray(ixOfRank, max(sort->chromCount,1));
+	for(i=0; i<sort->chromCount; i++)
+		byName[i] = &sort->chromNames[i];
+	qsort(byName, sort->chromCount, sizeof(char **), nameIxCmp);
+	for(i=0; i<sort->chromCount; i++)
+	{
+		ixOfRank[i] = byName[i] - sort->chromNames;
+		rank[ixOfRank[i]] = i;
+	}
+
+	for(r=0; r<sort->bufferCount; r++)
+		sort->buffer[r].chromIx = rank[sort->buffer[r].chromIx];
+	qsort(sort->buffer, sort->bufferCount, sizeof(struct spillRecord), spillRecordCmp);
+	for(r=0; r<sort->bufferCount; r++)
+		sort->buffer[r].chromIx = ixOfRank[sort->buffer[r].chromIx];
+
+	freeMem(byName);
+	freeMem(rank);
+	freeMem(ixOfRank);
+}
+
+
+static FILE *tempFile(char *tmpDir)
+/* an open temporary file that is removed once it is closed */
+{
+	char path[4096];
+	int fd = 0;
+	FILE *f = NULL;
+
+	safef(path, sizeof(path), "%s/bedToEnrichments.XXXXXX", tmpDir);
+	if((fd = mkstemp(path)) < 0){errAbort("Error: can not make a temporary file in %s: %s", tmpDir, strerror(errno));}
+	unlink(path);
+	if((f = fdopen(fd, "w+")) == NULL){errAbort("Error: can not open temporary file in %s: %s", tmpDir, strerror(errno));}
+	return(f);
+}
+
+
+static void writeRun(struct spillSort *sort)
+/* sorts the buffer and writes it out as one run */
+{
+	struct spillRun *run = NULL;
+	long coords[2*1024];
+	long i = 0, j = 0, k = 0, count = 0, n = 0;
+
+	sortBuffer(sort);
+	AllocVar(run);
+	run->f = tempFile(sort->tmpDir);
+	for(i=0; i<sort->bufferCount; i=j)
+	{
+		for(j=i; j<sort->bufferCount && sort->buffer[j].chromIx == sort->buffer[i].chromIx; j++)
+			;
+		count = j - i;
+		mustWrite(run->f, &sort->buffer[i].chromIx, sizeof(int));
+		mustWrite(run->f, &count, sizeof(long));
+		for(k=i, n=0; k<j; k++)
+		{
+			coords[n++] = sort->buffer[k].start;
+			coords[n++] = sort->buffer[k].end;
+			if(n == ArraySize(coords) || k == j-1)
+			{
+				mustWrite(run->f, coords, n * sizeof(long));
+				n = 0;
+			}
+		}
+	}
+	if(fflush(run->f) != 0){errAbort("Error: could not write a sorted run to %s: %s", sort->tmpDir, strerror(errno));}
+	rewind(run->f);
+	run->left = sort->bufferCount;
+	slAddHead(&sort->runList, run);
+	sort->runCount++;
+	verbose(2, "  wrote sorted run %d of %ld elements to %s\n", sort->runCount, sort->bufferCount, sort->tmpDir);
+	sort->bufferCount = 0;
+}
+
+
+void spillSortAdd(struct spillSort *sort, char *chrom, long start, long end)
+{
+	struct spillRecord *record = NULL;
+	long alloc = 0;
+
+	if(sort->finished){errAbort("Error: can not add to a spillSort that is finished");}
+	if(sort->bufferSize > 0 && sort->bufferCount == sort->bufferSize)
+		writeRun(sort);
+	alloc = max(1024, sort->bufferCount);
+	if(sort->bufferCount == alloc)
+	{
+		//the buffer doubles until it reaches bufferSize
+		long newAlloc = 2 * alloc;
+		if(sort->bufferSize > 0){newAlloc = min(newAlloc, sort->bufferSize);}
+		sort->buffer = needLargeMemResize(sort->buffer, newAlloc * sizeof(struct spillRecord));
+	}
+	record = &sort->buffer[sort->bufferCount++];
+	record->chromIx = chromIxFor(sort, chrom);
+	record->start = start;
+	record->end = end;
+	sort->count++;
+}
+
+
+static boolean runNext(struct spillRun *run)
+/* reads the next record of run, returning FALSE when there are none left */
+{
+	if(run->left == 0){return(FALSE);}
+	if(run->blockLeft == 0)
+	{
+		mustRead(run->f, &run->record.chromIx, sizeof(int));
+		mustRead(run->f, &run->blockLeft, sizeof(long));
+	}
+	mustRead(run->f, &run->record.start, sizeof(long));
+	mustRead(run->f, &run->record.end, sizeof(long));
+	run->blockLeft--;
+	run->left--;
+	return(TRUE);
+}
+
+
+static boolean runLess(struct spillSort *sort, struct spillRun *a, struct spillRun *b)
+{
+	int diff = 0;
+
+	if(a->record.chromIx != b->record.chromIx)
+	{
+		diff = strcmp(sort->chromNames[a->record.chromIx], sort->chromNames[b->record.chromIx]);
+		return(diff < 0);
+	}
+	if(a->record.start != b->record.start){return(a->record.start < b->record.start);}
+	return(a->record.end < b->record.end);
+}
+
+
+static void siftDown(struct spillSort *sort, int i)
+{
+	struct spillRun **heap = sort->heap, *swap = NULL;
+	int smallest = i, left = 0, right = 0;
+
+	while(TRUE)
+	{
+		left = 2*i + 1;
+		right = 2*i + 2;
+		if(left < sort->heapCount && runLess(sort, heap[left], heap[smallest])){smallest = left;}
+		if(right < sort->heapCount && runLess(sort, heap[right], heap[smallest])){smallest = right;}
+		if(smallest == i){return;}
+		swap = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = swap;
+		i = smallest;
+	}
+}
+
+
+void spillSortFinish(struct spillSort *sort)
+/* Call once every element has been added.  If nothing was spilled the */
+/* buffer is just sorted, otherwise what is left of it becomes the last */
+/* run and the merge is set up. */
+{
+	struct spillRun *run = NULL;
+	int i = 0;
+
+	if(sort->finished){return;}
+	sort->finished = TRUE;
+	if(sort->runCount == 0)
+	{
+		sortBuffer(sort);
+		return;
+	}
+	if(sort->bufferCount > 0)
+		writeRun(sort);
+	freez(&sort->buffer);
+
+	verbose(2, "  merging %d sorted runs of %ld elements\n", sort->runCount, sort->count);
+	AllocArray(sort->heap, sort->runCount);
+	for(run=sort->runList; run != NULL; run=run->next)
+	{
+		if(runNext(run)){sort->heap[sort->heapCount++] = run;}
+	}
+	for(i=sort->heapCount/2 - 1; i >= 0; i--)
+		siftDown(sort, i);
+}
+
+
+struct spillSort *spillSortLoad(char *fileName, long memLimit, char *tmpDir)
+/* Reads the coordinates of every line of a bed file into a finished */
+/* spillSort.  Any columns after the first 3 are skipped. */
+{
+	struct spillSort *sort = spillSortNew(memLimit, tmpDir);
+	int numFields = bedLongFileFieldCount(fileName);
+	struct lineFile *lf = lineFileOpen(fileName, TRUE);
+	char *row[numFields];
+
+	while(lineFileNextRow(lf, row, numFields))
+		spillSortAdd(sort, row[0], stringToLong(row[1]), stringToLong(row[2]));
+	lineFileClose(&lf);
+	spillSortFinish(sort);
+	return(sort);
+}
+
+
+struct chromGather
+/* the elements of one chromosome as they come out of the merge */
+{
+	char *chrom;
+	struct packedIntervals *packed;
+	int alloc;
+	struct bedLong *list;   /* used instead of packed once a coordinate needs 64 bits */
+};
+
+
+static void gatherAdd(struct chromGather *gather, long start, long end)
+{
+	struct packedIntervals *packed = gather->packed;
+	struct bedLong *el = NULL;
+
+	if(packed != NULL && start >= 0 && end <= INT_MAX && end >= start)
+	{
+		if(packed->count == gather->alloc)
+		{
+			ExpandArray(packed->starts, gather->alloc, 2*gather->alloc);
+			ExpandArray(packed->ends, gather->alloc, 2*gather->alloc);
+			gather->alloc *= 2;
+		}
+		packed->starts[packed->count] = (int)start;
+		packed->ends[packed->count] = (int)end;
+		packed->count++;
+		return;
+	}
+	if(packed != NULL)
+	{
+		gather->list = bedLongListFromPacked(gather->chrom, packed);
+		slReverse(&gather->list);
+		packedIntervalsFree(&gather->packed);
+	}
+	AllocVar(el);
+	el->chrom = cloneString(gather->chrom);
+	el->chromStart = start;
+	el->chromEnd = end;
+	slAddHead(&gather->list, el);
+}
+
+
+boolean spillSortNextChrom(struct spillSort *sort, char **retChrom, struct packedIntervals **retPacked, struct bedLong **retList)
+/* Hands back the elements of the next chromosome in strcmp order, sorted */
+/* by start.  They come as packed intervals when they fit in 32 bits, and */
+/* as a list otherwise, and belong to the caller.  The chromosome name */
+/* belongs to the sort.  Returns FALSE when there are no more. */
+{
+	struct chromGather gather;
+	struct spillRecord *record = NULL;
+	int chromIx = 0;
+
+	if(!sort->finished){errAbort("Error: spillSortFinish must be called before the elements are read back");}
+	if((sort->runCount == 0 && sort->nextIx >= sort->bufferCount) || (sort->runCount > 0 && sort->heapCount == 0)){return(FALSE);}
+
+	chromIx = (sort->runCount == 0) ? sort->buffer[sort->nextIx].chromIx : sort->heap[0]->record.chromIx;
+	ZeroVar(&gather);
+	gather.chrom = sort->chromNames[chromIx];
+	gather.alloc = 1024;
+	gather.packed = packedIntervalsNew(0);
+	ExpandArray(gather.packed->starts, 0, gather.alloc);
+	ExpandArray(gather.packed->ends, 0, gather.alloc);
+
+	if(sort->runCount == 0)
+	{
+		for(; sort->nextIx < sort->bufferCount && sort->buffer[sort->nextIx].chromIx == chromIx; sort->nextIx++)
+		{
+			record = &sort->buffer[sort->nextIx];
+			gatherAdd(&gather, record->start, record->end);
+		}
+	}
+	else
+	{
+		while(sort->heapCount > 0 && sort->heap[0]->record.chromIx == chromIx)
+		{
+			gatherAdd(&gather, sort->heap[0]->record.start, sort->heap[0]->record.end);
+			if(!runNext(sort->heap[0])){sort->heap[0] = sort->heap[--sort->heapCount];}
+			siftDown(sort, 0);
+		}
+	}
+
+	slReverse(&gather.list);
+	*retChrom = gather.chrom;
+	*retPacked = gather.packed;
+	*retList = gather.list;
+	return(TRUE);
+}
+
+
+void spillSortFree(struct spillSort **pSort)
+{
+	struct spillSort *sort = *pSort;
+	struct spillRun *run = NULL;
+	int i = 0;
+
+	if(sort == NULL){return;}
+	while((run = slPopHead(&sort->runList)) != NULL)
+	{
+		carefulClose(&run->f);
+		freeMem(run);
+	}
+	for(i=0; i<sort->chromCount; i++)
+		freeMem(sort->chromNames[i]);
+	freeMem(sort->chromNames);
+	freeHash(&sort->chromHash);
+	freeMem(sort->buffer);
+	freeMem(sort->heap);
+	freeMem(sort->tmpDir);
+	freez(pSort);
+}
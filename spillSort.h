@@ -0,0 +1,64 @@
+/*
+
+spillSort.h
+
+Sorts the coordinates of an element file that may be too big to hold
+in memory.  Elements are gathered in a buffer of a set size.  Each time
+the buffer fills it is sorted and written to a temporary file as one
+run.  The runs are then merged back together one chromosome at a time,
+so that only the elements of one chromosome are ever held at once.
+
+*/
+
+#ifndef SPILLSORT_H
+#define SPILLSORT_H
+
+#ifndef BEDLONG_H
+#include "bedLong.h"
+#endif
+
+#ifndef PACKEDINTERVALS_H
+#include "packedIntervals.h"
+#endif
+
+struct spillRecord
+/* one element while it is being sorted */
+{
+	int chromIx;    /* index into chromNames */
+	long start;
+	long end;
+};
+
+struct spillSort
+/* the elements added so far, partly in the buffer and partly in runs on disk */
+{
+	char *tmpDir;
+	struct hash *chromHash;       /* chrom to its index in chromNames */
+	char **chromNames;
+	int chromCount;
+	int chromAlloc;
+	struct spillRecord *buffer;
+	long bufferCount;
+	long bufferSize;              /* records the buffer can hold */
+	struct spillRun *runList;     /* sorted runs written so far */
+	int runCount;
+	long count;                   /* elements added */
+	boolean finished;
+	struct spillRun **heap;       /* runs being merged, smallest next record first */
+	int heapCount;
+	long nextIx;                  /* where the next chromosome starts in buffer, when nothing spilled */
+};
+
+struct spillSort *spillSortNew(long memLimit, char *tmpDir);
+
+void spillSortAdd(struct spillSort *sort, char *chrom, long start, long end);
+
+struct spillSort *spillSortLoad(char *fileName, long memLimit, char *tmpDir);
+
+void spillSortFinish(struct spillSort *sort);
+
+boolean spillSortNextChrom(struct spillSort *sort, char **retChrom, struct packedIntervals **retPacked, struct bedLong **retList);
+
+void spillSortFree(struct spillSort **pSort);
+
+#endif